@@ -14,6 +14,8 @@
 #include <vtkSmartPointer.h>
 #include <vtkUnstructuredGridGeometryFilter.h>
 #include <vtkIdTypeArray.h>
+#include <vtkIntArray.h>
+#include <vtkFieldData.h>
 
 #include "GemIOResources.h"
 
@@ -21,6 +23,8 @@ using VtkUGrid = vtkSmartPointer<vtkUnstructuredGridBase>;
 
 namespace
 {
+    const std::string OPTION_MATERIAL_IDS = "Write material numbers instead of element values";
+
     template<class TValue = double, class TArray>
     std::function<TValue(vtkIdType)> createArrayAccessFunctor(TArray *p, TValue defaultValue = 0)
     {
@@ -97,7 +101,43 @@ namespace
         rFile << "#END SURFACE" << std::endl;
     }
 
-    void serialize(std::ofstream &rFile, vtkUnstructuredGrid &rGrid)
+    // material numbers of the element array sArrayName and the values of the materials, see MaterialMappingFilter
+    struct MaterialIds
+    {
+        vtkIntArray* pIds;
+        vtkDataArray* pValues;
+    };
+
+    MaterialIds getMaterialIds(vtkUnstructuredGrid &rGrid, const std::string& sArrayName)
+    {
+        MaterialIds ids;
+        ids.pIds = vtkIntArray::SafeDownCast(rGrid.GetCellData()->GetArray((sArrayName + GEM_DATA_ARRAY_SUFFIX_MATERIAL_ID).c_str()));
+        ids.pValues = rGrid.GetFieldData()->GetArray((sArrayName + GEM_DATA_ARRAY_SUFFIX_MATERIAL_VALUES).c_str());
+        if (ids.pIds == nullptr || ids.pValues == nullptr)
+        {
+            MITK_WARN("AsciiUgridFileWriterService") << "No material numbers found for " << sArrayName << ". Writing the element values.";
+            ids.pIds = nullptr;
+        }
+        return ids;
+    }
+
+    void serializeMaterials(std::ofstream &rFile, const MaterialIds& ids, const std::string& sMethod)
+    {
+        if (ids.pIds == nullptr)
+        {
+            return;
+        }
+
+        rFile << "#BEGIN MATERIALS " << sMethod << std::endl;
+        rFile << "#COMMENT Structure: material_number, E" << sMethod << std::endl;
+        for (auto i = 0; i < ids.pValues->GetNumberOfTuples(); ++i)
+        {
+            rFile << i + 1 << ", " << boost::format("%12.4f") % ids.pValues->GetTuple1(i) << std::endl;
+        }
+        rFile << "#END MATERIALS " << sMethod << std::endl;
+    }
+
+    void serialize(std::ofstream &rFile, vtkUnstructuredGrid &rGrid, bool bMaterialIds)
     {
         // vtkCellData
         auto getPointID = createIDFunctor(rGrid.GetPointData()->GetArray("vtkOriginalPointIds"));
@@ -109,6 +149,24 @@ namespace
         auto getCellB = createArrayAccessFunctor(rGrid.GetCellData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_B));
         auto getCellE = createArrayAccessFunctor(rGrid.GetCellData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_E));
 
+        MaterialIds materialsA = {nullptr, nullptr}, materialsB = {nullptr, nullptr};
+        if (bMaterialIds)
+        {
+            materialsA = getMaterialIds(rGrid, GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A);
+            materialsB = getMaterialIds(rGrid, GEM_DATA_ARRAY_NAME_MATMAP_METHOD_B);
+        }
+        auto writeCellValue = [&rFile](const MaterialIds& ids, const std::function<double(vtkIdType)>& getValue, vtkIdType id)
+        {
+            if (ids.pIds != nullptr)
+            {
+                rFile << ids.pIds->GetValue(id);
+            }
+            else
+            {
+                rFile << boost::format("%12.4f") % getValue(id);
+            }
+        };
+
         auto uiNumberOfPoints = rGrid.GetNumberOfPoints();
         auto uiNumberOfCells = rGrid.GetNumberOfCells();
 
@@ -149,6 +207,10 @@ namespace
         rFile << "#BEGIN ELEMENTS "<< uiPointsPerCell << std::endl;
         rFile << "#COMMENT Structure: elem_nr, n1, ... , n" << uiPointsPerCell << ", EA, EB" << std::endl;
         rFile << "#COMMENT EA, EB are the Young´s moduli at the elements for method A and B respectively." << std::endl;
+        if (materialsA.pIds != nullptr || materialsB.pIds != nullptr)
+        {
+            rFile << "#COMMENT Young´s moduli with a MATERIALS section are written as material numbers." << std::endl;
+        }
         for (auto i = 0; i < uiNumberOfCells; ++i)
         {
             const auto pCell = rGrid.GetCell(i);
@@ -160,11 +222,16 @@ namespace
                 rFile << pointId << ", ";
             }
 
-            rFile << boost::format("%12.4f") % getCellA(i) << ", "
-                  << boost::format("%12.4f") % getCellB(i) << std::endl;
+            writeCellValue(materialsA, getCellA, i);
+            rFile << ", ";
+            writeCellValue(materialsB, getCellB, i);
+            rFile << std::endl;
         }
         rFile << "#END ELEMENTS " << uiPointsPerCell << std::endl;
 
+        serializeMaterials(rFile, materialsA, "A");
+        serializeMaterials(rFile, materialsB, "B");
+
         extractAndSerializeSurface(rFile, &rGrid);
     }
 }
@@ -174,6 +241,10 @@ AsciiUgridFileWriterService::AsciiUgridFileWriterService(void)
                                    GemIOMimeTypes::ASCIIUGRID_MIMETYPE(),
                                    "ASCIIugrid")
 {
+    mitk::IFileIO::Options defaultOptions;
+    defaultOptions[OPTION_MATERIAL_IDS] = false;
+    this->SetDefaultOptions(defaultOptions);
+
     RegisterService();
 }
 
@@ -222,8 +293,10 @@ void AsciiUgridFileWriterService::Write()
 
         if (file.is_open())
         {
+            auto bMaterialIds = us::any_cast<bool>(this->GetOption(OPTION_MATERIAL_IDS));
             serialize(file,
-                      *const_cast<InputType &>(*input).GetVtkUnstructuredGrid()); // For whatever reason GetVtkUnstructuredGrid is not const...
+                      *const_cast<InputType &>(*input).GetVtkUnstructuredGrid(), // For whatever reason GetVtkUnstructuredGrid is not const...
+                      bMaterialIds);
         }
         else
         {
@@ -5,4 +5,7 @@
 #define GEM_DATA_ARRAY_NAME_MATMAP_METHOD_B "GEM_METHOD_B"
 #define GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C "GEM_METHOD_C"
 #define GEM_DATA_ARRAY_NAME_MATMAP_METHOD_D "GEM_METHOD_D"
-#define GEM_DATA_ARRAY_NAME_MATMAP_METHOD_E "GEM_METHOD_E"
\ No newline at end of file
+#define GEM_DATA_ARRAY_NAME_MATMAP_METHOD_E "GEM_METHOD_E"
+// suffixes of the material quantisation arrays of an element array, e.g. GEM_METHOD_A_MATERIAL_ID
+#define GEM_DATA_ARRAY_SUFFIX_MATERIAL_ID "_MATERIAL_ID"         // cell data, material number of each element (1 based)
+#define GEM_DATA_ARRAY_SUFFIX_MATERIAL_VALUES "_MATERIAL_VALUES" // field data, value of material i + 1 at index i
@@ -0,0 +1,482 @@
+/**
+ *  Image GraphCut 3D Segmentation
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+#include "GraphCut.h"
+
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkImageIOFactory.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__unix__)
+#include <unistd.h>
+#endif
+
+/** This example segments a list of images given in a manifest file and writes a summary of all jobs as CSV.
+ * Jobs are processed in three overlapping stages: a reader thread loads the images of upcoming jobs, a configurable
+ * number of solver threads run the graph cuts and a writer thread stores the results. A job is only read once its
+ * estimated memory requirement fits into the memory budget; the reservation is released after its result is written.
+ * Besides the estimate, the summary lists the measured growth of the resident memory while each job was solved.
+ * The driver only depends on ITK and can be used on headless machines.
+ */
+namespace {
+    // Define all image types
+    typedef itk::Image<short, 3> ImageType;
+    typedef itk::Image<unsigned char, 3> ForegroundMaskType;
+    typedef itk::Image<unsigned char, 3> BackgroundMaskType;
+    typedef itk::Image<unsigned char, 3> OutputImageType;
+    typedef GraphCut::FilterType<ImageType, ForegroundMaskType, BackgroundMaskType, OutputImageType> GraphCutFilterType;
+
+    typedef std::chrono::steady_clock ClockType;
+
+    struct Job {
+        // manifest entry
+        unsigned int lineNumber;
+        std::string imageFilename;
+        std::string foregroundFilename;
+        std::string backgroundFilename;
+        std::string outputFilename;
+        double sigma;
+        int boundaryDirection;      // 0->bidirectional; 1->bright to dark; 2->dark to bright
+
+        // pipeline state
+        unsigned long long estimatedMemoryInBytes = 0;
+        ImageType::Pointer image;
+        ForegroundMaskType::Pointer foreground;
+        BackgroundMaskType::Pointer background;
+        OutputImageType::Pointer output;
+
+        // summary
+        bool failed = false;
+        std::string error;
+        double readTimeInSeconds = 0;
+        double solveTimeInSeconds = 0;
+        double writeTimeInSeconds = 0;
+        double waitTimeInSeconds = 0;
+        unsigned long long solveResidentMemoryInBytes = 0; // measured, see ResidentMemorySampler
+    };
+
+    // Blocking FIFO used to hand jobs from one stage to the next. Closing the queue wakes up all consumers.
+    template<typename T>
+    class JobQueue {
+    public:
+        void Push(T item) {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Items.push_back(item);
+            }
+            m_Condition.notify_one();
+        }
+
+        // returns false once the queue is closed and drained
+        bool Pop(T &item) {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this] { return !m_Items.empty() || m_Closed; });
+            if (m_Items.empty()) {
+                return false;
+            }
+            item = m_Items.front();
+            m_Items.pop_front();
+            return true;
+        }
+
+        void Close() {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Closed = true;
+            }
+            m_Condition.notify_all();
+        }
+
+    private:
+        std::deque<T> m_Items;
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        bool m_Closed = false;
+    };
+
+    // Counting reservation of the memory budget. A job larger than the whole budget is admitted once nothing else runs.
+    class MemoryBudget {
+    public:
+        explicit MemoryBudget(unsigned long long budgetInBytes) : m_Budget(budgetInBytes) {
+        }
+
+        void Acquire(unsigned long long bytes) {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this, bytes] { return m_Used == 0 || m_Used + bytes <= m_Budget; });
+            m_Used += bytes;
+        }
+
+        void Release(unsigned long long bytes) {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Used -= std::min(bytes, m_Used);
+            }
+            m_Condition.notify_all();
+        }
+
+    private:
+        unsigned long long m_Budget;
+        unsigned long long m_Used = 0;
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+    };
+
+    double secondsSince(ClockType::time_point start) {
+        return std::chrono::duration<double>(ClockType::now() - start).count();
+    }
+
+    // current resident set size of the whole process, 0 if it is not available
+    unsigned long long getResidentMemoryInBytes() {
+#if defined(__APPLE__)
+        mach_task_basic_info_data_t info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+            return 0;
+        }
+        return info.resident_size;
+#elif defined(__unix__)
+        unsigned long long size = 0;
+        unsigned long long resident = 0;
+        std::ifstream statm("/proc/self/statm");
+        if (!(statm >> size >> resident)) {
+            return 0;
+        }
+        return resident * static_cast<unsigned long long>(sysconf(_SC_PAGESIZE));
+#else
+        return 0;
+#endif
+    }
+
+    // Samples the resident memory of the process in the background. A solve is watched from Begin() to End(), which
+    // returns the peak sampled in between minus the resident memory at Begin(). For a single solver thread this is the
+    // memory of the job's graph and output. Jobs solved concurrently share the process, so their growth is included.
+    class ResidentMemorySampler {
+    public:
+        typedef std::list<std::pair<unsigned long long, unsigned long long> >::iterator Watch; // start, peak
+
+        explicit ResidentMemorySampler(std::chrono::milliseconds period) : m_Thread([this, period]() {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            while (!m_Condition.wait_for(lock, period, [this] { return m_Stopped; })) {
+                sample(getResidentMemoryInBytes());
+            }
+        }) {
+        }
+
+        ~ResidentMemorySampler() {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stopped = true;
+            }
+            m_Condition.notify_all();
+            m_Thread.join();
+        }
+
+        Watch Begin() {
+            auto start = getResidentMemoryInBytes();
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_Watches.insert(m_Watches.end(), std::make_pair(start, start));
+        }
+
+        unsigned long long End(Watch watch) {
+            auto end = getResidentMemoryInBytes();
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            sample(end);
+            auto growth = watch->second - watch->first;
+            m_Watches.erase(watch);
+            return growth;
+        }
+
+    private:
+        // requires m_Mutex
+        void sample(unsigned long long resident) {
+            for (auto &watch : m_Watches) {
+                watch.second = std::max(watch.second, resident);
+            }
+        }
+
+        std::list<std::pair<unsigned long long, unsigned long long> > m_Watches;
+        bool m_Stopped = false;
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::thread m_Thread; // started last, after the members it uses
+    };
+
+    // Same estimate as the graphcut plugin uses: node struct is 48byte, arc is 28byte as defined by Kolmogorov max
+    // flow v3.0.03, plus the input image and both masks.
+    unsigned long long estimateMemoryInBytes(const std::string &imageFilename) {
+        itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(imageFilename.c_str(),
+                                                                               itk::ImageIOFactory::ReadMode);
+        if (imageIO.IsNull()) {
+            throw std::runtime_error("could not create an ImageIO for " + imageFilename);
+        }
+        imageIO->SetFileName(imageFilename);
+        imageIO->ReadImageInformation();
+
+        unsigned long long x = imageIO->GetDimensions(0);
+        unsigned long long y = imageIO->GetNumberOfDimensions() > 1 ? imageIO->GetDimensions(1) : 1;
+        unsigned long long z = imageIO->GetNumberOfDimensions() > 2 ? imageIO->GetDimensions(2) : 1;
+        unsigned long long numberOfVertices = x * y * z;
+        unsigned long long numberOfEdges = 2 * (3 * numberOfVertices - x * y - y * z - x * z);
+
+        unsigned long long itkImageSizeInMemory = numberOfVertices * (sizeof(short) + 3 * sizeof(unsigned char));
+        return numberOfVertices * 48 + numberOfEdges * 28 + itkImageSizeInMemory;
+    }
+
+    template<typename TImage>
+    typename TImage::Pointer readImage(const std::string &filename) {
+        typedef itk::ImageFileReader<TImage> ReaderType;
+        typename ReaderType::Pointer reader = ReaderType::New();
+        reader->SetFileName(filename);
+        reader->Update();
+        typename TImage::Pointer image = reader->GetOutput();
+        image->DisconnectPipeline();
+        return image;
+    }
+
+    bool parseManifest(const std::string &filename, std::vector<Job> &jobs) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << "ERROR: could not open manifest " << filename << std::endl;
+            return false;
+        }
+
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+            // '#' starts a comment, commas are treated as whitespace
+            line = line.substr(0, line.find('#'));
+            std::replace(line.begin(), line.end(), ',', ' ');
+
+            std::istringstream stream(line);
+            Job job;
+            job.lineNumber = lineNumber;
+            if (!(stream >> job.imageFilename)) {
+                continue; // empty line
+            }
+            if (!(stream >> job.foregroundFilename >> job.backgroundFilename >> job.outputFilename >> job.sigma
+                         >> job.boundaryDirection)) {
+                std::cerr << "ERROR: " << filename << ":" << lineNumber
+                          << ": expected 'image foregroundMask backgroundMask output sigma boundaryDirection'"
+                          << std::endl;
+                return false;
+            }
+            jobs.push_back(job);
+        }
+        return true;
+    }
+
+    void solve(Job &job) {
+        GraphCutFilterType::Pointer graphCutFilter = GraphCutFilterType::New();
+        graphCutFilter->SetInputImage(job.image);
+        graphCutFilter->SetForegroundImage(job.foreground);
+        graphCutFilter->SetBackgroundImage(job.background);
+        graphCutFilter->SetSigma(job.sigma);
+        switch (job.boundaryDirection) {
+            case 1:
+                graphCutFilter->SetBoundaryDirectionTypeToBrightDark();
+                break;
+            case 2:
+                graphCutFilter->SetBoundaryDirectionTypeToDarkBright();
+                break;
+            default:
+                graphCutFilter->SetBoundaryDirectionTypeToNoDirection();
+        }
+        graphCutFilter->SetForegroundPixelValue(255);
+        graphCutFilter->SetBackgroundPixelValue(0);
+        graphCutFilter->Update();
+
+        job.output = graphCutFilter->GetOutput();
+        job.output->DisconnectPipeline();
+
+        // the inputs are not needed anymore, free them before the job waits for the writer
+        job.image = nullptr;
+        job.foreground = nullptr;
+        job.background = nullptr;
+    }
+
+    // quotes a CSV field, embedded quotes are doubled
+    std::string quoteCsv(const std::string &field) {
+        std::string quoted = "\"";
+        for (char c : field) {
+            if (c == '"') {
+                quoted += '"';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    void writeSummary(const std::string &filename, const std::vector<Job> &jobs) {
+        std::ofstream file(filename);
+        file << "line,image,output,sigma,boundaryDirection,status,waitTime_s,readTime_s,solveTime_s,writeTime_s,"
+                "estimatedMemory_B,measuredSolveResidentMemory_B,error" << std::endl;
+        for (const auto &job : jobs) {
+            file << job.lineNumber << ","
+                 << quoteCsv(job.imageFilename) << ","
+                 << quoteCsv(job.outputFilename) << ","
+                 << job.sigma << ","
+                 << job.boundaryDirection << ","
+                 << (job.failed ? "failed" : "ok") << ","
+                 << job.waitTimeInSeconds << ","
+                 << job.readTimeInSeconds << ","
+                 << job.solveTimeInSeconds << ","
+                 << job.writeTimeInSeconds << ","
+                 << job.estimatedMemoryInBytes << ","
+                 << job.solveResidentMemoryInBytes << ","
+                 << quoteCsv(job.error) << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Verify arguments
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Required: manifest.txt summary.csv [numberOfConcurrentJobs] [memoryBudgetInMB]" << std::endl;
+        std::cerr << "manifest.txt:           one job per line: image foregroundMask backgroundMask output sigma boundaryDirection" << std::endl;
+        std::cerr << "                        fields are separated by whitespace or commas, '#' starts a comment" << std::endl;
+        std::cerr << "summary.csv:            per job timings, estimated and measured memory" << std::endl;
+        std::cerr << "numberOfConcurrentJobs: number of graph cuts solved at the same time, defaults to 1" << std::endl;
+        std::cerr << "memoryBudgetInMB:       upper bound for the estimated memory of all loaded jobs, defaults to 4096" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Parse arguments
+    std::string manifestFilename = argv[1];
+    std::string summaryFilename = argv[2];
+    unsigned int numberOfConcurrentJobs = argc > 3 ? std::max(1, atoi(argv[3])) : 1;
+    unsigned long long memoryBudgetInBytes = (argc > 4 ? std::max(1, atoi(argv[4])) : 4096) * 1024ull * 1024ull;
+
+    std::vector<Job> jobs;
+    if (!parseManifest(manifestFilename, jobs)) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "*** " << jobs.size() << " jobs, " << numberOfConcurrentJobs << " concurrent, memory budget "
+              << memoryBudgetInBytes / 1024 / 1024 << "MB ***" << std::endl;
+
+    MemoryBudget budget(memoryBudgetInBytes);
+    ResidentMemorySampler memorySampler(std::chrono::milliseconds(10));
+    JobQueue<Job *> solveQueue;
+    JobQueue<Job *> writeQueue;
+    std::mutex logMutex;
+    auto log = [&logMutex](const Job &job, const std::string &message) {
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout << "[" << job.lineNumber << "] " << job.imageFilename << ": " << message << std::endl;
+    };
+
+    // reader stage: loads jobs in manifest order as soon as the budget allows it
+    std::thread reader([&]() {
+        for (auto &job : jobs) {
+            auto start = ClockType::now();
+            try {
+                job.estimatedMemoryInBytes = estimateMemoryInBytes(job.imageFilename);
+                budget.Acquire(job.estimatedMemoryInBytes);
+                job.waitTimeInSeconds = secondsSince(start);
+
+                start = ClockType::now();
+                job.image = readImage<ImageType>(job.imageFilename);
+                job.foreground = readImage<ForegroundMaskType>(job.foregroundFilename);
+                job.background = readImage<BackgroundMaskType>(job.backgroundFilename);
+                job.readTimeInSeconds = secondsSince(start);
+                log(job, "read");
+            } catch (std::exception &e) { // itk::ExceptionObject derives from std::exception
+                job.failed = true;
+                job.error = e.what();
+                log(job, "ERROR while reading: " + job.error);
+            }
+            solveQueue.Push(&job);
+        }
+        solveQueue.Close();
+    });
+
+    // solver stage
+    std::vector<std::thread> solvers;
+    for (unsigned int i = 0; i < numberOfConcurrentJobs; ++i) {
+        solvers.emplace_back([&]() {
+            Job *job;
+            while (solveQueue.Pop(job)) {
+                if (!job->failed) {
+                    auto start = ClockType::now();
+                    auto memoryWatch = memorySampler.Begin();
+                    try {
+                        solve(*job);
+                        job->solveTimeInSeconds = secondsSince(start);
+                        log(*job, "solved");
+                    } catch (std::exception &e) {
+                        job->failed = true;
+                        job->error = e.what();
+                        log(*job, "ERROR while solving: " + job->error);
+                    }
+                    job->solveResidentMemoryInBytes = memorySampler.End(memoryWatch);
+                }
+                writeQueue.Push(job);
+            }
+        });
+    }
+
+    // writer stage
+    std::thread writer([&]() {
+        Job *job;
+        while (writeQueue.Pop(job)) {
+            if (!job->failed) {
+                auto start = ClockType::now();
+                try {
+                    typedef itk::ImageFileWriter<OutputImageType> WriterType;
+                    WriterType::Pointer imageWriter = WriterType::New();
+                    imageWriter->SetFileName(job->outputFilename);
+                    imageWriter->SetInput(job->output);
+                    imageWriter->Update();
+                    job->writeTimeInSeconds = secondsSince(start);
+                    log(*job, "written to " + job->outputFilename);
+                } catch (std::exception &e) {
+                    job->failed = true;
+                    job->error = e.what();
+                    log(*job, "ERROR while writing: " + job->error);
+                }
+            }
+            job->image = nullptr;
+            job->foreground = nullptr;
+            job->background = nullptr;
+            job->output = nullptr;
+            budget.Release(job->estimatedMemoryInBytes);
+        }
+    });
+
+    reader.join();
+    for (auto &solver : solvers) {
+        solver.join();
+    }
+    writeQueue.Close();
+    writer.join();
+
+    writeSummary(summaryFilename, jobs);
+
+    auto numberOfFailedJobs = std::count_if(jobs.begin(), jobs.end(), [](const Job &job) { return job.failed; });
+    std::cout << "*** Done. " << jobs.size() - numberOfFailedJobs << " succeeded, " << numberOfFailedJobs
+              << " failed. Summary written to " << summaryFilename << " ***" << std::endl;
+    return numberOfFailedJobs == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,84 @@
+/**
+ *  Image GraphCut 3D Segmentation
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+ #ifndef __IOHelper_hxx_
+#define __IOHelper_hxx_
+
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionConstIterator.h>
+
+#include <string>
+
+// image IO and segmentation helpers shared by the examples and the tests
+class IOHelper {
+public:
+    template<class TImage> static typename TImage::Pointer readImage(const char *path){
+        typedef itk::ImageFileReader<TImage> TFileReader;
+        typename TFileReader::Pointer reader = TFileReader::New();
+        reader->SetFileName(path);
+        typename TImage::Pointer img = reader->GetOutput();
+        reader->Update();
+        img->DisconnectPipeline();
+        return img;
+    }
+
+    template<class TImage> static void writeImage(typename TImage::Pointer img, const char *path){
+        typedef itk::ImageFileWriter<TImage> TFileWriter;
+        typename TFileWriter::Pointer writer = TFileWriter::New();
+        writer->SetFileName(path);
+        writer->SetInput(img);
+        writer->Update();
+    }
+
+    template<class TImage> static unsigned int countDifferentVoxels(const TImage *a, const TImage *b){
+        itk::ImageRegionConstIterator<TImage> itA(a, a->GetLargestPossibleRegion());
+        itk::ImageRegionConstIterator<TImage> itB(b, b->GetLargestPossibleRegion());
+        unsigned int numberOfDifferences = 0;
+        for (; !itA.IsAtEnd() && !itB.IsAtEnd(); ++itA, ++itB) {
+            if (itA.Get() != itB.Get()) {
+                ++numberOfDifferences;
+            }
+        }
+        return numberOfDifferences;
+    }
+
+    // segments dataPath/inputName with the foregroundMask.mhd and backgroundMask.mhd of dataPath, using the settings
+    // the expected test results were generated with. configure(filter, input) may change the settings before the update.
+    template<class TFilter, class TConfigure>
+    static typename TFilter::OutputImageType::Pointer segment(const std::string &dataPath, const std::string &inputName,
+                                                              TConfigure configure){
+        typename TFilter::InputImageType::Pointer input =
+                readImage<typename TFilter::InputImageType>((dataPath + "/" + inputName).c_str());
+
+        typename TFilter::Pointer graphCutFilter = TFilter::New();
+        graphCutFilter->SetInputImage(input);
+        graphCutFilter->SetForegroundImage(
+                readImage<typename TFilter::ForegroundImageType>((dataPath + "/foregroundMask.mhd").c_str()));
+        graphCutFilter->SetBackgroundImage(
+                readImage<typename TFilter::BackgroundImageType>((dataPath + "/backgroundMask.mhd").c_str()));
+        graphCutFilter->SetForegroundPixelValue(255);
+        graphCutFilter->SetBackgroundPixelValue(0);
+        graphCutFilter->SetSigma(50.0);
+        graphCutFilter->SetBoundaryDirectionTypeToBrightDark();
+        configure(graphCutFilter.GetPointer(), input.GetPointer());
+        graphCutFilter->Update();
+
+        typename TFilter::OutputImageType::Pointer output = graphCutFilter->GetOutput();
+        output->DisconnectPipeline();
+        return output;
+    }
+
+    template<class TFilter>
+    static typename TFilter::OutputImageType::Pointer segment(const std::string &dataPath, const std::string &inputName){
+        return segment<TFilter>(dataPath, inputName, [](TFilter *, const typename TFilter::InputImageType *) {});
+    }
+};
+
+#endif
\ No newline at end of file
@@ -14,7 +14,7 @@
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/boykov_kolmogorov_max_flow.hpp>
 
-#include "ImageImageGraphCut3DKolmogorovBoostBase.h"
+#include "ImageGraphCut3DKolmogorovBoostBase.h"
 /*
  * Wraps kolmogorovs graph library
  */
@@ -54,15 +54,21 @@ namespace itk{
             typename InputImageType::SizeType dimensions;
             dimensions = this->GetInputImage()->GetLargestPossibleRegion().GetSize();
 
-            int numberOfVertices = dimensions[0] * dimensions[1] * dimensions[2];
-            int numberOfEdges = calculateNumberOfEdges(dimensions[0], dimensions[1], dimensions[2]);
+            // with a ROI only part of the voxels are nodes, each of them with at most 3 edges
+            int numberOfVertices = this->m_NumberOfNodes;
+            int numberOfEdges = std::min<int>(calculateNumberOfEdges(dimensions[0], dimensions[1], dimensions[2]),
+                                              3 * numberOfVertices);
 
             std::cout << "Number of vertices: " << numberOfVertices << ", number of edges: " << numberOfEdges << std::endl;
-            m_Graph = GraphType(numberOfVertices);
-            SOURCE = numberOfVertices - 2;
-            SINK = numberOfVertices - 1;
-            //m_Graph(numberOfVertices);
-            groups.resize(numberOfVertices);
+
+            // the terminals are the two vertices after the nodes
+            *m_Graph = GraphType(numberOfVertices + 2);
+            SOURCE = numberOfVertices;
+            SINK = numberOfVertices + 1;
+            groups.assign(numberOfVertices + 2, 0);
+            currentEdgeIndex = -1;
+            reverseEdges.clear();
+            capacity.clear();
         }
 
 
@@ -79,12 +85,13 @@ namespace itk{
             reverseEdges.push_back(reverseEdge);
             reverseEdges.push_back(edge);
             capacity.push_back(weight);
-            capacity.push_back(weight);
+            capacity.push_back(reverseWeight);
         }
 
+        // the flow goes from the source through the node to the sink
         virtual inline void addTerminalEdges(const unsigned int node, const float sourceWeight, const float sinkWeight){
-            addBidirectionalEdge(node, SOURCE, sourceWeight, sinkWeight);
-            addBidirectionalEdge(node, SINK, sinkWeight, sinkWeight);
+            addBidirectionalEdge(SOURCE, node, sourceWeight, 0);
+            addBidirectionalEdge(node, SINK, sinkWeight, 0);
         }
 
         // start the calculation
@@ -102,6 +109,15 @@ namespace itk{
                     , SINK);
         }
 
+        // copies the labels of the color map directly instead of going through the virtual groupOf()
+        virtual void CutGraph(ImageContainer images, ProgressReporter &progress){
+            const int *labels = groups.data();
+            const int sourceGroup = groupOfSource();
+            this->WriteLabelling(images, progress, [labels, sourceGroup](SizeValueType vertex) {
+                return labels[vertex] == sourceGroup;
+            });
+        }
+
         // query the resulting segmentation group of a vertex.
         virtual int inline groupOf(const unsigned int vertex) const{
             return groups.at(vertex);
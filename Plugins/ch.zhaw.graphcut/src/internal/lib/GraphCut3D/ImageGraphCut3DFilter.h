@@ -23,6 +23,9 @@
 
 // STL
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 namespace itk {
     template<typename TInput, typename TForeground, typename TBackground, typename TOutput>
@@ -44,15 +47,23 @@ namespace itk {
         typedef TForeground ForegroundImageType;
         typedef TBackground BackgroundImageType;
         typedef TOutput OutputImageType;
+        typedef TForeground RoiImageType;
 
         typedef itk::Statistics::Histogram<short, itk::Statistics::DenseFrequencyContainer2> HistogramType;
         typedef std::vector<itk::Index<3> > IndexContainerType;     // container for sinks / sources
         typedef float WeightType;
 
+        // node id of voxels outside the ROI, which are not part of the graph
+        static const unsigned int OutsideNode = 0xFFFFFFFFu;
+
         typedef enum {
             NoDirection, BrightDark, DarkBright
         } BoundaryDirectionType;
 
+        typedef enum {
+            RasterNodeOrder, MortonNodeOrder
+        } NodeOrderType;
+
         // parameter setters
         void SetSigma(double d) {
             m_Sigma = d;
@@ -70,6 +81,18 @@ namespace itk {
             m_BoundaryDirectionType = DarkBright;
         }
 
+        // number the graph nodes in raster order (default)
+        void SetNodeOrderToRaster() {
+            m_NodeOrder = RasterNodeOrder;
+        }
+
+        // number the graph nodes along a Z-order curve and insert their edges in that order, so 3D neighbours are
+        // close in the node and in the arc array. Costs a node id per voxel. GridCut uses its own blocked layout and
+        // ignores this setting.
+        void SetNodeOrderToMorton() {
+            m_NodeOrder = MortonNodeOrder;
+        }
+
         void SetForegroundPixelValue(typename OutputImageType::PixelType v) {
             m_ForegroundPixelValue = v;
         }
@@ -91,10 +114,20 @@ namespace itk {
             this->SetNthInput(2, const_cast<BackgroundImageType *>(image));
         }
 
+        // optional: only voxels with a non-zero ROI value become graph nodes, all others are labelled background
+        void SetRoiImage(const RoiImageType *image) {
+            this->SetNthInput(3, const_cast<RoiImageType *>(image));
+        }
+
 
         void SetVerboseOutput(bool b) {
             m_PrintTimer = b;
         }
+
+        // call voxelFunctor(x, y, z, offset) for the voxels of an image of the given size along a Z-order curve.
+        // The curve covers the smallest enclosing power of two cube, octants outside the image are skipped.
+        template<typename TVoxelFunctor>
+        static void ForEachVoxelInMortonOrder(const typename InputImageType::SizeType &size, TVoxelFunctor voxelFunctor);
     protected:
         struct ImageContainer {
             typename InputImageType::ConstPointer input;
@@ -103,6 +136,7 @@ namespace itk {
             typename BackgroundImageType::ConstPointer background;
             typename OutputImageType::Pointer output;
             typename InputImageType::RegionType outputRegion;
+            typename RoiImageType::ConstPointer roi;    // may be null
         };
         typedef itk::Vector<typename InputImageType::PixelType, 1> ListSampleMeasurementVectorType;
         typedef itk::Statistics::ListSample<ListSampleMeasurementVectorType> SampleType;
@@ -115,17 +149,40 @@ namespace itk {
 
         void GenerateData() override;
 
+        // the graph covers the whole image, so the whole output is generated
+        void EnlargeOutputRequestedRegion(DataObject *output) override;
+
+        // number the graph nodes according to the ROI and the node order, see m_NodeIds
+        virtual void ComputeNodeIds(const ImageContainer &images);
+
+        // call voxelFunctor(x, y, z, offset) for all voxels of the input region in the node order
+        template<typename TVoxelFunctor>
+        void ForEachVoxelInNodeOrder(const ImageContainer &images, TVoxelFunctor voxelFunctor);
+
         virtual void FillGraph(const ImageContainer, ProgressReporter &progress) = 0;
 
         virtual void SolveGraph() = 0;
 
         virtual void CutGraph(ImageContainer, ProgressReporter &progress) = 0;
 
+        // z-slabs of the output region processed by ProcessOutputSlabs, several per thread to balance the load
+        void GetOutputSlabs(const ImageContainer &images, unsigned int &slicesPerSlab, unsigned int &numberOfSlabs);
+
+        // run slabFunctor(zBegin, zEnd) on z-slabs of the output region in parallel. progress counts slabs, one
+        // CompletedPixel() is reported per slab
+        template<typename TSlabFunctor>
+        void ProcessOutputSlabs(const ImageContainer &images, ProgressReporter &progress, TSlabFunctor slabFunctor);
+
+        // write the segmentation into the linear output buffer, isSource(vertex) is queried for each vertex
+        template<typename TIsSourceFunctor>
+        void WriteLabelling(const ImageContainer &images, ProgressReporter &progress, TIsSourceFunctor isSource);
+
         // convert masks to >0 indices
         template<typename TIndexImage>
         std::vector<itk::Index<3> > getPixelsLargerThanZero(const TIndexImage *const) const;
 
-        // convert 3d itk indices to a continuously numbered indices
+        // convert 3d itk indices to a continuously numbered indices.
+        // Returns OutsideNode for voxels outside the ROI.
         unsigned int ConvertIndexToVertexDescriptor(const itk::Index<3>, typename InputImageType::RegionType);
 
         // image getters
@@ -141,16 +198,27 @@ namespace itk {
             return static_cast< const BackgroundImageType * >(this->ProcessObject::GetInput(2));
         }
 
+        const RoiImageType *GetRoiImage() {
+            return static_cast< const RoiImageType * >(this->ProcessObject::GetInput(3));
+        }
+
         // parameters
         double m_Sigma;                     // noise in boundary term
         int m_NumberOfHistogramBins;     // bins per dimension of histograms
         BoundaryDirectionType m_BoundaryDirectionType;
+        NodeOrderType m_NodeOrder;
+        std::vector<unsigned int> m_NodeIds;    // node id per voxel offset, empty without ROI in raster order
+        unsigned int m_NumberOfNodes;
         typename OutputImageType::PixelType m_ForegroundPixelValue;
         typename OutputImageType::PixelType m_BackgroundPixelValue;
         bool m_PrintTimer;
 
 
     private:
+        template<typename TVoxelFunctor>
+        static void VisitMortonOctant(const typename InputImageType::SizeType &size, unsigned int x, unsigned int y,
+                                      unsigned int z, unsigned int side, TVoxelFunctor &voxelFunctor);
+
         ImageGraphCut3DFilter(const Self &); // intentionally not implemented
         void operator=(const Self &); // intentionally not implemented
     };
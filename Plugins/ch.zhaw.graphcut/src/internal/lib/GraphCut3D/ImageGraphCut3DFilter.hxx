@@ -13,11 +13,16 @@
 #include "itkTimeProbesCollectorBase.h"
 
 namespace itk {
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    const unsigned int ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>::OutsideNode;
+
     template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
     ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
     ::ImageGraphCut3DFilter()
             : m_Sigma(5.0),
               m_BoundaryDirectionType(NoDirection),
+              m_NodeOrder(RasterNodeOrder),
+              m_NumberOfNodes(0),
               m_ForegroundPixelValue(255),
               m_BackgroundPixelValue(0),
               m_PrintTimer(false) {
@@ -43,14 +48,17 @@ namespace itk {
         images.background = GetBackgroundImage();
         images.output = this->GetOutput();
         images.outputRegion = images.output->GetRequestedRegion();
+        images.roi = GetRoiImage();
 
-        // init ITK progress reporter
+        // init ITK progress reporters
         // InitializeGraph() traverses the input image once
-        int numberOfPixelDuringInit = images.inputRegion.GetNumberOfPixels();
-        // CutGraph() traverses the output image once
-        int numberOfPixelDuringOutput = images.outputRegion.GetNumberOfPixels();
-        // since both report to the same ProgressReporter, we add the total amount of pixels
-        ProgressReporter progress(this, 0, numberOfPixelDuringInit + numberOfPixelDuringOutput);
+        SizeValueType numberOfPixelDuringInit = images.inputRegion.GetNumberOfPixels();
+        // CutGraph() traverses the output image once, in slabs
+        SizeValueType numberOfPixelDuringOutput = images.outputRegion.GetNumberOfPixels();
+        // both report to the filter progress, weighted by their amount of pixels
+        const float initWeight = numberOfPixelDuringInit /
+                                 std::max(1.0f, static_cast<float>(numberOfPixelDuringInit + numberOfPixelDuringOutput));
+        ProgressReporter progress(this, 0, numberOfPixelDuringInit, 100, 0.0f, initWeight);
 
         // allocate output
         images.output->SetBufferedRegion(images.outputRegion);
@@ -65,6 +73,10 @@ namespace itk {
         // get the total image size
         timer.Stop("ITK init");
 
+        timer.Start("Node ids");
+        ComputeNodeIds(images);
+        timer.Stop("Node ids");
+
         // create graph
         timer.Start("Graph init");
         FillGraph(images, progress);
@@ -76,7 +88,10 @@ namespace itk {
         timer.Stop("Graph cut");
 
         timer.Start("Query results");
-        CutGraph(images, progress);
+        unsigned int slicesPerSlab, numberOfSlabs;
+        GetOutputSlabs(images, slicesPerSlab, numberOfSlabs);
+        ProgressReporter slabProgress(this, 0, numberOfSlabs, 100, initWeight, 1.0f - initWeight);
+        CutGraph(images, slabProgress);
         timer.Stop("Query results");
 
         if (m_PrintTimer) {
@@ -84,6 +99,107 @@ namespace itk {
         }
     }
 
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::EnlargeOutputRequestedRegion(DataObject *output) {
+        Superclass::EnlargeOutputRequestedRegion(output);
+        output->SetRequestedRegionToLargestPossibleRegion();
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::GetOutputSlabs(const ImageContainer &images, unsigned int &slicesPerSlab, unsigned int &numberOfSlabs) {
+        const unsigned int numberOfSlices = images.outputRegion.GetSize()[2];
+        const unsigned int numberOfThreads = std::max(1u, std::min<unsigned int>(this->GetNumberOfThreads(), numberOfSlices));
+        slicesPerSlab = std::max(1u, numberOfSlices / (4 * numberOfThreads));
+        numberOfSlabs = (numberOfSlices + slicesPerSlab - 1) / slicesPerSlab;
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename TSlabFunctor>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::ProcessOutputSlabs(const ImageContainer &images, ProgressReporter &progress, TSlabFunctor slabFunctor) {
+        // the slab functors write the output buffer in the raster order of the input region, i.e. of the graph nodes
+        itkAssertOrThrowMacro(images.output->GetBufferedRegion() == images.inputRegion,
+                              "The output buffer has to cover the input region");
+
+        const unsigned int numberOfSlices = images.outputRegion.GetSize()[2];
+        if (numberOfSlices == 0) {
+            return;
+        }
+
+        unsigned int slicesPerSlab, numberOfSlabs;
+        GetOutputSlabs(images, slicesPerSlab, numberOfSlabs);
+        const unsigned int numberOfThreads = std::min<unsigned int>(std::max(1u, this->GetNumberOfThreads()), numberOfSlabs);
+
+        std::atomic<unsigned int> nextSlab(0);
+        std::atomic<unsigned int> completedSlabs(0);
+        std::atomic<bool> aborted(false);
+        auto processSlab = [&](unsigned int slab) {
+            unsigned int zBegin = slab * slicesPerSlab;
+            unsigned int zEnd = std::min(zBegin + slicesPerSlab, numberOfSlices);
+            slabFunctor(zBegin, zEnd);
+            ++completedSlabs;
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < numberOfThreads; ++i) {
+            threads.push_back(std::thread([&]() {
+                for (unsigned int slab = nextSlab++; slab < numberOfSlabs && !aborted; slab = nextSlab++) {
+                    processSlab(slab);
+                }
+            }));
+        }
+
+        // the ProgressReporter is not thread safe, so only the calling thread reports the slabs finished so far
+        unsigned int reportedSlabs = 0;
+        try {
+            for (unsigned int slab = nextSlab++; slab < numberOfSlabs; slab = nextSlab++) {
+                processSlab(slab);
+                for (unsigned int completed = completedSlabs; reportedSlabs < completed; ++reportedSlabs) {
+                    progress.CompletedPixel();
+                }
+            }
+        } catch (...) {
+            // CompletedPixel() throws if the filter was aborted
+            aborted = true;
+            for (unsigned int i = 0; i < threads.size(); ++i) {
+                threads[i].join();
+            }
+            throw;
+        }
+
+        for (unsigned int i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        for (; reportedSlabs < completedSlabs; ++reportedSlabs) {
+            progress.CompletedPixel();
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename TIsSourceFunctor>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::WriteLabelling(const ImageContainer &images, ProgressReporter &progress, TIsSourceFunctor isSource) {
+        // the output buffer covers the input region (asserted by ProcessOutputSlabs), so the buffer offset equals
+        // the raster vertex descriptor
+        typename OutputImageType::PixelType *buffer = images.output->GetBufferPointer();
+        typename OutputImageType::SizeType size = images.outputRegion.GetSize();
+        const SizeValueType pixelsPerSlice = size[0] * size[1];
+
+        const unsigned int *nodeIds = m_NodeIds.empty() ? nullptr : m_NodeIds.data();
+
+        const typename OutputImageType::PixelType foreground = m_ForegroundPixelValue;
+        const typename OutputImageType::PixelType background = m_BackgroundPixelValue;
+        ProcessOutputSlabs(images, progress, [&](unsigned int zBegin, unsigned int zEnd) {
+            const SizeValueType end = zEnd * pixelsPerSlice;
+            for (SizeValueType offset = zBegin * pixelsPerSlice; offset < end; ++offset) {
+                SizeValueType vertex = nodeIds ? nodeIds[offset] : offset;
+                buffer[offset] = vertex != OutsideNode && isSource(vertex) ? foreground : background;
+            }
+        });
+    }
+
     template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
     template<typename TIndexImage>
     std::vector<itk::Index<3> > ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
@@ -106,7 +222,115 @@ namespace itk {
     ::ConvertIndexToVertexDescriptor(const itk::Index<3> index, typename TImage::RegionType region) {
         typename TImage::SizeType size = region.GetSize();
 
-        return index[0] + index[1] * size[0] + index[2] * size[0] * size[1];
+        unsigned int offset = index[0] + index[1] * size[0] + index[2] * size[0] * size[1];
+        return m_NodeIds.empty() ? offset : m_NodeIds[offset];
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::ComputeNodeIds(const ImageContainer &images) {
+        const SizeValueType numberOfVoxels = images.inputRegion.GetNumberOfPixels();
+
+        m_NodeIds.clear();
+        m_NumberOfNodes = numberOfVoxels;
+        if (images.roi.IsNull()) {
+            if (m_NodeOrder == MortonNodeOrder) {
+                m_NodeIds.assign(numberOfVoxels, 0);
+                unsigned int nextId = 0;
+                ForEachVoxelInMortonOrder(images.inputRegion.GetSize(), [&](unsigned int, unsigned int, unsigned int,
+                                                                            SizeValueType offset) {
+                    m_NodeIds[offset] = nextId++;
+                });
+            }
+            return;
+        }
+
+        // only ROI voxels become nodes. They are numbered continuously in raster order.
+        // Voxels outside the ROI are background, so foreground seeds there contradict the ROI and are counted.
+        m_NodeIds.resize(numberOfVoxels);
+        unsigned int nextId = 0;
+        SizeValueType foregroundOutsideRoi = 0;
+        itk::ImageRegionConstIterator<RoiImageType> roiIterator(images.roi, images.inputRegion);
+        itk::ImageRegionConstIterator<ForegroundImageType> foregroundIterator(images.foreground, images.inputRegion);
+        for (SizeValueType offset = 0; !roiIterator.IsAtEnd(); ++roiIterator, ++foregroundIterator, ++offset) {
+            if (roiIterator.Get() > itk::NumericTraits<typename RoiImageType::PixelType>::Zero) {
+                m_NodeIds[offset] = nextId++;
+            } else {
+                m_NodeIds[offset] = OutsideNode;
+                if (foregroundIterator.Get() > itk::NumericTraits<typename ForegroundImageType::PixelType>::Zero) {
+                    ++foregroundOutsideRoi;
+                }
+            }
+        }
+        m_NumberOfNodes = nextId;
+
+        // renumber the ROI nodes along the curve, the voxels outside keep OutsideNode
+        if (m_NodeOrder == MortonNodeOrder) {
+            nextId = 0;
+            ForEachVoxelInMortonOrder(images.inputRegion.GetSize(), [&](unsigned int, unsigned int, unsigned int,
+                                                                        SizeValueType offset) {
+                if (m_NodeIds[offset] != OutsideNode) {
+                    m_NodeIds[offset] = nextId++;
+                }
+            });
+        }
+
+        if (foregroundOutsideRoi > 0) {
+            itkWarningMacro(<< foregroundOutsideRoi << " foreground seeds lie outside the ROI, they are segmented as background");
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename TVoxelFunctor>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::ForEachVoxelInNodeOrder(const ImageContainer &images, TVoxelFunctor voxelFunctor) {
+        typename InputImageType::SizeType size = images.inputRegion.GetSize();
+        if (m_NodeOrder == MortonNodeOrder) {
+            ForEachVoxelInMortonOrder(size, voxelFunctor);
+            return;
+        }
+
+        SizeValueType offset = 0;
+        for (unsigned int z = 0; z < size[2]; ++z) {
+            for (unsigned int y = 0; y < size[1]; ++y) {
+                for (unsigned int x = 0; x < size[0]; ++x, ++offset) {
+                    voxelFunctor(x, y, z, offset);
+                }
+            }
+        }
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename TVoxelFunctor>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::ForEachVoxelInMortonOrder(const typename InputImageType::SizeType &size, TVoxelFunctor voxelFunctor) {
+        unsigned int side = 1;
+        while (side < size[0] || side < size[1] || side < size[2]) {
+            side *= 2;
+        }
+        VisitMortonOctant(size, 0, 0, 0, side, voxelFunctor);
+    }
+
+    template<typename TImage, typename TForeground, typename TBackground, typename TOutput>
+    template<typename TVoxelFunctor>
+    void ImageGraphCut3DFilter<TImage, TForeground, TBackground, TOutput>
+    ::VisitMortonOctant(const typename InputImageType::SizeType &size, unsigned int x, unsigned int y, unsigned int z,
+                        unsigned int side, TVoxelFunctor &voxelFunctor) {
+        if (x >= size[0] || y >= size[1] || z >= size[2]) {
+            return;
+        }
+
+        if (side == 1) {
+            voxelFunctor(x, y, z, x + y * size[0] + z * static_cast<SizeValueType>(size[0]) * size[1]);
+            return;
+        }
+
+        // visit the octants in Z-order: x varies fastest, then y, then z
+        unsigned int half = side / 2;
+        for (unsigned int octant = 0; octant < 8; ++octant) {
+            VisitMortonOctant(size, x + (octant & 1) * half, y + ((octant >> 1) & 1) * half,
+                              z + ((octant >> 2) & 1) * half, half, voxelFunctor);
+        }
     }
 }
 
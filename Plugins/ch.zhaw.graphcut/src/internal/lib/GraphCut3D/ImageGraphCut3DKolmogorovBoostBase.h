@@ -29,6 +29,7 @@ namespace itk{
 		typedef typename SuperClass::ForegroundImageType ForegroundImageType;
 		typedef typename SuperClass::BackgroundImageType BackgroundImageType;
 		typedef typename SuperClass::OutputImageType OutputImageType;
+		typedef typename SuperClass::RoiImageType RoiImageType;
 		typedef typename SuperClass::IndexContainerType IndexContainerType;     // container for sinks / sources
 		typedef typename SuperClass::WeightType WeightType;
 
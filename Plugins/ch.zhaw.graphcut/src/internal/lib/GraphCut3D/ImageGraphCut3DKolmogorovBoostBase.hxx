@@ -30,45 +30,36 @@ namespace itk{
         IndexContainerType sources = this->template getPixelsLargerThanZero<ForegroundImageType>(images.foreground);
         IndexContainerType sinks = this->template getPixelsLargerThanZero<BackgroundImageType>(images.background);
 
-        // We are only using a 6-connected structure, so the kernel (iteration neighborhood) must only be 3x3x3
-        // (specified by a radius of 1)
-        itk::Size<3> radius;
-        radius.Fill(1);
-
-        typedef itk::ConstShapedNeighborhoodIterator<InputImageType> IteratorType;
-
-        // Traverses the image adding the following bidirectional edges:
+        // Visits the voxels in the node order (see SetNodeOrderToMorton()), so the edges are inserted in that order,
+        // adding the following bidirectional edges:
         // 1. currentPixel <-> pixel below it
         // 2. currentPixel <-> pixel to the right of it
         // 3. currentPixel <-> pixel in front of it
         // This prevents duplicate edges (i.e. we cannot add an edge to all 6-connected neighbors of every pixel or
         // almost every edge would be duplicated.
-        std::vector<typename IteratorType::OffsetType> neighbors;
-        typename IteratorType::OffsetType bottom = {{0, 1, 0}};
-        neighbors.push_back(bottom);
-        typename IteratorType::OffsetType right = {{1, 0, 0}};
-        neighbors.push_back(right);
-        typename IteratorType::OffsetType front = {{0, 0, 1}};
-        neighbors.push_back(front);
-
-        typename IteratorType::OffsetType center = {{0, 0, 0}};
-
-        IteratorType iterator(radius, images.input, images.input->GetLargestPossibleRegion());
-        iterator.ClearActiveList();
-        iterator.ActivateOffset(bottom);
-        iterator.ActivateOffset(right);
-        iterator.ActivateOffset(front);
-        iterator.ActivateOffset(center);
-
-        for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator) {
-            typename InputImageType::PixelType centerPixel = iterator.GetPixel(center);
-
-            for (unsigned int i = 0; i < neighbors.size(); i++) {
-                bool pixelIsValid;
-                typename InputImageType::PixelType neighborPixel  = iterator.GetPixel(neighbors[i], pixelIsValid);
+        itkAssertOrThrowMacro(images.input->GetBufferedRegion() == images.inputRegion,
+                              "The input buffer has to cover the input region");
+        const typename InputImageType::PixelType *input = images.input->GetBufferPointer();
+        const typename InputImageType::SizeType size = images.inputRegion.GetSize();
+        const SizeValueType pixelsPerSlice = size[0] * size[1];
+
+        this->ForEachVoxelInNodeOrder(images, [&](unsigned int x, unsigned int y, unsigned int z, SizeValueType offset) {
+            const bool neighborIsValid[3] = {y + 1 < size[1], x + 1 < size[0], z + 1 < size[2]};
+            const SizeValueType neighborOffset[3] = {offset + size[0], offset + 1, offset + pixelsPerSlice};
 
+            typename InputImageType::PixelType centerPixel = input[offset];
+            unsigned int nodeIndex1 = this->m_NodeIds.empty() ? offset : this->m_NodeIds[offset];
+
+            for (unsigned int i = 0; i < 3; i++) {
                 // If the current neighbor is outside the image, skip it
-                if (!pixelIsValid) {
+                if (!neighborIsValid[i]) {
+                    continue;
+                }
+                typename InputImageType::PixelType neighborPixel = input[neighborOffset[i]];
+
+                // If both pixels are outside the ROI, the edge is not part of the graph
+                unsigned int nodeIndex2 = this->m_NodeIds.empty() ? neighborOffset[i] : this->m_NodeIds[neighborOffset[i]];
+                if (nodeIndex1 == SuperClass::OutsideNode && nodeIndex2 == SuperClass::OutsideNode) {
                     continue;
                 }
 
@@ -76,36 +67,47 @@ namespace itk{
                 double weight = exp(-pow(centerPixel - neighborPixel, 2) / (2.0 * this->m_Sigma * this->m_Sigma));
                 assert(weight >= 0);
 
-                // Add the edge to the graph
-                unsigned int nodeIndex1 = this->ConvertIndexToVertexDescriptor(iterator.GetIndex(center), images.inputRegion);
-                unsigned int nodeIndex2 = this->ConvertIndexToVertexDescriptor(iterator.GetIndex(neighbors[i]), images.inputRegion);
-
                 //Determine which direction is used
+                float forwardWeight = weight;
+                float reverseWeight = weight;
                 if (this->m_BoundaryDirectionType == SuperClass::BrightDark) {
                     if (centerPixel > neighborPixel)
-                        addBidirectionalEdge(nodeIndex1, nodeIndex2, weight, 1.0);
+                        reverseWeight = 1.0;
                     else
-                        addBidirectionalEdge(nodeIndex1, nodeIndex2, 1.0, weight);
+                        forwardWeight = 1.0;
                 } else if (this->m_BoundaryDirectionType == SuperClass::DarkBright) {
                     if (centerPixel > neighborPixel)
-                        addBidirectionalEdge(nodeIndex1, nodeIndex2, 1.0, weight);
+                        forwardWeight = 1.0;
                     else
-                        addBidirectionalEdge(nodeIndex1, nodeIndex2, weight, 1.0);
+                        reverseWeight = 1.0;
+                }
+
+                // Add the edge to the graph. Pixels outside the ROI are background, so an edge to such a pixel
+                // becomes a sink connection of the pixel inside the ROI.
+                if (nodeIndex2 == SuperClass::OutsideNode) {
+                    addTerminalEdges(nodeIndex1, 0, forwardWeight);
+                } else if (nodeIndex1 == SuperClass::OutsideNode) {
+                    addTerminalEdges(nodeIndex2, 0, reverseWeight);
                 } else {
-                    addBidirectionalEdge(nodeIndex1, nodeIndex2, weight, weight);
+                    addBidirectionalEdge(nodeIndex1, nodeIndex2, forwardWeight, reverseWeight);
                 }
             }
             progress.CompletedPixel();
-        }
+        });
 
-        // set the terminal connection capacity to max float
+        // set the terminal connection capacity to max float. Seeds outside the ROI have no node, they are background
+        // (foreground seeds there are reported by ComputeNodeIds)
         for (unsigned int i = 0; i < sources.size(); i++) {
             unsigned int sourceIndex = this->ConvertIndexToVertexDescriptor(sources[i], images.inputRegion);
-            addTerminalEdges(sourceIndex, std::numeric_limits<float>::max(), 0);
+            if (sourceIndex != SuperClass::OutsideNode) {
+                addTerminalEdges(sourceIndex, std::numeric_limits<float>::max(), 0);
+            }
         }
         for (unsigned int i = 0; i < sinks.size(); i++) {
             unsigned int sinkIndex = this->ConvertIndexToVertexDescriptor(sinks[i], images.inputRegion);
-            addTerminalEdges(sinkIndex, 0, std::numeric_limits<float>::max());
+            if (sinkIndex != SuperClass::OutsideNode) {
+                addTerminalEdges(sinkIndex, 0, std::numeric_limits<float>::max());
+            }
         }
 	};
 
@@ -113,25 +115,14 @@ namespace itk{
 	void ImageGraphCut3DKolmogorovBoostBase<TImage, TForeground, TBackground, TOutput>
 	::CutGraph(ImageContainer images, ProgressReporter &progress){
 
-        // Iterate over the output image, querying the graph for the association of each pixel
-        itk::ImageRegionIterator<OutputImageType> outputImageIterator(images.output, images.outputRegion);
-        outputImageIterator.GoToBegin();
-
-        int sourceGroup = groupOfSource();
-        while (!outputImageIterator.IsAtEnd()) {
-            unsigned int voxelIndex = this->ConvertIndexToVertexDescriptor(outputImageIterator.GetIndex(), images.outputRegion);
-            if (groupOf(voxelIndex) == sourceGroup) {
-                outputImageIterator.Set(this->m_ForegroundPixelValue);
-            }
-                // Libraries differ to some degree in how they define the terminal groups. however, the tested ones
-                // (kolmogorvs MAXFLOW, boost graph, IBFS) use a fixed value for the source group and define other
-                // values as background.
-            else {
-                outputImageIterator.Set(this->m_BackgroundPixelValue);
-            }
-            ++outputImageIterator;
-            progress.CompletedPixel();
-        }
+        // Query the graph for the association of each pixel, slabs of the output are processed in parallel.
+        // Libraries differ to some degree in how they define the terminal groups. however, the tested ones
+        // (kolmogorvs MAXFLOW, boost graph, IBFS) use a fixed value for the source group and define other
+        // values as background.
+        const int sourceGroup = groupOfSource();
+        this->WriteLabelling(images, progress, [this, sourceGroup](SizeValueType vertex) {
+            return groupOf(vertex) == sourceGroup;
+        });
 	};
 
 };
@@ -10,14 +10,91 @@
 #ifndef __ImageGraphCut3DKolmogorovFilter_h_
 #define __ImageGraphCut3DKolmogorovFilter_h_
 
+#include <algorithm>
+#include <limits>
+
 #include "lib/kolmogorov-3.03/graph.h"
 #include "ImageGraphCut3DKolmogorovBoostBase.h"
 /*
  * Wraps kolmogorovs graph library
  */
 namespace itk{
+    /*
+     * Capacity representation of the Kolmogorov graph, selected by the TCapacity template argument of the filter.
+     *
+     * The boundary term exp(-(Ip - Iq)^2 / (2 sigma^2)) lies in [0, 1]. Integer capacity types store it quantised as
+     * round(w * Scale). Scale is chosen such that an arc and its sister, whose residual capacities always add up to
+     * cap + rev_cap <= 2 * Scale, can not overflow the capacity type.
+     * Hard seeds are connected to their terminal with Infinity = 6 * Scale + 1. This exceeds the summed capacity of the
+     * 6 n-links of any node, so a seed t-link is never part of a minimal cut, and it is small enough that terminal
+     * capacities can be accumulated without overflow. Terminal capacities (which store the signed difference between
+     * source and sink capacity) and the flow use wider signed types.
+     *
+     * Note that on 64bit platforms an arc holds 3 pointers, so 16bit capacities mostly save arithmetic, not memory.
+     */
+    template<typename TCapacity>
+    struct KolmogorovCapacityTraits;
+
+    template<>
+    struct KolmogorovCapacityTraits<float> {
+        typedef float CapacityType;
+        typedef float TerminalCapacityType;
+        typedef float FlowType;
+
+        static CapacityType Quantize(double weight) {
+            return weight;
+        }
+
+        static TerminalCapacityType QuantizeTerminal(float weight) {
+            return weight;
+        }
+
+        static TerminalCapacityType Infinity() {
+            return std::numeric_limits<float>::max();
+        }
+    };
+
+    template<typename TCapacity, typename TTerminalCapacity, typename TFlow, TCapacity TScale>
+    struct KolmogorovIntegerCapacityTraits {
+        typedef TCapacity CapacityType;
+        typedef TTerminalCapacity TerminalCapacityType;
+        typedef TFlow FlowType;
+
+        static const TCapacity Scale = TScale;
+
+        static CapacityType Quantize(double weight) {
+            return static_cast<CapacityType>(std::min(std::max(weight, 0.0), 1.0) * Scale + 0.5);
+        }
+
+        // the filter marks hard seeds with std::numeric_limits<float>::max()
+        static TerminalCapacityType QuantizeTerminal(float weight) {
+            if (weight >= std::numeric_limits<float>::max()) {
+                return Infinity();
+            }
+            return static_cast<TerminalCapacityType>(std::min<double>(std::max(weight, 0.0f) * Scale + 0.5, Infinity()));
+        }
+
+        static TerminalCapacityType Infinity() {
+            return 6 * static_cast<TerminalCapacityType>(Scale) + 1;
+        }
+    };
+
+    template<typename TCapacity, typename TTerminalCapacity, typename TFlow, TCapacity TScale>
+    const TCapacity KolmogorovIntegerCapacityTraits<TCapacity, TTerminalCapacity, TFlow, TScale>::Scale;
+
+    // cap + rev_cap <= 2 * 32767 fits into 16 bit
+    template<>
+    struct KolmogorovCapacityTraits<unsigned short> : KolmogorovIntegerCapacityTraits<unsigned short, int, long long, 32767> {
+    };
+
+    // 20 bit resolution, leaves enough headroom for Infinity in the terminal capacities
+    template<>
+    struct KolmogorovCapacityTraits<int> : KolmogorovIntegerCapacityTraits<int, int, long long, (1 << 20)> {
+    };
+
     //! GraphCut solver using Yuri Boykov and Vladimir Kolmogorovs MAXFLOW implementation
-	template<typename TInput, typename TForeground, typename TBackground, typename TOutput>
+    //! TCapacity selects the edge capacity representation: float (default), unsigned short or int (quantised)
+	template<typename TInput, typename TForeground, typename TBackground, typename TOutput, typename TCapacity = float>
 	class ImageGraphCut3DKolmogorovFilter : public ImageGraphCut3DKolmogorovBoostBase<TInput, TForeground, TBackground, TOutput>{
 	public:
 		// ITK related defaults
@@ -38,15 +115,20 @@ namespace itk{
         typedef typename SuperClass::WeightType WeightType;
 
         typedef typename SuperClass::ImageContainer ImageContainer;
-		typedef Graph<WeightType , WeightType , WeightType> GraphType;
+		typedef KolmogorovCapacityTraits<TCapacity> CapacityTraits;
+		typedef Graph<typename CapacityTraits::CapacityType,
+		              typename CapacityTraits::TerminalCapacityType,
+		              typename CapacityTraits::FlowType> GraphType;
 
         virtual void InitializeGraph(const ImageContainer) override
         {
             typename InputImageType::SizeType dimensions;
             dimensions = this->GetInputImage()->GetLargestPossibleRegion().GetSize();
 
-            int numberOfVertices = dimensions[0] * dimensions[1] * dimensions[2];
-            int numberOfEdges = calculateNumberOfEdges(dimensions[0], dimensions[1], dimensions[2]);
+            // with a ROI only part of the voxels are nodes, each of them with at most 3 edges
+            int numberOfVertices = this->m_NumberOfNodes;
+            int numberOfEdges = std::min<int>(calculateNumberOfEdges(dimensions[0], dimensions[1], dimensions[2]),
+                                              3 * numberOfVertices);
 
             std::cout << "Number of vertices: " << numberOfVertices << ", number of edges: " << numberOfEdges << std::endl;
 
@@ -57,11 +139,11 @@ namespace itk{
 
         // boykov_kolmogorov_max_flow requires all edges to have a reverse edge.
         virtual inline void addBidirectionalEdge(const unsigned int source, const unsigned int target, const float weight, const float reverseWeight) override {
-            m_Graph->add_edge(source, target, weight, reverseWeight);
+            m_Graph->add_edge(source, target, CapacityTraits::Quantize(weight), CapacityTraits::Quantize(reverseWeight));
         }
 
         virtual inline void addTerminalEdges(const unsigned int node, const float sourceWeight, const float sinkWeight) override{
-            m_Graph->add_tweights(node, sourceWeight, sinkWeight);
+            m_Graph->add_tweights(node, CapacityTraits::QuantizeTerminal(sourceWeight), CapacityTraits::QuantizeTerminal(sinkWeight));
         }
 
         // start the calculation
@@ -69,6 +151,14 @@ namespace itk{
             m_Graph->maxflow();
         }
 
+        // reads the node labels directly instead of going through the virtual groupOf()
+        virtual void CutGraph(ImageContainer images, ProgressReporter &progress) override {
+            GraphType *graph = m_Graph;
+            this->WriteLabelling(images, progress, [graph](SizeValueType vertex) {
+                return graph->what_segment(vertex) == GraphType::SOURCE;
+            });
+        }
+
         // query the resulting segmentation group of a vertex.
         virtual int inline groupOf(const unsigned int vertex) const override{
             return (short) m_Graph->what_segment(vertex);
@@ -32,6 +32,7 @@ public:
     typedef typename SuperClass::ForegroundImageType ForegroundImageType;
     typedef typename SuperClass::BackgroundImageType BackgroundImageType;
     typedef typename SuperClass::OutputImageType OutputImageType;
+    typedef typename SuperClass::RoiImageType RoiImageType;
     typedef typename SuperClass::IndexContainerType IndexContainerType;     // container for sinks / sources
     typedef typename SuperClass::WeightType WeightType;
 
@@ -39,6 +40,10 @@ public:
     typedef typename std::vector< std::vector<WeightType > > CapacityType;
     typedef GridGraph_3D_6C_MT<WeightType,WeightType,WeightType> GraphType;
 
+    // GridCut works on the full grid with its own blocked node layout, voxels outside the ROI are fixed to the sink
+    virtual void ComputeNodeIds(const ImageContainer &) override {
+    }
+
 	virtual void FillGraph(const ImageContainer, ProgressReporter &progress) override;
     virtual void SolveGraph() override {
         m_Graph->compute_maxflow();
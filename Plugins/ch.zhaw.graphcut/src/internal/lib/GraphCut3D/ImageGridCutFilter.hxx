@@ -79,6 +79,7 @@ namespace itk {
 
         CapacityType capacities(neighbors.size() + 2, std::vector<WeightType>(nGraphNodes, 0));
         unsigned int iVoxel(0);
+        SizeValueType foregroundOutsideRoi = 0;
         for (iterator.GoToBegin(); !iterator.IsAtEnd(); ++iterator, ++iVoxel) {
             typename InputImageType::PixelType centerPixel = iterator.GetPixel(center);
             // Add the edge to the graph
@@ -89,6 +90,13 @@ namespace itk {
                 capacities[0][iVoxel] =  std::numeric_limits<float>::max();
             if (images.background->GetPixel(currentNodeIndex) > itk::NumericTraits<typename BackgroundImageType::PixelType>::Zero)
                 capacities[1][iVoxel] =  std::numeric_limits<float>::max();
+            // Voxels outside the ROI are background, foreground seeds there are overridden and counted
+            if (images.roi.IsNotNull() && images.roi->GetPixel(currentNodeIndex) == itk::NumericTraits<typename RoiImageType::PixelType>::Zero) {
+                if (capacities[0][iVoxel] > 0)
+                    ++foregroundOutsideRoi;
+                capacities[0][iVoxel] = 0;
+                capacities[1][iVoxel] =  std::numeric_limits<float>::max();
+            }
 
             for (unsigned int i = 0; i < neighbors.size(); i++) {
                 bool pixelIsValid;
@@ -128,6 +136,9 @@ namespace itk {
             }
             progress.CompletedPixel();
         }
+        if (foregroundOutsideRoi > 0) {
+            itkWarningMacro(<< foregroundOutsideRoi << " foreground seeds lie outside the ROI, they are segmented as background");
+        }
 
         SetCapacities(capacities[0].data(),
                              capacities[1].data(),
@@ -143,25 +154,27 @@ namespace itk {
     void ImageGridCutFilter <TImage, TForeground, TBackground, TOutput>
     ::CutGraph(ImageContainer images, ProgressReporter &progress){
 
-        // Iterate over the output image, querying the graph for the association of each pixel
-        itk::ImageRegionIterator<OutputImageType> outputImageIterator(images.output, images.outputRegion);
-        outputImageIterator.GoToBegin();
-
-        int sourceGroup = groupOfSource();
-        while (!outputImageIterator.IsAtEnd()) {
-            itk::Index<3> voxelIndex = outputImageIterator.GetIndex();
-            if (groupOf(voxelIndex[0], voxelIndex[1], voxelIndex[2]) == sourceGroup) {
-                outputImageIterator.Set(this->m_ForegroundPixelValue);
-            }
-                // Libraries differ to some degree in how they define the terminal groups. however, the tested ones
-                // (kolmogorvs MAXFLOW, boost graph, IBFS) use a fixed value for the source group and define other
-                // values as background.
-            else {
-                outputImageIterator.Set(this->m_BackgroundPixelValue);
+        // Query the graph for the association of each pixel, slabs of the output are processed in parallel.
+        // Libraries differ to some degree in how they define the terminal groups. however, the tested ones
+        // (kolmogorvs MAXFLOW, boost graph, IBFS) use a fixed value for the source group and define other
+        // values as background.
+        typename OutputImageType::PixelType *buffer = images.output->GetBufferPointer();
+        typename OutputImageType::SizeType size = images.outputRegion.GetSize();
+        const typename OutputImageType::PixelType foreground = this->m_ForegroundPixelValue;
+        const typename OutputImageType::PixelType background = this->m_BackgroundPixelValue;
+        const int sourceGroup = groupOfSource();
+        GraphType *graph = m_Graph;
+
+        this->ProcessOutputSlabs(images, progress, [&](unsigned int zBegin, unsigned int zEnd) {
+            typename OutputImageType::PixelType *voxel = buffer + zBegin * size[0] * size[1];
+            for (unsigned int z = zBegin; z < zEnd; ++z) {
+                for (unsigned int y = 0; y < size[1]; ++y) {
+                    for (unsigned int x = 0; x < size[0]; ++x, ++voxel) {
+                        *voxel = graph->get_segment(graph->node_id(x, y, z)) == sourceGroup ? foreground : background;
+                    }
+                }
             }
-            ++outputImageIterator;
-            progress.CompletedPixel();
-        }
+        });
     }
 }
 #endif //__ImageGridCutFilter_hxx_
@@ -0,0 +1,90 @@
+/**
+ *  Image GraphCut 3D Segmentation
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+ #include <gtest/gtest.h>
+
+// ITK
+#include <itkImage.h>
+
+#include "IOHelper.hxx"
+#include "ImageGraphCut3DKolmogorovFilter.hxx"
+
+// Runs the quantised integer capacity variants of the Kolmogorov filter and compares them to the float variant.
+template<typename TCapacity>
+class TestKolmogorovCapacity : public ::testing::Test {
+protected:
+    // image types
+    typedef itk::Image<short, 3> TInput;
+    typedef itk::Image<unsigned int, 3> TMask;
+    typedef TMask TForeground;
+    typedef TMask TBackground;
+    typedef TMask TOutput;
+
+    // graphcut
+    typedef itk::ImageGraphCut3DKolmogorovFilter<TInput, TForeground, TBackground, TOutput> FloatFilterType;
+    typedef itk::ImageGraphCut3DKolmogorovFilter<TInput, TForeground, TBackground, TOutput, TCapacity> QuantisedFilterType;
+    typedef itk::KolmogorovCapacityTraits<TCapacity> CapacityTraits;
+
+    template<typename TFilter>
+    TOutput::Pointer segment(const std::string &dataPath, const std::string &inputName, bool brightDark) {
+        return IOHelper::segment<TFilter>(dataPath, inputName, [brightDark](TFilter *filter, const TInput *) {
+            if (!brightDark) {
+                filter->SetBoundaryDirectionTypeToNoDirection();
+            }
+        });
+    }
+
+    // brightDark is the setting the expected results were generated with
+    void compareToFloat(std::string dataPath, std::string inputName, bool brightDark) {
+        TOutput::Pointer floatResult = segment<FloatFilterType>(dataPath, inputName, brightDark);
+        TOutput::Pointer quantisedResult = segment<QuantisedFilterType>(dataPath, inputName, brightDark);
+        ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(floatResult, quantisedResult));
+
+        if (brightDark) {
+            TOutput::Pointer expectedResult = IOHelper::readImage<TOutput>((dataPath + "/expectedResult.mhd").c_str());
+            ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(expectedResult, quantisedResult));
+        }
+    }
+};
+
+typedef ::testing::Types<unsigned short, int> QuantisedCapacityTypes;
+TYPED_TEST_CASE(TestKolmogorovCapacity, QuantisedCapacityTypes);
+
+TYPED_TEST(TestKolmogorovCapacity, Quantisation){
+    typedef typename TestFixture::CapacityTraits Traits;
+
+    ASSERT_EQ(0, Traits::Quantize(0.0));
+    ASSERT_EQ(Traits::Scale, Traits::Quantize(1.0));
+    ASSERT_EQ(Traits::Scale, Traits::Quantize(2.0)); // clamped
+    ASSERT_EQ(0, Traits::Quantize(-1.0)); // clamped
+
+    // an arc and its sister never exceed the capacity type
+    ASSERT_LE(2.0 * Traits::Scale, std::numeric_limits<TypeParam>::max());
+
+    // hard seeds dominate all 6 n-links of a node
+    ASSERT_GT(Traits::Infinity(), 6 * static_cast<typename Traits::TerminalCapacityType>(Traits::Scale));
+    ASSERT_EQ(Traits::Infinity(), Traits::QuantizeTerminal(std::numeric_limits<float>::max()));
+    ASSERT_EQ(0, Traits::QuantizeTerminal(0));
+}
+
+TYPED_TEST(TestKolmogorovCapacity, MiniTest){
+    this->compareToFloat("data/test/3x3x3", "input.mhd", true);
+}
+
+TYPED_TEST(TestKolmogorovCapacity, Cube){
+    this->compareToFloat("data/test/cube10x10x10", "cube.mhd", true);
+}
+
+TYPED_TEST(TestKolmogorovCapacity, CubeWithNoise){
+    this->compareToFloat("data/test/cube10x10x10", "cubeNoisy_0p01.mhd", true);
+}
+
+TYPED_TEST(TestKolmogorovCapacity, CubeNoDirection){
+    this->compareToFloat("data/test/cube10x10x10", "cubeNoisy_0p01.mhd", false);
+}
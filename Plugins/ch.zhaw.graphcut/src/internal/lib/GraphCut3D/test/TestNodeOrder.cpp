@@ -0,0 +1,119 @@
+/**
+ *  Image GraphCut 3D Segmentation
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+ #include <gtest/gtest.h>
+
+// ITK
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+// STL
+#include <algorithm>
+#include <vector>
+
+#include "IOHelper.hxx"
+#include "ImageGraphCut3DKolmogorovFilter.hxx"
+
+class TestNodeOrder : public ::testing::Test {
+protected:
+    // image types
+    typedef itk::Image<short, 3> TInput;
+    typedef itk::Image<unsigned int, 3> TMask;
+    typedef TMask TForeground;
+    typedef TMask TBackground;
+    typedef TMask TOutput;
+
+    // graphcut
+    typedef itk::ImageGraphCut3DKolmogorovFilter<TInput, TForeground, TBackground, TOutput> GraphCutFilterType;
+
+    // voxel offsets in the order the Z-order curve visits them
+    std::vector<itk::SizeValueType> mortonOrder(const TInput::SizeType &size) {
+        std::vector<itk::SizeValueType> offsets;
+        GraphCutFilterType::ForEachVoxelInMortonOrder(size, [&](unsigned int x, unsigned int y, unsigned int z,
+                                                                itk::SizeValueType offset) {
+            EXPECT_EQ(x + y * size[0] + z * size[0] * size[1], offset);
+            offsets.push_back(offset);
+        });
+        return offsets;
+    }
+
+    // ROI containing all voxels with a distance of at least margin to the image border
+    TMask::Pointer createRoi(const TInput *input, unsigned int margin) {
+        TMask::Pointer roi = TMask::New();
+        roi->CopyInformation(input);
+        roi->SetRegions(input->GetLargestPossibleRegion());
+        roi->Allocate();
+
+        TInput::SizeType size = input->GetLargestPossibleRegion().GetSize();
+        itk::ImageRegionIteratorWithIndex<TMask> it(roi, roi->GetLargestPossibleRegion());
+        for (; !it.IsAtEnd(); ++it) {
+            bool inside = true;
+            for (unsigned int d = 0; d < 3; ++d) {
+                unsigned int index = it.GetIndex()[d];
+                inside = inside && index >= margin && index + margin < size[d];
+            }
+            it.Set(inside ? 1 : 0);
+        }
+        return roi;
+    }
+
+    TOutput::Pointer segment(const std::string &dataPath, const std::string &inputName, bool morton,
+                             unsigned int roiMargin = 0) {
+        return IOHelper::segment<GraphCutFilterType>(dataPath, inputName, [&](GraphCutFilterType *filter, const TInput *input) {
+            if (morton) {
+                filter->SetNodeOrderToMorton();
+            }
+            if (roiMargin > 0) {
+                filter->SetRoiImage(createRoi(input, roiMargin));
+            }
+        });
+    }
+};
+
+TEST_F(TestNodeOrder, MortonOrderVisitsEachVoxelOnce){
+    TInput::SizeType size = {{5, 3, 7}};
+    std::vector<itk::SizeValueType> offsets = mortonOrder(size);
+    ASSERT_EQ(5u * 3u * 7u, offsets.size());
+
+    std::sort(offsets.begin(), offsets.end());
+    for (unsigned int i = 0; i < offsets.size(); ++i) {
+        ASSERT_EQ(i, offsets[i]);
+    }
+}
+
+TEST_F(TestNodeOrder, MortonOrderFollowsZOrder){
+    TInput::SizeType size = {{8, 8, 8}};
+    std::vector<itk::SizeValueType> offsets = mortonOrder(size);
+
+    // offset = x + 8 * y + 64 * z
+    ASSERT_EQ(0u, offsets[0]);
+    ASSERT_EQ(1u, offsets[1]);      // (1, 0, 0)
+    ASSERT_EQ(8u, offsets[2]);      // (0, 1, 0)
+    ASSERT_EQ(64u, offsets[4]);     // (0, 0, 1)
+    ASSERT_EQ(73u, offsets[7]);     // (1, 1, 1)
+    ASSERT_EQ(2u, offsets[8]);      // (2, 0, 0) starts the second 2x2x2 block
+}
+
+TEST_F(TestNodeOrder, MiniTest){
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(segment("data/test/3x3x3", "input.mhd", false),
+                                                          segment("data/test/3x3x3", "input.mhd", true)));
+}
+
+TEST_F(TestNodeOrder, CubeWithNoise){
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(segment("data/test/cube10x10x10", "cubeNoisy_0p01.mhd", false),
+                                                          segment("data/test/cube10x10x10", "cubeNoisy_0p01.mhd", true)));
+}
+
+// only the ROI voxels are numbered along the curve
+TEST_F(TestNodeOrder, CubeWithRoi){
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(segment("data/test/cube10x10x10", "cubeNoisy_0p01.mhd", false, 1),
+                                                          segment("data/test/cube10x10x10", "cubeNoisy_0p01.mhd", true, 1)));
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(segment("data/test/cube10x10x10", "cube.mhd", false, 4),
+                                                          segment("data/test/cube10x10x10", "cube.mhd", true, 4)));
+}
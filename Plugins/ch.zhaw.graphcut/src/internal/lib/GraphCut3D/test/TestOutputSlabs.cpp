@@ -0,0 +1,81 @@
+/**
+ *  Image GraphCut 3D Segmentation
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+ #include <gtest/gtest.h>
+
+// ITK
+#include <itkImage.h>
+
+#include "IOHelper.hxx"
+#include "ImageGraphCut3DKolmogorovFilter.hxx"
+#ifdef GRAPHCUT_TEST_BOOST
+#include "ImageGraphCut3DBoostFilter.hxx"
+#endif
+#ifdef GRIDCUT_LIBRARY_AVAILABLE
+#include "ImageGridCutFilter.h"
+#endif
+
+// Runs the parallel extraction of the results (ProcessOutputSlabs) of each max flow library with different numbers of
+// threads, so the output is split into different slabs.
+template<typename TFilter>
+class TestOutputSlabs : public ::testing::Test {
+protected:
+    typedef itk::Image<short, 3> TInput;
+    typedef itk::Image<unsigned int, 3> TOutput;
+};
+
+typedef ::testing::Types<
+        itk::ImageGraphCut3DKolmogorovFilter<itk::Image<short, 3>, itk::Image<unsigned int, 3>,
+                itk::Image<unsigned int, 3>, itk::Image<unsigned int, 3> >
+#ifdef GRAPHCUT_TEST_BOOST
+        , itk::ImageGraphCut3DBoostFilter<itk::Image<short, 3>, itk::Image<unsigned int, 3>,
+                itk::Image<unsigned int, 3>, itk::Image<unsigned int, 3> >
+#endif
+#ifdef GRIDCUT_LIBRARY_AVAILABLE
+        , itk::ImageGridCutFilter<itk::Image<short, 3>, itk::Image<unsigned int, 3>,
+                itk::Image<unsigned int, 3>, itk::Image<unsigned int, 3> >
+#endif
+> FilterTypes;
+TYPED_TEST_CASE(TestOutputSlabs, FilterTypes);
+
+// 10 slices give 5 slabs of 2 slices for 1 thread and 10 slabs of 1 slice for 3 and 8 threads
+TYPED_TEST(TestOutputSlabs, NumberOfThreads){
+    typedef typename TestFixture::TOutput TOutput;
+    typename TOutput::Pointer expectedResult = IOHelper::readImage<TOutput>("data/test/cube10x10x10/expectedResult.mhd");
+
+    const unsigned int numberOfThreads[] = {1, 3, 8};
+    for (unsigned int i = 0; i < 3; ++i) {
+        typename TOutput::Pointer result = IOHelper::segment<TypeParam>("data/test/cube10x10x10", "cubeNoisy_0p01.mhd",
+                [&](TypeParam *filter, const typename TestFixture::TInput *) {
+                    filter->SetNumberOfThreads(numberOfThreads[i]);
+                });
+        ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(expectedResult, result));
+    }
+}
+
+// the whole output is generated even if only a part is requested, the slabs are written in the input raster order
+TYPED_TEST(TestOutputSlabs, PartialRequestedRegion){
+    typedef typename TestFixture::TOutput TOutput;
+    typename TOutput::Pointer expectedResult = IOHelper::readImage<TOutput>("data/test/cube10x10x10/expectedResult.mhd");
+
+    typename TOutput::Pointer result = IOHelper::segment<TypeParam>("data/test/cube10x10x10", "cube.mhd",
+            [](TypeParam *filter, const typename TestFixture::TInput *) {
+                filter->SetNumberOfThreads(4);
+                filter->UpdateOutputInformation();
+                typename TOutput::RegionType requestedRegion = filter->GetOutput()->GetLargestPossibleRegion();
+                for (unsigned int d = 0; d < 3; ++d) {
+                    requestedRegion.SetIndex(d, requestedRegion.GetIndex(d) + 2);
+                    requestedRegion.SetSize(d, requestedRegion.GetSize(d) - 4);
+                }
+                filter->GetOutput()->SetRequestedRegion(requestedRegion);
+            });
+
+    ASSERT_EQ(expectedResult->GetLargestPossibleRegion(), result->GetBufferedRegion());
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(expectedResult, result));
+}
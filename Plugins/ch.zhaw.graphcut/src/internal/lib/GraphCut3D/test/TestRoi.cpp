@@ -0,0 +1,116 @@
+/**
+ *  Image GraphCut 3D Segmentation
+ *
+ *  Copyright (c) 2016, Zurich University of Applied Sciences, School of Engineering, T. Fitze, Y. Pauchard
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved.
+ */
+
+ #include <gtest/gtest.h>
+
+// ITK
+#include <itkImage.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include "IOHelper.hxx"
+#include "ImageGraphCut3DKolmogorovFilter.hxx"
+#ifdef GRIDCUT_LIBRARY_AVAILABLE
+#include "ImageGridCutFilter.h"
+#endif
+
+class TestRoi : public ::testing::Test {
+protected:
+    // image types
+    typedef itk::Image<short, 3> TInput;
+    typedef itk::Image<unsigned int, 3> TMask;
+    typedef TMask TForeground;
+    typedef TMask TBackground;
+    typedef TMask TOutput;
+
+    // graphcut
+    typedef itk::ImageGraphCut3DKolmogorovFilter<TInput, TForeground, TBackground, TOutput> GraphCutFilterType;
+#ifdef GRIDCUT_LIBRARY_AVAILABLE
+    typedef itk::ImageGridCutFilter<TInput, TForeground, TBackground, TOutput> GridCutFilterType;
+#endif
+
+    // ROI containing all voxels with a distance of at least margin to the image border
+    TMask::Pointer createRoi(const TInput *input, unsigned int margin) {
+        TMask::Pointer roi = TMask::New();
+        roi->CopyInformation(input);
+        roi->SetRegions(input->GetLargestPossibleRegion());
+        roi->Allocate();
+
+        TInput::SizeType size = input->GetLargestPossibleRegion().GetSize();
+        itk::ImageRegionIteratorWithIndex<TMask> it(roi, roi->GetLargestPossibleRegion());
+        for (; !it.IsAtEnd(); ++it) {
+            bool inside = true;
+            for (unsigned int d = 0; d < 3; ++d) {
+                unsigned int index = it.GetIndex()[d];
+                inside = inside && index >= margin && index + margin < size[d];
+            }
+            it.Set(inside ? 1 : 0);
+        }
+        return roi;
+    }
+
+    template<typename TFilter = GraphCutFilterType>
+    TOutput::Pointer segment(const std::string &dataPath, const std::string &inputName, unsigned int roiMargin) {
+        return IOHelper::segment<TFilter>(dataPath, inputName, [&](TFilter *filter, const TInput *input) {
+            filter->SetRoiImage(createRoi(input, roiMargin));
+        });
+    }
+
+    // number of foreground voxels with a distance of less than margin to the image border, i.e. outside the ROI
+    unsigned int countForegroundOutsideRoi(const TOutput *result, unsigned int margin) {
+        TOutput::SizeType size = result->GetLargestPossibleRegion().GetSize();
+        unsigned int count = 0;
+        itk::ImageRegionConstIteratorWithIndex<TOutput> it(result, result->GetLargestPossibleRegion());
+        for (; !it.IsAtEnd(); ++it) {
+            bool inside = true;
+            for (unsigned int d = 0; d < 3; ++d) {
+                unsigned int index = it.GetIndex()[d];
+                inside = inside && index >= margin && index + margin < size[d];
+            }
+            if (!inside && it.Get() != 0) {
+                ++count;
+            }
+        }
+        return count;
+    }
+};
+
+TEST_F(TestRoi, FullRoi){
+    TOutput::Pointer expectedResult = IOHelper::readImage<TOutput>("data/test/cube10x10x10/expectedResult.mhd");
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(expectedResult, segment("data/test/cube10x10x10", "cube.mhd", 0)));
+}
+
+// the cube lies within [3, 5]^3, so a ROI without the outer voxel layer must not change the result
+TEST_F(TestRoi, CubeInsideRoi){
+    TOutput::Pointer expectedResult = IOHelper::readImage<TOutput>("data/test/cube10x10x10/expectedResult.mhd");
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(expectedResult, segment("data/test/cube10x10x10", "cube.mhd", 1)));
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(expectedResult, segment("data/test/cube10x10x10", "cubeNoisy_0p01.mhd", 1)));
+}
+
+// the ROI [4, 5]^3 cuts the cube [3, 5]^3, the voxels outside the ROI are background although they belong to the cube
+TEST_F(TestRoi, RoiCutsCube){
+    TOutput::Pointer result = segment("data/test/cube10x10x10", "cube.mhd", 4);
+    ASSERT_EQ(0u, countForegroundOutsideRoi(result, 4));
+    ASSERT_LT(0u, IOHelper::countDifferentVoxels<TOutput>(result, segment("data/test/cube10x10x10", "cube.mhd", 0)));
+}
+
+#ifdef GRIDCUT_LIBRARY_AVAILABLE
+// GridCut keeps all voxels in its grid and forces the ones outside the ROI to the sink
+TEST_F(TestRoi, GridCutCubeInsideRoi){
+    TOutput::Pointer expectedResult = IOHelper::readImage<TOutput>("data/test/cube10x10x10/expectedResult.mhd");
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(expectedResult, segment<GridCutFilterType>("data/test/cube10x10x10", "cube.mhd", 1)));
+    ASSERT_EQ(0u, IOHelper::countDifferentVoxels<TOutput>(expectedResult, segment<GridCutFilterType>("data/test/cube10x10x10", "cubeNoisy_0p01.mhd", 1)));
+}
+
+TEST_F(TestRoi, GridCutRoiCutsCube){
+    TOutput::Pointer result = segment<GridCutFilterType>("data/test/cube10x10x10", "cube.mhd", 4);
+    ASSERT_EQ(0u, countForegroundOutsideRoi(result, 4));
+    ASSERT_LT(0u, IOHelper::countDifferentVoxels<TOutput>(result, segment<GridCutFilterType>("data/test/cube10x10x10", "cube.mhd", 0)));
+}
+#endif
@@ -0,0 +1,377 @@
+/**
+ * Headless benchmark and regression check of the material mapping.
+ *
+ * Maps synthetic box meshes of several sizes onto a synthetic CT with both mapping methods, timing each stage of
+ * MaterialMappingFilter. For each run, the node and element arrays are checked:
+ * - homogeneous phantom: all values must equal E of the phantom's CT value.
+ * - with --golden: count, sum, minimum and maximum of each array must match the recorded values (see --write-golden).
+ *
+ * The runs and their stage reports are written as JSON (--output), the exit code is 1 if a check failed.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkUnstructuredGrid.h>
+
+#include "EMorganLookupTable.h"
+#include "ElementWeights.h"
+#include "MaterialMappingFilter.h"
+#include "Phantoms.h"
+
+namespace {
+    struct Options {
+        std::vector<std::size_t> scales = {10000, 100000, 1000000, 5000000};
+        std::vector<std::string> cellTypes = {"tetra", "quadratic"};
+        Phantoms::CtType phantom = Phantoms::CtType::Bone;
+        int ctSize = 256;
+        unsigned int repetitions = 1;
+        unsigned int slabSlices = 0;
+        std::string label;
+        std::string output = "material_mapping_benchmark.json";
+        std::string golden, writeGolden;
+        double tolerance = 1e-6; // relative
+    };
+
+    // fingerprint of an output array, compared against the golden values
+    struct Fingerprint {
+        std::size_t count = 0;
+        double sum = 0.0;
+        double min = std::numeric_limits<double>::max();
+        double max = std::numeric_limits<double>::lowest();
+    };
+
+    struct Run {
+        std::string cellType;
+        std::string method;
+        std::size_t numberOfElements;
+        std::size_t numberOfNodes;
+        double seconds; // fastest repetition
+        std::string check;
+        MappingReport report; // of the fastest repetition
+        std::map<std::string, Fingerprint> fingerprints;
+    };
+
+    void printUsage() {
+        std::cout << "MaterialMappingBenchmark [options]\n"
+                  << "  --scales 10000,100000,...   approximate numbers of elements\n"
+                  << "  --cell-types tetra,quadratic\n"
+                  << "  --phantom bone|homogeneous\n"
+                  << "  --ct-size 256               CT size in voxels per dimension\n"
+                  << "  --repetitions 1             the fastest repetition is reported\n"
+                  << "  --slab-slices 0             process the VOI in z-slabs of this many slices, 0 for all at once\n"
+                  << "  --label <text>              e.g. the commit, copied to the report\n"
+                  << "  --output <file.json>        report\n"
+                  << "  --golden <file>             compare the outputs with the recorded golden values\n"
+                  << "  --write-golden <file>       record the golden values\n"
+                  << "  --tolerance 1e-6            relative tolerance of the checks\n";
+    }
+
+    std::vector<std::string> split(const std::string &_list) {
+        std::vector<std::string> items;
+        std::istringstream stream(_list);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+
+    Options parseOptions(int _argc, char **_argv) {
+        Options options;
+        for (auto i = 1; i < _argc; ++i) {
+            std::string arg = _argv[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage();
+                std::exit(0);
+            }
+            if (i + 1 >= _argc) {
+                throw std::invalid_argument("missing value of " + arg);
+            }
+            std::string value = _argv[++i];
+            if (arg == "--scales") {
+                options.scales.clear();
+                for (const auto &scale : split(value)) {
+                    options.scales.push_back(std::stoul(scale));
+                }
+            } else if (arg == "--cell-types") {
+                options.cellTypes = split(value);
+                for (const auto &cellType : options.cellTypes) {
+                    if (cellType != "tetra" && cellType != "quadratic") {
+                        throw std::invalid_argument("unknown cell type " + cellType);
+                    }
+                }
+            } else if (arg == "--phantom") {
+                options.phantom = Phantoms::ParseCtType(value);
+            } else if (arg == "--ct-size") {
+                options.ctSize = std::stoi(value);
+            } else if (arg == "--repetitions") {
+                options.repetitions = std::max(1, std::stoi(value));
+            } else if (arg == "--slab-slices") {
+                options.slabSlices = static_cast<unsigned int>(std::stoul(value));
+            } else if (arg == "--label") {
+                options.label = value;
+            } else if (arg == "--output") {
+                options.output = value;
+            } else if (arg == "--golden") {
+                options.golden = value;
+            } else if (arg == "--write-golden") {
+                options.writeGolden = value;
+            } else if (arg == "--tolerance") {
+                options.tolerance = std::stod(value);
+            } else {
+                throw std::invalid_argument("unknown option " + arg);
+            }
+        }
+        return options;
+    }
+
+    BoneDensityFunctor createDensityFunctor() {
+        BoneDensityFunctor functor;
+        functor.SetRhoCt(BoneDensityParameters::RhoCt(0.0087, -0.00159));
+        functor.SetRhoAsh(BoneDensityParameters::RhoAsh(0.09, 1.14));
+        functor.SetRhoApp(BoneDensityParameters::RhoApp(0.6));
+        return functor;
+    }
+
+    PowerLawFunctor createPowerLawFunctor() {
+        PowerLawFunctor functor;
+        functor.AddPowerLaw(PowerLawParameters(6850, 1.49, 0), 1);
+        functor.AddPowerLaw(PowerLawParameters(6000, 1.2, 0), 100);
+        return functor;
+    }
+
+    Fingerprint fingerprint(vtkDataArray *_array) {
+        Fingerprint f;
+        f.count = static_cast<std::size_t>(_array->GetNumberOfTuples());
+        for (vtkIdType i = 0; i < _array->GetNumberOfTuples(); ++i) {
+            auto value = _array->GetTuple1(i);
+            f.sum += value;
+            f.min = std::min(f.min, value);
+            f.max = std::max(f.max, value);
+        }
+        return f;
+    }
+
+    bool isClose(double _expected, double _actual, double _tolerance) {
+        return std::abs(_expected - _actual) <= _tolerance * std::max(1.0, std::abs(_expected));
+    }
+
+    std::string key(const Options &_options, const Run &_run, const std::string &_array) {
+        return Phantoms::ToString(_options.phantom) + " " + std::to_string(_options.ctSize) + " " + _run.cellType +
+               " " + std::to_string(_run.numberOfElements) + " " + _run.method + " " + _array;
+    }
+
+    // golden file: one line per array, "<phantom> <ct size> <cell type> <elements> <method> <array> <count> <sum> <min> <max>"
+    std::map<std::string, Fingerprint> readGolden(const std::string &_filename) {
+        std::ifstream file(_filename);
+        if (!file) {
+            throw std::runtime_error("could not read " + _filename);
+        }
+        std::map<std::string, Fingerprint> golden;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream stream(line);
+            std::string phantom, ctSize, cellType, elements, method, array;
+            Fingerprint f;
+            if (stream >> phantom >> ctSize >> cellType >> elements >> method >> array >> f.count >> f.sum >> f.min >>
+                f.max) {
+                golden[phantom + " " + ctSize + " " + cellType + " " + elements + " " + method + " " + array] = f;
+            }
+        }
+        return golden;
+    }
+
+    std::string check(const Options &_options, Run &_run, const std::map<std::string, Fingerprint> &_golden,
+                      vtkUnstructuredGrid *_output, double _homogeneousE) {
+        std::vector<std::string> failures;
+        auto checkArray = [&](const std::string &_name, vtkDataArray *_array) {
+            if (_array == nullptr) {
+                failures.push_back(_name + " missing");
+                return;
+            }
+            _run.fingerprints[_name] = fingerprint(_array);
+
+            if (_options.phantom == Phantoms::CtType::Homogeneous) {
+                for (vtkIdType i = 0; i < _array->GetNumberOfTuples(); ++i) {
+                    if (!isClose(_homogeneousE, _array->GetTuple1(i), _options.tolerance)) {
+                        failures.push_back(_name + "[" + std::to_string(i) + "] = " +
+                                           std::to_string(_array->GetTuple1(i)) + ", expected " +
+                                           std::to_string(_homogeneousE));
+                        break;
+                    }
+                }
+            }
+
+            if (!_golden.empty()) {
+                auto it = _golden.find(key(_options, _run, _name));
+                if (it == _golden.end()) {
+                    failures.push_back(_name + " has no golden values");
+                    return;
+                }
+                const auto &expected = it->second;
+                const auto &actual = _run.fingerprints[_name];
+                if (expected.count != actual.count || !isClose(expected.sum, actual.sum, _options.tolerance) ||
+                    !isClose(expected.min, actual.min, _options.tolerance) ||
+                    !isClose(expected.max, actual.max, _options.tolerance)) {
+                    std::ostringstream failure;
+                    failure.precision(17);
+                    failure << _name << " differs from the golden values: sum " << actual.sum << " (" << expected.sum
+                            << "), min " << actual.min << " (" << expected.min << "), max " << actual.max << " ("
+                            << expected.max << ")";
+                    failures.push_back(failure.str());
+                }
+            }
+        };
+        checkArray("C", _output->GetPointData()->GetArray("C"));
+        checkArray("B", _output->GetCellData()->GetArray("B"));
+        checkArray("A", _output->GetCellData()->GetArray("A"));
+
+        if (failures.empty()) {
+            return "passed";
+        }
+        std::string message;
+        for (const auto &failure : failures) {
+            std::cerr << key(_options, _run, "") << ": " << failure << std::endl;
+            message += (message.empty() ? "" : "; ") + failure;
+        }
+        return message;
+    }
+
+    std::string escapeJson(const std::string &_s) {
+        std::string escaped;
+        for (auto c : _s) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    void writeReport(const Options &_options, const std::vector<Run> &_runs) {
+        std::ofstream file(_options.output);
+        file.precision(9);
+        file << "{\n\"label\": \"" << escapeJson(_options.label) << "\",\n\"phantom\": \""
+             << Phantoms::ToString(_options.phantom) << "\",\n\"ctSize\": " << _options.ctSize
+             << ",\n\"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n\"runs\": [";
+        for (std::size_t i = 0; i < _runs.size(); ++i) {
+            const auto &run = _runs[i];
+            file << (i ? ",\n" : "\n") << "{\"cellType\": \"" << run.cellType << "\", \"method\": \"" << run.method
+                 << "\", \"elements\": " << run.numberOfElements << ", \"nodes\": " << run.numberOfNodes
+                 << ", \"seconds\": " << run.seconds << ", \"elementsPerSecond\": "
+                 << run.numberOfElements / std::max(run.seconds, 1e-9) << ", \"check\": \"" << escapeJson(run.check)
+                 << "\",\n\"report\": " << run.report.ToJson() << "}";
+        }
+        file << "\n]\n}\n";
+        if (!file) {
+            throw std::runtime_error("could not write " + _options.output);
+        }
+    }
+
+    void writeGolden(const Options &_options, const std::vector<Run> &_runs) {
+        std::ofstream file(_options.writeGolden);
+        file.precision(17);
+        for (const auto &run : _runs) {
+            for (const auto &pair : run.fingerprints) {
+                const auto &f = pair.second;
+                file << key(_options, run, pair.first) << " " << f.count << " " << f.sum << " " << f.min << " "
+                     << f.max << "\n";
+            }
+        }
+        if (!file) {
+            throw std::runtime_error("could not write " + _options.writeGolden);
+        }
+    }
+}
+
+int main(int _argc, char **_argv) {
+    try {
+        auto options = parseOptions(_argc, _argv);
+        std::map<std::string, Fingerprint> golden;
+        if (!options.golden.empty()) {
+            golden = readGolden(options.golden);
+        }
+
+        const double homogeneousCt = 800.0;
+        auto ct = Phantoms::CreateCt(options.phantom, options.ctSize, homogeneousCt);
+        auto homogeneousE = EMorganLookupTable(createDensityFunctor(), createPowerLawFunctor()).Evaluate(homogeneousCt);
+
+        std::vector<Run> runs;
+        auto passed = true;
+        for (const auto &cellType : options.cellTypes) {
+            for (auto scale : options.scales) {
+                auto mesh = Phantoms::CreateBoxMesh(options.ctSize, scale, cellType == "quadratic");
+
+                for (auto method : {MaterialMappingFilter::Method::Old, MaterialMappingFilter::Method::New}) {
+                    Run run;
+                    run.cellType = cellType;
+                    run.method = method == MaterialMappingFilter::Method::Old ? "old" : "new";
+                    run.numberOfElements = static_cast<std::size_t>(mesh->GetVtkUnstructuredGrid()->GetNumberOfCells());
+                    run.numberOfNodes = static_cast<std::size_t>(mesh->GetVtkUnstructuredGrid()->GetNumberOfPoints());
+                    run.seconds = std::numeric_limits<double>::max();
+
+                    mitk::UnstructuredGrid::Pointer output;
+                    for (auto r = 0u; r < options.repetitions; ++r) {
+                        // a new filter per repetition and no element weights from the previous run, so every run
+                        // times the geometry stages and the element weights
+                        ElementWeights::Detach(mesh);
+                        auto filter = MaterialMappingFilter::New();
+                        filter->SetInput(mesh);
+                        filter->SetIntensityImage(ct);
+                        filter->SetMethod(method);
+                        filter->SetDensityFunctor(createDensityFunctor());
+                        filter->SetPowerLawFunctor(createPowerLawFunctor());
+                        filter->SetNumberOfExtendImageSteps(3);
+                        filter->SetMinElementValue(1.0);
+                        filter->SetSlabSlices(options.slabSlices);
+                        filter->AddBranch(true, "C", "B");
+                        filter->AddBranch(false, "", "A");
+
+                        auto start = std::chrono::steady_clock::now();
+                        filter->Update();
+                        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+                        if (duration.count() < run.seconds) {
+                            run.seconds = duration.count();
+                            run.report = filter->GetReport();
+                        }
+                        output = filter->GetOutput();
+                    }
+
+                    run.check = check(options, run, golden, output->GetVtkUnstructuredGrid(), homogeneousE);
+                    passed = passed && run.check == "passed";
+                    std::cout << cellType << " " << run.numberOfElements << " elements, method " << run.method
+                              << ": " << run.seconds << " s, " << run.numberOfElements / std::max(run.seconds, 1e-9)
+                              << " elements/s, " << run.check << std::endl;
+                    runs.push_back(std::move(run));
+                }
+            }
+        }
+
+        writeReport(options, runs);
+        if (!options.writeGolden.empty()) {
+            writeGolden(options, runs);
+        }
+        return passed ? 0 : 1;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <vtkCellType.h>
+#include <vtkImageData.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnstructuredGrid.h>
+
+#include "Phantoms.h"
+
+namespace {
+    const double spacing = 0.5;
+
+    double bone(double _x, double _y, double _z, double _radius, double _length) {
+        auto r = std::sqrt(_x * _x + _y * _y) / _radius;
+        if (r > 1.0) {
+            return 0.0;
+        }
+        if (r > 0.8) {
+            return 1400.0; // cortical shell
+        }
+        return 200.0 + 300.0 * r + 100.0 * _z / _length; // trabecular core
+    }
+
+    // signed volume * 6 of the tetrahedron (a, b, c, d)
+    double orientation(const double *_a, const double *_b, const double *_c, const double *_d) {
+        double u[3], v[3], w[3];
+        for (auto i = 0; i < 3; ++i) {
+            u[i] = _b[i] - _a[i];
+            v[i] = _c[i] - _a[i];
+            w[i] = _d[i] - _a[i];
+        }
+        return u[0] * (v[1] * w[2] - v[2] * w[1]) - u[1] * (v[0] * w[2] - v[2] * w[0]) +
+               u[2] * (v[0] * w[1] - v[1] * w[0]);
+    }
+}
+
+namespace Phantoms {
+    mitk::Image::Pointer CreateCt(CtType _type, int _size, double _homogeneousValue) {
+        auto vtkImage = vtkSmartPointer<vtkImageData>::New();
+        vtkImage->SetDimensions(_size, _size, _size);
+        vtkImage->SetSpacing(spacing, spacing, spacing);
+        vtkImage->SetOrigin(0, 0, 0);
+        vtkImage->AllocateScalars(VTK_SHORT, 1);
+
+        auto voxels = static_cast<short *>(vtkImage->GetScalarPointer());
+        auto centre = 0.5 * (_size - 1) * spacing;
+        auto length = _size * spacing;
+        for (auto z = 0; z < _size; ++z) {
+            for (auto y = 0; y < _size; ++y) {
+                for (auto x = 0; x < _size; ++x, ++voxels) {
+                    auto value = _homogeneousValue;
+                    if (_type == CtType::Bone) {
+                        value = bone(x * spacing - centre, y * spacing - centre, z * spacing, 0.4 * length, length);
+                    }
+                    *voxels = static_cast<short>(std::lround(value));
+                }
+            }
+        }
+
+        auto image = mitk::Image::New();
+        image->Initialize(vtkImage);
+        image->SetVolume(vtkImage->GetScalarPointer());
+        return image;
+    }
+
+    mitk::UnstructuredGrid::Pointer CreateBoxMesh(int _ctSize, std::size_t _numberOfElements, bool _quadratic) {
+        auto n = std::max(1, static_cast<int>(std::lround(std::cbrt(_numberOfElements / 6.0))));
+        auto width = 0.6 * (_ctSize - 1) * spacing;
+        auto start = 0.2 * (_ctSize - 1) * spacing;
+        auto h = width / n;
+
+        auto points = vtkSmartPointer<vtkPoints>::New();
+        points->SetDataTypeToDouble();
+        points->SetNumberOfPoints(static_cast<vtkIdType>(n + 1) * (n + 1) * (n + 1));
+        auto pointId = [n](int _x, int _y, int _z) {
+            return (static_cast<vtkIdType>(_z) * (n + 1) + _y) * (n + 1) + _x;
+        };
+        for (auto z = 0; z <= n; ++z) {
+            for (auto y = 0; y <= n; ++y) {
+                for (auto x = 0; x <= n; ++x) {
+                    points->SetPoint(pointId(x, y, z), start + x * h, start + y * h, start + z * h);
+                }
+            }
+        }
+
+        // Kuhn subdivision: one tetrahedron per axis permutation, all sharing the main diagonal of the cube. The
+        // subdivision is the same for all cubes, so the faces of neighbouring cubes match
+        const int permutations[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+        auto ugrid = vtkSmartPointer<vtkUnstructuredGrid>::New();
+        ugrid->Allocate(6 * n * n * n);
+        std::unordered_map<std::uint64_t, vtkIdType> midpoints; // edge (a, b) with a < b -> midpoint
+        auto midpoint = [&](vtkIdType _a, vtkIdType _b) {
+            auto key = (static_cast<std::uint64_t>(std::min(_a, _b)) << 32) | static_cast<std::uint64_t>(std::max(_a, _b));
+            auto it = midpoints.find(key);
+            if (it != midpoints.end()) {
+                return it->second;
+            }
+            double a[3], b[3];
+            points->GetPoint(_a, a);
+            points->GetPoint(_b, b);
+            auto id = points->InsertNextPoint(0.5 * (a[0] + b[0]), 0.5 * (a[1] + b[1]), 0.5 * (a[2] + b[2]));
+            midpoints.emplace(key, id);
+            return id;
+        };
+
+        for (auto z = 0; z < n; ++z) {
+            for (auto y = 0; y < n; ++y) {
+                for (auto x = 0; x < n; ++x) {
+                    for (const auto &permutation : permutations) {
+                        int corner[3] = {x, y, z};
+                        std::array<vtkIdType, 10> ids;
+                        ids[0] = pointId(corner[0], corner[1], corner[2]);
+                        for (auto j = 0; j < 3; ++j) {
+                            ++corner[permutation[j]];
+                            ids[j + 1] = pointId(corner[0], corner[1], corner[2]);
+                        }
+
+                        double p[4][3];
+                        for (auto j = 0; j < 4; ++j) {
+                            points->GetPoint(ids[j], p[j]);
+                        }
+                        if (orientation(p[0], p[1], p[2], p[3]) < 0) {
+                            std::swap(ids[1], ids[2]);
+                        }
+
+                        if (_quadratic) {
+                            // vtkQuadraticTetra: edges (0,1), (1,2), (2,0), (0,3), (1,3), (2,3)
+                            const int edges[6][2] = {{0, 1}, {1, 2}, {2, 0}, {0, 3}, {1, 3}, {2, 3}};
+                            for (auto e = 0; e < 6; ++e) {
+                                ids[4 + e] = midpoint(ids[edges[e][0]], ids[edges[e][1]]);
+                            }
+                            ugrid->InsertNextCell(VTK_QUADRATIC_TETRA, 10, ids.data());
+                        } else {
+                            ugrid->InsertNextCell(VTK_TETRA, 4, ids.data());
+                        }
+                    }
+                }
+            }
+        }
+        ugrid->SetPoints(points);
+
+        auto mesh = mitk::UnstructuredGrid::New();
+        mesh->SetVtkUnstructuredGrid(ugrid);
+        return mesh;
+    }
+
+    CtType ParseCtType(const std::string &_name) {
+        if (_name == "homogeneous") {
+            return CtType::Homogeneous;
+        }
+        if (_name == "bone") {
+            return CtType::Bone;
+        }
+        throw std::invalid_argument("unknown phantom " + _name);
+    }
+
+    std::string ToString(CtType _type) {
+        return _type == CtType::Homogeneous ? "homogeneous" : "bone";
+    }
+}
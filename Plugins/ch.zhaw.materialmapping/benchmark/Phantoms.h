@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include <mitkImage.h>
+#include <mitkUnstructuredGrid.h>
+
+/**
+ * Synthetic inputs of the material mapping benchmark.
+ */
+namespace Phantoms {
+    enum class CtType {
+        Homogeneous, // a single CT value, the mapped values are known analytically
+        Bone         // cylinder along z: cortical shell around a trabecular core with a radial and axial gradient
+    };
+
+    /**
+     * _size^3 CT of type short with 0.5 mm spacing. The background is 0 HU.
+     */
+    mitk::Image::Pointer CreateCt(CtType _type, int _size, double _homogeneousValue = 800.0);
+
+    /**
+     * Box mesh in the centre of the CT created by CreateCt(_ctSize), filling 60% of its width. The box is divided into
+     * n^3 cubes of 6 tetrahedra each, n chosen so the mesh has about _numberOfElements elements. With _quadratic,
+     * quadratic tetrahedra with nodes on the edge midpoints are created.
+     */
+    mitk::UnstructuredGrid::Pointer CreateBoxMesh(int _ctSize, std::size_t _numberOfElements, bool _quadratic);
+
+    CtType ParseCtType(const std::string &_name);
+
+    std::string ToString(CtType _type);
+}
@@ -0,0 +1,216 @@
+/**
+ * Headless material mapping, e.g. for cluster jobs. Needs no Qt widgets and no display.
+ *
+ * Maps one or more meshes onto a CT with the functors of a calibration table (CalibrationDataModel XML format) and power
+ * law definitions (PowerLawWidgetManager XML format), or of a parameter file saved by the material mapping view. The
+ * mapped meshes contain the same arrays as the ones mapped in the view.
+ *
+ * The stages run in a pipeline: the CT and the first mesh are read concurrently, the next mesh is read and the
+ * previous result is written while a mesh is mapped. The exit code is 1 if a mapping failed and 2 for invalid options.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <mitkIOUtil.h>
+#include <mitkImage.h>
+#include <mitkUnstructuredGrid.h>
+
+#include "MaterialMappingFilter.h"
+#include "MaterialMappingHelper.h"
+#include "MaterialMappingParameters.h"
+#include "MemoryMappedImage.h"
+
+namespace {
+    struct Options {
+        std::string ct;
+        bool mapCt = false;
+        std::vector<std::string> meshes, outputs;
+        std::string calibration, powerLaws;
+        MaterialMappingFilter::Method method = MaterialMappingFilter::Method::New;
+        float minElementValue = 0.0;
+        unsigned int materialBins = 0;
+        unsigned int slabSlices = 0;
+    };
+
+    void printUsage() {
+        std::cout << "MaterialMappingCli --ct <image> --mesh <mesh> --output <mesh> --parameters <file.matmap> [options]\n"
+                  << "  --ct <image>                CT, any format MITK reads\n"
+                  << "  --map-ct                    map the CT into memory instead of loading it, it has to be an\n"
+                  << "                              uncompressed MetaImage (.mhd/.raw or .mha with aligned data).\n"
+                  << "                              The VOI is processed in z-slabs of about 64 MiB\n"
+                  << "  --slab-slices 0             process the VOI in z-slabs of this many slices, bounding the\n"
+                  << "                              memory of the images by the slab size. 0: the whole VOI at\n"
+                  << "                              once, or the default slabs of --map-ct. The output is the same\n"
+                  << "  --mesh <mesh>               mesh to map, may be repeated\n"
+                  << "  --output <mesh>             mapped mesh, one per --mesh\n"
+                  << "  --parameters <file>         parameter file saved by the material mapping view, sets both\n"
+                  << "                              --calibration and --power-laws\n"
+                  << "  --calibration <file.xml>    calibration table and, if present, bone density parameters\n"
+                  << "  --power-laws <file.xml>     power law definitions\n"
+                  << "  --method old|new            mapping method, new by default\n"
+                  << "  --min-e 0                   minimum element value\n"
+                  << "  --material-bins 0           quantise the element values into at most this number of materials\n";
+    }
+
+    Options parseOptions(int _argc, char **_argv) {
+        Options options;
+        for (auto i = 1; i < _argc; ++i) {
+            std::string arg = _argv[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage();
+                std::exit(0);
+            }
+            if (arg == "--map-ct") {
+                options.mapCt = true;
+                continue;
+            }
+            if (i + 1 >= _argc) {
+                throw std::invalid_argument("missing value of " + arg);
+            }
+            std::string value = _argv[++i];
+            if (arg == "--ct") {
+                options.ct = value;
+            } else if (arg == "--mesh") {
+                options.meshes.push_back(value);
+            } else if (arg == "--output") {
+                options.outputs.push_back(value);
+            } else if (arg == "--parameters") {
+                options.calibration = value;
+                options.powerLaws = value;
+            } else if (arg == "--calibration") {
+                options.calibration = value;
+            } else if (arg == "--power-laws") {
+                options.powerLaws = value;
+            } else if (arg == "--method") {
+                if (value != "old" && value != "new") {
+                    throw std::invalid_argument("unknown method " + value);
+                }
+                options.method = value == "old" ? MaterialMappingFilter::Method::Old : MaterialMappingFilter::Method::New;
+            } else if (arg == "--min-e") {
+                options.minElementValue = std::stof(value);
+            } else if (arg == "--material-bins") {
+                options.materialBins = static_cast<unsigned int>(std::stoul(value));
+            } else if (arg == "--slab-slices") {
+                options.slabSlices = static_cast<unsigned int>(std::stoul(value));
+            } else {
+                throw std::invalid_argument("unknown option " + arg);
+            }
+        }
+
+        if (options.ct.empty() || options.meshes.empty() || options.calibration.empty() || options.powerLaws.empty()) {
+            throw std::invalid_argument("--ct, --mesh, --calibration and --power-laws (or --parameters) are required");
+        }
+        if (options.outputs.size() != options.meshes.size()) {
+            throw std::invalid_argument("one --output is required per --mesh");
+        }
+        return options;
+    }
+
+    void readFunctors(const Options &_options, BoneDensityFunctor &_densityFunctor, PowerLawFunctor &_powerLawFunctor) {
+        TiXmlDocument calibrationDoc;
+        auto calibrationRoot = MaterialMappingParameters::LoadFile(_options.calibration, calibrationDoc);
+        MaterialMappingParameters::Calibration calibration;
+        if (calibrationRoot == nullptr || !MaterialMappingParameters::ReadCalibration(calibrationRoot, calibration) ||
+            !MaterialMappingParameters::ReadDensityFunctor(calibrationRoot, calibration, _densityFunctor)) {
+            throw std::invalid_argument("invalid calibration " + _options.calibration);
+        }
+
+        TiXmlDocument powerLawDoc;
+        auto powerLawRoot = MaterialMappingParameters::LoadFile(_options.powerLaws, powerLawDoc);
+        if (powerLawRoot == nullptr || !MaterialMappingParameters::ReadPowerLawFunctor(powerLawRoot, _powerLawFunctor)) {
+            throw std::invalid_argument("invalid power laws " + _options.powerLaws);
+        }
+    }
+
+    mitk::Image::Pointer loadImage(const std::string &_filename) {
+        for (auto &data : mitk::IOUtil::Load(_filename)) {
+            mitk::Image::Pointer image = dynamic_cast<mitk::Image *>(data.GetPointer());
+            if (image.IsNotNull()) {
+                return image;
+            }
+        }
+        throw std::runtime_error(_filename + " is not an image");
+    }
+
+    mitk::UnstructuredGrid::Pointer loadMesh(const std::string &_filename) {
+        for (auto &data : mitk::IOUtil::Load(_filename)) {
+            mitk::UnstructuredGrid::Pointer mesh = dynamic_cast<mitk::UnstructuredGrid *>(data.GetPointer());
+            if (mesh.IsNotNull()) {
+                return mesh;
+            }
+        }
+        throw std::runtime_error(_filename + " is not an unstructured grid");
+    }
+}
+
+int main(int _argc, char **_argv) {
+    Options options;
+    BoneDensityFunctor densityFunctor;
+    PowerLawFunctor powerLawFunctor;
+    try {
+        options = parseOptions(_argc, _argv);
+        readFunctors(options, densityFunctor, powerLawFunctor);
+        std::cout << densityFunctor << "\n" << powerLawFunctor << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    try {
+        // the CT and the first mesh are read concurrently. A mapped CT is only checked here, the filter maps it
+        std::future<mitk::Image::Pointer> ctFuture;
+        if (options.mapCt) {
+            if (!MemoryMappedImage::OpenMetaImage(options.ct)) {
+                throw std::runtime_error("could not map " + options.ct);
+            }
+        } else {
+            ctFuture = std::async(std::launch::async, loadImage, options.ct);
+        }
+        auto meshFuture = std::async(std::launch::async, loadMesh, options.meshes.front());
+        mitk::Image::Pointer ct = ctFuture.valid() ? ctFuture.get() : nullptr;
+
+        auto filter = MaterialMappingFilter::New();
+        if (options.mapCt) {
+            filter->SetIntensityImageFile(options.ct);
+        }
+        filter->SetMaterialBins(options.materialBins);
+        filter->SetSlabSlices(options.slabSlices);
+
+        std::future<void> writeFuture;
+        for (std::size_t i = 0; i < options.meshes.size(); ++i) {
+            auto mesh = meshFuture.get();
+            if (i + 1 < options.meshes.size()) {
+                meshFuture = std::async(std::launch::async, loadMesh, options.meshes[i + 1]);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            auto result = MaterialMappingHelper::Compute(mesh, ct, options.method, densityFunctor, powerLawFunctor,
+                                                         options.minElementValue, filter);
+            std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+            std::cout << options.meshes[i] << ": " << mesh->GetVtkUnstructuredGrid()->GetNumberOfCells()
+                      << " elements mapped in " << duration.count() << " s" << std::endl;
+
+            // the previous result has to be written before the next one is queued
+            if (writeFuture.valid()) {
+                writeFuture.get();
+            }
+            auto output = options.outputs[i];
+            writeFuture = std::async(std::launch::async, [result, output]() {
+                mitk::IOUtil::Save(result.GetPointer(), output);
+                std::cout << output << " written" << std::endl;
+            });
+        }
+        writeFuture.get();
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
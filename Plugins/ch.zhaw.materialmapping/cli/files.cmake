@@ -0,0 +1,21 @@
+# the command line mapping compiles the Qt independent mapping sources of the plugin
+set(CPP_FILES
+  MaterialMappingCli.cpp
+  ../src/internal/AsyncImageWriter.cpp
+  ../src/internal/BoneDensityFunctor.cpp
+  ../src/internal/BoneDensityParameters.cpp
+  ../src/internal/EMorganLookupTable.cpp
+  ../src/internal/ElementWeights.cpp
+  ../src/internal/ImageExtender.cpp
+  ../src/internal/MappingReport.cpp
+  ../src/internal/MaterialMappingFilter.cpp
+  ../src/internal/MaterialMappingHelper.cpp
+  ../src/internal/MaterialMappingParameters.cpp
+  ../src/internal/MaterialQuantizer.cpp
+  ../src/internal/MemoryMappedImage.cpp
+  ../src/internal/MeshVoxelizer.cpp
+  ../src/internal/PowerLawFunctor.cpp
+  ../src/internal/PowerLawParameters.cpp
+  ../src/internal/TileGrid.cpp
+  ../src/internal/TileMask.cpp
+)
@@ -4,22 +4,45 @@ set(SRC_CPP_FILES
 
 set(INTERNAL_CPP_FILES
   ch_zhaw_materialmapping_Activator.cpp
+  AsyncImageWriter.cpp
   BoneDensityParameters.cpp
   BoneDensityFunctor.cpp
   CalibrationDataModel.cpp
+  EMorganLookupTable.cpp
+  ElementWeights.cpp
   GuiHelpers.cpp
+  ImageExtender.cpp
+  MappingReport.cpp
   MaterialMappingFilter.cpp
   MaterialMappingHelper.cpp
+  MaterialMappingParameters.cpp
   MaterialMappingView.cpp
+  MaterialQuantizer.cpp
+  MemoryMappedImage.cpp
+  MeshVoxelizer.cpp
   PowerLawFunctor.cpp
   PowerLawParameters.cpp
   PowerLawWidget.cpp
   PowerLawWidgetManager.cpp
+  TileGrid.cpp
+  TileMask.cpp
+  test/AsyncImageWriterTest.cpp
   test/BoneDensityTest.cpp
+  test/EMorganLookupTableTest.cpp
+  test/ElementWeightsTest.cpp
   test/GridComparator.cpp
+  test/ImageExtenderTest.cpp
+  test/MappingReportTest.cpp
+  test/MaterialMappingFilterTest.cpp
+  test/MaterialMappingParametersTest.cpp
+  test/MaterialQuantizerTest.cpp
+  test/MemoryMappedImageTest.cpp
+  test/MeshVoxelizerTest.cpp
   test/PowerLawFunctorTest.cpp
   test/PowerLawWidgetTest.cpp
   test/Runner.cpp
+  test/TileGridTest.cpp
+  test/TileMaskTest.cpp
 )
 
 set(UI_FILES
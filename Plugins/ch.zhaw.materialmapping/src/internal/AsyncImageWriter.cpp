@@ -0,0 +1,71 @@
+#include <algorithm>
+
+#include <vtkMetaImageWriter.h>
+
+#include "AsyncImageWriter.h"
+
+AsyncImageWriter::AsyncImageWriter(std::size_t _maxQueuedImages)
+        : m_MaxQueuedImages(std::max<std::size_t>(1, _maxQueuedImages)) {
+    m_Thread = std::thread(&AsyncImageWriter::run, this);
+}
+
+AsyncImageWriter::~AsyncImageWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Changed.notify_all();
+    m_Thread.join();
+}
+
+void AsyncImageWriter::Write(const std::string &_filename, vtkImageData *_img, bool _snapshot) {
+    // the snapshot is taken outside of the lock, the writer thread keeps writing meanwhile
+    vtkSmartPointer<vtkImageData> snapshot = _img;
+    if (_snapshot) {
+        snapshot = vtkSmartPointer<vtkImageData>::New();
+        snapshot->DeepCopy(_img);
+    }
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Changed.wait(lock, [this]() {
+        return m_Queue.size() < m_MaxQueuedImages;
+    });
+    m_Queue.emplace_back(_filename, snapshot);
+    lock.unlock();
+    m_Changed.notify_all();
+}
+
+void AsyncImageWriter::Flush() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Changed.wait(lock, [this]() {
+        return m_Queue.empty() && !m_Writing;
+    });
+}
+
+void AsyncImageWriter::run() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_Changed.wait(lock, [this]() {
+            return m_Stop || !m_Queue.empty();
+        });
+        if (m_Queue.empty()) {
+            return; // stopped and everything written
+        }
+
+        auto item = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        m_Writing = true;
+        lock.unlock();
+        m_Changed.notify_all();
+
+        auto writer = vtkSmartPointer<vtkMetaImageWriter>::New();
+        writer->SetFileName(item.first.c_str());
+        writer->SetCompression(true);
+        writer->SetInputData(item.second);
+        writer->Write();
+
+        lock.lock();
+        m_Writing = false;
+        m_Changed.notify_all();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+/**
+ * Writes images to compressed MetaImage files on a background thread.
+ *
+ * Write() takes a snapshot (deep copy) of the image and queues it, so the caller may modify the image right away. Images
+ * that are not modified any more can be queued without a snapshot. The queue holds at most _maxQueuedImages images,
+ * Write() blocks while it is full. Flush() waits until all queued images are written, the destructor flushes as well.
+ */
+class AsyncImageWriter {
+public:
+    explicit AsyncImageWriter(std::size_t _maxQueuedImages = 4);
+
+    ~AsyncImageWriter();
+
+    AsyncImageWriter(const AsyncImageWriter &) = delete;
+
+    AsyncImageWriter &operator=(const AsyncImageWriter &) = delete;
+
+    void Write(const std::string &_filename, vtkImageData *_img, bool _snapshot = true);
+
+    void Flush();
+
+private:
+    void run();
+
+    std::size_t m_MaxQueuedImages;
+    std::deque<std::pair<std::string, vtkSmartPointer<vtkImageData>>> m_Queue;
+    bool m_Writing = false;
+    bool m_Stop = false;
+    std::mutex m_Mutex;
+    std::condition_variable m_Changed;
+    std::thread m_Thread;
+};
@@ -3,12 +3,8 @@
 #include <QTextStream>
 #include <mitkLogMacros.h>
 
-#include <vnl/algo/vnl_lsqr.h>
-#include <vnl/vnl_sparse_matrix_linear_system.h>
-#include <vnl/vnl_least_squares_function.h>
-
-
 #include "CalibrationDataModel.h"
+#include "MaterialMappingParameters.h"
 
 #include <stdexcept>
 
@@ -110,27 +106,9 @@ void CalibrationDataModel::clear() {
 }
 
 BoneDensityParameters::RhoCt CalibrationDataModel::getFittedLine() const {
-    vnl_vector<double> x(2);
-    x[0] = x[1] = 0.0;
-
-    if(m_Data.size() > 1) { // on windows, lsqr.minimize crashes when called with too few data points
-        vnl_sparse_matrix<double> A(m_Data.size(), 2);
-        vnl_vector<double> b(m_Data.size());
-
-        auto factor = 1.0;
-        m_SelectedUnit == Unit::mgHA_cm3 ? factor = 1000.0 : 1.0;
-        for (auto i = 0; i < m_Data.size(); ++i) {
-            A(i, 0) = m_Data[i].first;
-            A(i, 1) = 1;
-            b[i] = m_Data[i].second / factor;
-        }
-        vnl_sparse_matrix_linear_system<double> ls(A, b);
-
-        vnl_lsqr lsqr(ls);
-        lsqr.minimize(x);
-    }
-
-    return BoneDensityParameters::RhoCt(x[0], x[1]);
+    auto factor = m_SelectedUnit == Unit::mgHA_cm3 ? 1000.0 : 1.0;
+    return MaterialMappingParameters::FitRhoCt(std::vector<std::pair<double, double>>(m_Data.begin(), m_Data.end()),
+                                               factor);
 }
 
 std::string CalibrationDataModel::getUnitString() const {
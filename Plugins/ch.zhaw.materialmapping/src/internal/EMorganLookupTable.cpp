@@ -0,0 +1,41 @@
+#include <cmath>
+
+#include <vtkType.h>
+#include <vtkTemplateAliasMacro.h>
+
+#include "EMorganLookupTable.h"
+
+EMorganLookupTable::EMorganLookupTable(const BoneDensityFunctor &_densityFunctor,
+                                       const PowerLawFunctor &_powerLawFunctor,
+                                       int _minCt, int _maxCt, bool _clampDensity)
+        : m_DensityFunctor(_densityFunctor),
+          m_PowerLawFunctor(_powerLawFunctor),
+          m_ClampDensity(_clampDensity),
+          m_MinCt(_minCt),
+          m_MaxCt(_maxCt) {
+    m_Table.resize(m_MaxCt >= m_MinCt ? m_MaxCt - m_MinCt + 1 : 0);
+    for (auto ct = m_MinCt; ct <= m_MaxCt; ++ct) {
+        m_Table[ct - m_MinCt] = Evaluate(ct);
+    }
+}
+
+double EMorganLookupTable::Evaluate(double _ct) const {
+    auto rho = m_DensityFunctor(_ct);
+    if (m_ClampDensity) {
+        rho = std::max(rho, 0.0);
+    }
+    return m_PowerLawFunctor(rho);
+}
+
+vtkSmartPointer<vtkImageData> EMorganLookupTable::CreateEImage(vtkImageData *_ct) const {
+    auto eImage = vtkSmartPointer<vtkImageData>::New();
+    eImage->CopyStructure(_ct);
+    eImage->AllocateScalars(VTK_FLOAT, 1);
+
+    auto out = static_cast<float *>(eImage->GetScalarPointer());
+    auto n = static_cast<std::size_t>(_ct->GetNumberOfPoints());
+    switch (_ct->GetScalarType()) {
+        vtkTemplateAliasMacro(Apply(static_cast<const VTK_TT *>(_ct->GetScalarPointer()), out, n));
+    }
+    return eImage;
+}
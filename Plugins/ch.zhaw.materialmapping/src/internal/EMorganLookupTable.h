@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "BoneDensityFunctor.h"
+#include "Parallel.h"
+#include "PowerLawFunctor.h"
+
+/**
+ * Immutable evaluator of the functor chain CT -> rho (BoneDensityFunctor) -> E (PowerLawFunctor).
+ *
+ * CT values are integers in a bounded range, so E is precomputed for every integer CT value in [minCt, maxCt]. Other
+ * values are evaluated on the fly. The evaluator holds no mutable state and can be shared between threads. Results are
+ * identical to evaluating the functors directly.
+ */
+class EMorganLookupTable {
+public:
+    /**
+     * If _clampDensity is set, negative densities are clamped to 0 before the power law is applied (as in the
+     * material mapping).
+     */
+    EMorganLookupTable(const BoneDensityFunctor &_densityFunctor, const PowerLawFunctor &_powerLawFunctor,
+                       int _minCt = -32768, int _maxCt = 65535, bool _clampDensity = true);
+
+    template<class TPixel>
+    inline double operator()(const TPixel &_ct) const {
+        return lookup(_ct, std::is_integral<TPixel>());
+    }
+
+    /**
+     * Evaluates the functor chain without the table.
+     */
+    double Evaluate(double _ct) const;
+
+    /**
+     * Writes E of _n CT values to _out, split into chunks evaluated in parallel. _in and _out may be the same buffer.
+     */
+    template<class TIn, class TOut>
+    void Apply(const TIn *_in, TOut *_out, std::size_t _n) const;
+
+    /**
+     * Creates a float image of E values with the structure of _ct. The scalars of _ct are read in their own type.
+     */
+    vtkSmartPointer<vtkImageData> CreateEImage(vtkImageData *_ct) const;
+
+    int GetMinCt() const {
+        return m_MinCt;
+    }
+
+    int GetMaxCt() const {
+        return m_MaxCt;
+    }
+
+private:
+    template<class TPixel>
+    inline double lookup(const TPixel &_ct, std::true_type) const {
+        auto ct = static_cast<long long>(_ct);
+        if (ct >= m_MinCt && ct <= m_MaxCt) {
+            return m_Table[ct - m_MinCt];
+        }
+        return Evaluate(_ct);
+    }
+
+    template<class TPixel>
+    inline double lookup(const TPixel &_ct, std::false_type) const {
+        if (_ct >= m_MinCt && _ct <= m_MaxCt) {
+            auto i = static_cast<int>(_ct);
+            if (i == _ct) {
+                return m_Table[i - m_MinCt];
+            }
+        }
+        return Evaluate(_ct);
+    }
+
+    BoneDensityFunctor m_DensityFunctor;
+    PowerLawFunctor m_PowerLawFunctor;
+    bool m_ClampDensity;
+    int m_MinCt, m_MaxCt;
+    std::vector<double> m_Table;
+};
+
+template<class TIn, class TOut>
+void EMorganLookupTable::Apply(const TIn *_in, TOut *_out, std::size_t _n) const {
+    const std::size_t minimumChunkSize = 1 << 16;
+    Parallel::For(_n, minimumChunkSize, [this, _in, _out](std::size_t, std::size_t _begin, std::size_t _end) {
+        for (auto i = _begin; i < _end; ++i) {
+            _out[i] = static_cast<TOut>((*this)(_in[i]));
+        }
+    });
+}
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <numeric>
+
+#include <mitkSmartPointerProperty.h>
+#include <vtkIdList.h>
+#include <vtkSmartPointer.h>
+
+#include "ElementWeights.h"
+#include "Parallel.h"
+
+namespace {
+    const char *propertyName = "materialmapping.ElementWeights";
+    const std::size_t minimumElementsPerThread = 1 << 12;
+}
+
+namespace {
+    // meshes may be mapped concurrently, the property list is not thread safe
+    std::mutex propertyMutex;
+
+    ElementWeights::Pointer findValidWeights(mitk::UnstructuredGrid *_mesh) {
+        auto property = dynamic_cast<mitk::SmartPointerProperty *>(_mesh->GetProperty(propertyName).GetPointer());
+        if (property) {
+            ElementWeights::Pointer weights = dynamic_cast<ElementWeights *>(property->GetSmartPointer().GetPointer());
+            if (weights.IsNotNull() && weights->IsValidFor(_mesh->GetVtkUnstructuredGrid())) {
+                return weights;
+            }
+        }
+        return nullptr;
+    }
+}
+
+ElementWeights::Pointer ElementWeights::GetOrCreate(mitk::UnstructuredGrid *_mesh, bool *_created) {
+    if (_created) {
+        *_created = false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(propertyMutex);
+        auto weights = findValidWeights(_mesh);
+        if (weights.IsNotNull()) {
+            return weights;
+        }
+    }
+
+    // computed without holding the lock, so other meshes are not blocked. If the same mesh was computed concurrently,
+    // the weights attached first are kept
+    auto weights = ElementWeights::New();
+    weights->Compute(_mesh->GetVtkUnstructuredGrid());
+
+    std::lock_guard<std::mutex> lock(propertyMutex);
+    auto attached = findValidWeights(_mesh);
+    if (attached.IsNotNull()) {
+        return attached;
+    }
+    _mesh->SetProperty(propertyName, mitk::SmartPointerProperty::New(weights.GetPointer()));
+    if (_created) {
+        *_created = true;
+    }
+    return weights;
+}
+
+void ElementWeights::Detach(mitk::UnstructuredGrid *_mesh) {
+    std::lock_guard<std::mutex> lock(propertyMutex);
+    _mesh->GetPropertyList()->DeleteProperty(propertyName);
+}
+
+void ElementWeights::Compute(vtkUnstructuredGridBase *_mesh) {
+    m_Mesh = _mesh;
+    m_MeshTime = _mesh->GetMTime();
+    m_NumberOfPoints = _mesh->GetNumberOfPoints();
+
+    auto numberOfCells = _mesh->GetNumberOfCells();
+    m_Offsets.assign(numberOfCells + 1, 0);
+    auto pointIds = vtkSmartPointer<vtkIdList>::New();
+    for (vtkIdType i = 0; i < numberOfCells; ++i) {
+        _mesh->GetCellPoints(i, pointIds);
+        m_Offsets[i + 1] = m_Offsets[i] + pointIds->GetNumberOfIds();
+    }
+    auto wide = static_cast<unsigned long long>(m_NumberOfPoints) > std::numeric_limits<std::uint32_t>::max();
+    m_Nodes.assign(wide ? 0 : m_Offsets.back(), 0);
+    m_WideNodes.assign(wide ? m_Offsets.back() : 0, 0);
+    m_Weights.resize(m_Offsets.back());
+    m_Denominators.resize(numberOfCells);
+
+    // each thread reads the connectivity into its own id list and reuses its buffers, no vtkCell is created
+    Parallel::For(numberOfCells, minimumElementsPerThread, [&](vtkIdType, vtkIdType _begin, vtkIdType _end) {
+        auto pointIds = vtkSmartPointer<vtkIdList>::New();
+        std::vector<std::array<double, 3>> cellpoints;
+        std::vector<double> squaredDistances;
+
+        for (auto i = _begin; i < _end; ++i) {
+            _mesh->GetCellPoints(i, pointIds);
+            auto numberOfNodes = pointIds->GetNumberOfIds();
+            cellpoints.resize(numberOfNodes);
+            squaredDistances.resize(numberOfNodes);
+
+            // get centroid
+            double centroid[3] = {0, 0, 0};
+            for (auto j = 0; j < numberOfNodes; ++j) {
+                auto &cellpoint = cellpoints[j];
+                _mesh->GetPoint(pointIds->GetId(j), cellpoint.data());
+                for (auto k = 0; k < 3; ++k) {
+                    centroid[k] = (centroid[k] * j + cellpoint[k]) / (j + 1);
+                }
+            }
+
+            // calculate nodal weight = squared distance to centroid
+            double minDistance = std::numeric_limits<double>::max();
+            for (auto j = 0; j < numberOfNodes; ++j) {
+                const auto &cellpoint = cellpoints[j];
+                double squaredDistance = 0;
+                for (auto k = 0; k < 3; ++k) {
+                    auto d = cellpoint[k] - centroid[k];
+                    squaredDistance += d * d;
+                }
+                squaredDistance = std::sqrt(squaredDistance);
+                squaredDistances[j] = squaredDistance;
+
+                // if a node aligns with the centroid, we set it's weight to the next closest one
+                if (squaredDistance == 0)
+                    squaredDistance = 1;
+
+                if (squaredDistance < minDistance)
+                    minDistance = squaredDistance;
+            }
+
+            // invert weight and normalize so the node closest to the centroid has a weight of 1.0
+            double denom = 0;
+            for (auto j = 0; j < numberOfNodes; ++j) {
+                auto normalizedWeight = minDistance / squaredDistances[j];
+                denom += normalizedWeight;
+                if (wide) {
+                    m_WideNodes[m_Offsets[i] + j] = pointIds->GetId(j);
+                } else {
+                    m_Nodes[m_Offsets[i] + j] = static_cast<std::uint32_t>(pointIds->GetId(j));
+                }
+                m_Weights[m_Offsets[i] + j] = normalizedWeight;
+            }
+            m_Denominators[i] = denom;
+        }
+    });
+}
+
+bool ElementWeights::IsValidFor(vtkUnstructuredGridBase *_mesh) const {
+    return _mesh == m_Mesh && _mesh->GetMTime() == m_MeshTime && _mesh->GetNumberOfPoints() == m_NumberOfPoints &&
+           _mesh->GetNumberOfCells() == GetNumberOfElements();
+}
+
+void ElementWeights::Apply(const double *_nodeValues, double *_elementValues) const {
+    Apply(_nodeValues, _elementValues, nullptr, GetNumberOfElements());
+}
+
+void ElementWeights::Apply(const double *_nodeValues, double *_elementValues, const vtkIdType *_elements,
+                           vtkIdType _numberOfElements) const {
+    if (m_WideNodes.empty()) {
+        Apply(m_Nodes, _nodeValues, _elementValues, _elements, _numberOfElements);
+    } else {
+        Apply(m_WideNodes, _nodeValues, _elementValues, _elements, _numberOfElements);
+    }
+}
+
+template<class TIndex>
+void ElementWeights::Apply(const std::vector<TIndex> &_nodes, const double *_nodeValues, double *_elementValues,
+                           const vtkIdType *_elements, vtkIdType _numberOfElements) const {
+    Parallel::For(_numberOfElements, minimumElementsPerThread, [&](vtkIdType, vtkIdType _begin, vtkIdType _end) {
+        for (auto k = _begin; k < _end; ++k) {
+            auto i = _elements ? _elements[k] : k;
+            double value = 0;
+            for (auto j = m_Offsets[i]; j < m_Offsets[i + 1]; ++j) {
+                value += m_Weights[j] * _nodeValues[_nodes[j]];
+            }
+            _elementValues[i] = value / m_Denominators[i];
+        }
+    });
+}
+
+void ElementWeights::GroupElements(const int *_nodeGroups, int _numberOfGroups, std::vector<vtkIdType> &_elements,
+                                   std::vector<vtkIdType> &_starts) const {
+    std::vector<int> elementGroups(GetNumberOfElements());
+    if (m_WideNodes.empty()) {
+        GroupElements(m_Nodes, _nodeGroups, elementGroups);
+    } else {
+        GroupElements(m_WideNodes, _nodeGroups, elementGroups);
+    }
+
+    // counting sort by group, the elements of a group stay in ascending order
+    _starts.assign(_numberOfGroups + 1, 0);
+    for (auto group : elementGroups) {
+        ++_starts[group + 1];
+    }
+    std::partial_sum(_starts.begin(), _starts.end(), _starts.begin());
+    _elements.resize(elementGroups.size());
+    auto next = _starts;
+    for (vtkIdType i = 0; i < GetNumberOfElements(); ++i) {
+        _elements[next[elementGroups[i]]++] = i;
+    }
+}
+
+template<class TIndex>
+void ElementWeights::GroupElements(const std::vector<TIndex> &_nodes, const int *_nodeGroups,
+                                   std::vector<int> &_elementGroups) const {
+    Parallel::For(GetNumberOfElements(), minimumElementsPerThread, [&](vtkIdType, vtkIdType _begin, vtkIdType _end) {
+        for (auto i = _begin; i < _end; ++i) {
+            auto group = 0;
+            for (auto j = m_Offsets[i]; j < m_Offsets[i + 1]; ++j) {
+                group = std::max(group, _nodeGroups[_nodes[j]]);
+            }
+            _elementGroups[i] = group;
+        }
+    });
+}
+
+std::size_t ElementWeights::GetMemorySize() const {
+    return m_Offsets.size() * sizeof(vtkIdType) + m_Nodes.size() * sizeof(std::uint32_t) +
+           m_WideNodes.size() * sizeof(vtkIdType) + (m_Weights.size() + m_Denominators.size()) * sizeof(double);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <itkObject.h>
+#include <mitkCommon.h>
+#include <mitkUnstructuredGrid.h>
+#include <vtkUnstructuredGridBase.h>
+
+/**
+ * Node weights of the element values of a mesh, as a sparse matrix in compressed row storage (CSR).
+ *
+ * An element value is the average of its node values, weighted by the inverse distance of the nodes to the element
+ * centroid (normalised so the node closest to the centroid has weight 1). The weights only depend on the geometry, so
+ * they are computed once and attached to the mesh (see GetOrCreate()). Averaging the node values of a mapping is then a
+ * single parallel sparse matrix-vector product. Results are bit-identical to computing the weights for every mapping.
+ */
+class ElementWeights : public itk::Object {
+public:
+    mitkClassMacroItkParent(ElementWeights, itk::Object)
+
+    itkFactorylessNewMacro(Self)
+
+    /**
+     * The weights attached to _mesh. They are computed and attached if missing or if the mesh changed since, which is
+     * reported in _created. Meshes may be mapped concurrently, only the lookup and the attachment are serialised, not
+     * the computation.
+     */
+    static ElementWeights::Pointer GetOrCreate(mitk::UnstructuredGrid *_mesh, bool *_created = nullptr);
+
+    /**
+     * Removes the weights attached to _mesh, the next GetOrCreate() computes them again.
+     */
+    static void Detach(mitk::UnstructuredGrid *_mesh);
+
+    void Compute(vtkUnstructuredGridBase *_mesh);
+
+    /**
+     * True if the weights were computed for _mesh and it did not change since.
+     */
+    bool IsValidFor(vtkUnstructuredGridBase *_mesh) const;
+
+    /**
+     * Writes the weighted average of _nodeValues to _elementValues, one value per element.
+     */
+    void Apply(const double *_nodeValues, double *_elementValues) const;
+
+    /**
+     * Writes the weighted average of _nodeValues to the _numberOfElements elements listed in _elements only.
+     */
+    void Apply(const double *_nodeValues, double *_elementValues, const vtkIdType *_elements,
+               vtkIdType _numberOfElements) const;
+
+    /**
+     * Sorts the elements by the last group of their nodes, e.g. to average them as soon as the values of all their nodes
+     * are known. _nodeGroups holds a group in [0, _numberOfGroups) per node. The elements of group g are written to
+     * _elements[_starts[g]] to _elements[_starts[g + 1] - 1].
+     */
+    void GroupElements(const int *_nodeGroups, int _numberOfGroups, std::vector<vtkIdType> &_elements,
+                       std::vector<vtkIdType> &_starts) const;
+
+    vtkIdType GetNumberOfElements() const {
+        return static_cast<vtkIdType>(m_Denominators.size());
+    }
+
+    std::size_t GetMemorySize() const;
+
+private:
+    // applies the rows _elements[0 .. _numberOfElements), or the rows 0 to _numberOfElements - 1 if _elements is null
+    template<class TIndex>
+    void Apply(const std::vector<TIndex> &_nodes, const double *_nodeValues, double *_elementValues,
+               const vtkIdType *_elements, vtkIdType _numberOfElements) const;
+
+    template<class TIndex>
+    void GroupElements(const std::vector<TIndex> &_nodes, const int *_nodeGroups, std::vector<int> &_elementGroups) const;
+
+    std::vector<vtkIdType> m_Offsets;  // row i is [m_Offsets[i], m_Offsets[i + 1])
+    std::vector<std::uint32_t> m_Nodes; // column indices, if all point ids fit into 32 bit
+    std::vector<vtkIdType> m_WideNodes; // column indices of meshes with more points
+    std::vector<double> m_Weights;
+    std::vector<double> m_Denominators; // sum of the weights of each row, the row sum is divided by it
+
+    // the mesh the weights were computed for, only used for comparison
+    const vtkUnstructuredGridBase *m_Mesh = nullptr;
+    unsigned long m_MeshTime = 0;
+    vtkIdType m_NumberOfPoints = 0;
+};
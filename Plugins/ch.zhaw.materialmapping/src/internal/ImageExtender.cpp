@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+
+#include "ImageExtender.h"
+#include "Parallel.h"
+
+namespace {
+    // weights of the 3x3x3 neighbourhood, 1/sqrt(distance). Symmetric, so the index order does not matter.
+    const double kernel[27] = {
+            1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
+            1 / sqrt(2), 1, 1 / sqrt(2),
+            1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
+            1 / sqrt(2), 1, 1 / sqrt(2),
+            1, 0, 1,
+            1 / sqrt(2), 1, 1 / sqrt(2),
+            1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
+            1 / sqrt(2), 1, 1 / sqrt(2),
+            1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3)
+    };
+
+    // the Old kernel works with float weights
+    struct FloatKernel {
+        float weights[27];
+
+        FloatKernel() {
+            for (auto i = 0; i < 27; ++i) {
+                weights[i] = static_cast<float>(kernel[i]);
+            }
+        }
+    };
+    const FloatKernel floatKernel;
+
+    const std::size_t minimumVoxelsPerThread = 1 << 12;
+
+    // voxels of a dense image in raster order, indexed from 0. The units scanned in parallel are the slices
+    struct DenseLayout {
+        int extent[6];
+        vtkIdType sliceSize;
+
+        explicit DenseLayout(const int _dim[3])
+                : extent{0, _dim[0] - 1, 0, _dim[1] - 1, 0, _dim[2] - 1},
+                  sliceSize(static_cast<vtkIdType>(_dim[0]) * _dim[1]) {
+        }
+
+        const int *GetExtent() const {
+            return extent;
+        }
+
+        void GetIndex(vtkIdType _i, int &_x, int &_y, int &_z) const {
+            _x = static_cast<int>(_i % (extent[1] + 1));
+            _y = static_cast<int>((_i / (extent[1] + 1)) % (extent[3] + 1));
+            _z = static_cast<int>(_i / sliceSize);
+        }
+
+        vtkIdType GetNeighborId(vtkIdType _i, int, int, int, int _dx, int _dy, int _dz) const {
+            return _i + _dx + _dy * (extent[1] + 1) + _dz * sliceSize;
+        }
+
+        bool IsStored(vtkIdType) const {
+            return true;
+        }
+
+        std::size_t GetNumberOfUnits() const {
+            return static_cast<std::size_t>(extent[5] + 1);
+        }
+
+        template<class TFunction>
+        void ForEachVoxel(std::size_t _unit, TFunction _function) const {
+            auto i = static_cast<vtkIdType>(_unit) * sliceSize;
+            for (auto y = 0; y <= extent[3]; ++y) {
+                for (auto x = 0; x <= extent[1]; ++x, ++i) {
+                    _function(i, x, y, static_cast<int>(_unit));
+                }
+            }
+        }
+    };
+
+    // voxels of the active tiles of a TileGrid with absolute indices. The units scanned in parallel are the blocks
+    struct TiledLayout {
+        const TileGrid &grid;
+
+        const int *GetExtent() const {
+            return grid.GetExtent();
+        }
+
+        void GetIndex(vtkIdType _i, int &_x, int &_y, int &_z) const {
+            grid.GetIndex(_i, _x, _y, _z);
+        }
+
+        vtkIdType GetNeighborId(vtkIdType _i, int _x, int _y, int _z, int _dx, int _dy, int _dz) const {
+            return grid.GetNeighborId(_i, _x, _y, _z, _dx, _dy, _dz);
+        }
+
+        bool IsStored(vtkIdType _i) const {
+            return grid.IsStored(_i);
+        }
+
+        std::size_t GetNumberOfUnits() const {
+            return grid.GetNumberOfBlocks();
+        }
+
+        template<class TFunction>
+        void ForEachVoxel(std::size_t _unit, TFunction _function) const {
+            grid.ForEachVoxel(_unit, _function);
+        }
+    };
+}
+
+ImageExtender::ImageExtender(vtkImageData *_img, vtkImageData *_mask, Method _method)
+        : m_Image(static_cast<float *>(_img->GetScalarPointer())),
+          m_Mask(static_cast<unsigned char *>(_mask->GetScalarPointer())),
+          m_Grid(nullptr),
+          m_Method(_method),
+          m_NormalizeMask(false) {
+    assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
+    assert(_mask->GetScalarType() == VTK_UNSIGNED_CHAR && "Mask scalar type needs to be unsigned char!");
+    _img->GetDimensions(m_Dim);
+    initialize(DenseLayout(m_Dim));
+}
+
+ImageExtender::ImageExtender(float *_img, unsigned char *_mask, const TileGrid &_grid, Method _method)
+        : m_Image(_img),
+          m_Mask(_mask),
+          m_Grid(&_grid),
+          m_Method(_method),
+          m_NormalizeMask(false) {
+    for (auto i = 0; i < 3; ++i) {
+        m_Dim[i] = _grid.GetExtent()[2 * i + 1] - _grid.GetExtent()[2 * i] + 1;
+    }
+    initialize(TiledLayout{_grid});
+}
+
+template<class TLayout>
+void ImageExtender::initialize(const TLayout &_layout) {
+    // initial frontier, the units (slices or blocks) are scanned in parallel and concatenated in order
+    const auto numberOfUnits = _layout.GetNumberOfUnits();
+    std::vector<std::vector<vtkIdType>> frontiers(Parallel::NumberOfChunks(numberOfUnits, 1));
+    std::atomic<bool> normalizeMask(false);
+    Parallel::For(numberOfUnits, 1, [&](std::size_t _thread, std::size_t _begin, std::size_t _end) {
+        auto &frontier = frontiers[_thread];
+        auto normalize = false;
+        for (auto unit = _begin; unit < _end; ++unit) {
+            _layout.ForEachVoxel(unit, [&](vtkIdType _i, int _x, int _y, int _z) {
+                if (m_Mask[_i]) {
+                    normalize = normalize || m_Mask[_i] != 1 || isBorder(_layout, _x, _y, _z);
+                } else if ((m_Method == Method::New || !isBorder(_layout, _x, _y, _z)) &&
+                           hasMaskedNeighbour(_layout, _i, _x, _y, _z)) {
+                    frontier.push_back(_i);
+                }
+            });
+        }
+        if (normalize) {
+            normalizeMask = true;
+        }
+    });
+    m_NormalizeMask = m_Method == Method::Old && normalizeMask;
+
+    for (const auto &frontier : frontiers) {
+        m_Frontier.insert(m_Frontier.end(), frontier.begin(), frontier.end());
+    }
+}
+
+void ImageExtender::Step(bool _maxVal) {
+    if (m_Grid) {
+        step(TiledLayout{*m_Grid}, _maxVal);
+    } else {
+        step(DenseLayout(m_Dim), _maxVal);
+    }
+}
+
+template<class TLayout>
+void ImageExtender::step(const TLayout &_layout, bool _maxVal) {
+    // all frontier voxels are evaluated before anything is written
+    const auto frontierSize = m_Frontier.size();
+    std::vector<float> values(frontierSize);
+    std::vector<char> extended(frontierSize);
+    Parallel::For(frontierSize, minimumVoxelsPerThread, [&](std::size_t, std::size_t _begin, std::size_t _end) {
+        for (auto k = _begin; k < _end; ++k) {
+            extended[k] = evaluate(m_Image, m_Mask, _layout, m_Method, m_Frontier[k], values[k]);
+        }
+    });
+
+    if (m_NormalizeMask) {
+        normalizeOldMask(_layout);
+        m_NormalizeMask = false;
+    }
+
+    Parallel::For(frontierSize, minimumVoxelsPerThread, [&](std::size_t, std::size_t _begin, std::size_t _end) {
+        for (auto k = _begin; k < _end; ++k) {
+            if (extended[k]) {
+                auto i = m_Frontier[k];
+                if (!_maxVal || m_Image[i] < values[k]) {
+                    m_Image[i] = values[k];
+                }
+                m_Mask[i] = 1;
+            }
+        }
+    });
+
+    // the next frontier: unmasked neighbours of the extended voxels and the frontier voxels that are still pending
+    std::vector<std::vector<vtkIdType>> frontiers(Parallel::NumberOfChunks(frontierSize, minimumVoxelsPerThread));
+    Parallel::For(frontierSize, minimumVoxelsPerThread, [&](std::size_t _thread, std::size_t _begin, std::size_t _end) {
+        auto &frontier = frontiers[_thread];
+        const auto extent = _layout.GetExtent();
+        for (auto k = _begin; k < _end; ++k) {
+            auto i = m_Frontier[k];
+            int x, y, z;
+            _layout.GetIndex(i, x, y, z);
+            if (!extended[k]) {
+                if (hasMaskedNeighbour(_layout, i, x, y, z)) {
+                    frontier.push_back(i);
+                }
+                continue;
+            }
+
+            for (auto dz = -1; dz <= 1; ++dz) {
+                for (auto dy = -1; dy <= 1; ++dy) {
+                    for (auto dx = -1; dx <= 1; ++dx) {
+                        if (x + dx < extent[0] || x + dx > extent[1] || y + dy < extent[2] || y + dy > extent[3] ||
+                            z + dz < extent[4] || z + dz > extent[5]) {
+                            continue;
+                        }
+                        auto n = _layout.GetNeighborId(i, x, y, z, dx, dy, dz);
+                        if (!m_Mask[n] && _layout.IsStored(n) &&
+                            (m_Method == Method::New || !isBorder(_layout, x + dx, y + dy, z + dz))) {
+                            frontier.push_back(n);
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    m_Frontier.clear();
+    for (const auto &frontier : frontiers) {
+        m_Frontier.insert(m_Frontier.end(), frontier.begin(), frontier.end());
+    }
+    std::sort(m_Frontier.begin(), m_Frontier.end());
+    m_Frontier.erase(std::unique(m_Frontier.begin(), m_Frontier.end()), m_Frontier.end());
+}
+
+template<class TLayout>
+bool ImageExtender::evaluate(const float *_img, const unsigned char *_mask, const TLayout &_layout, Method _method,
+                             vtkIdType _i, float &_value) {
+    int x, y, z;
+    _layout.GetIndex(_i, x, y, z);
+    if (_method == Method::Old) {
+        return !isBorder(_layout, x, y, z) && evaluateOld(_img, _mask, _layout, _i, x, y, z, _value);
+    }
+    return evaluateNew(_img, _mask, _layout, _i, x, y, z, _value);
+}
+
+template<class TLayout>
+bool ImageExtender::evaluateOld(const float *_img, const unsigned char *_mask, const TLayout &_layout, vtkIdType _i,
+                                int _x, int _y, int _z, float &_value) {
+    // same operations in the same order as extendsurface, which iterates y, x, z. Border voxels are not evaluated, so
+    // all neighbours lie within the image
+    const auto c = reinterpret_cast<const char *>(_mask);
+    vtkIdType neighbours[27];
+
+    float s = 0;
+    for (auto dy = -1; dy <= 1; ++dy) {
+        for (auto dx = -1; dx <= 1; ++dx) {
+            for (auto dz = -1; dz <= 1; ++dz) {
+                auto k = (dy + 1) + 3 * ((dx + 1) + 3 * (dz + 1));
+                auto n = neighbours[k] = _layout.GetNeighborId(_i, _x, _y, _z, dx, dy, dz);
+                s += floatKernel.weights[k] * c[n];
+            }
+        }
+    }
+    if (!s) {
+        return false;
+    }
+
+    float t = 0;
+    for (auto dy = -1; dy <= 1; ++dy) {
+        for (auto dx = -1; dx <= 1; ++dx) {
+            for (auto dz = -1; dz <= 1; ++dz) {
+                auto k = (dy + 1) + 3 * ((dx + 1) + 3 * (dz + 1));
+                auto n = neighbours[k];
+                t += (floatKernel.weights[k] * _img[n] * c[n]);
+            }
+        }
+    }
+    _value = t / s;
+    return true;
+}
+
+template<class TLayout>
+bool ImageExtender::evaluateNew(const float *_img, const unsigned char *_mask, const TLayout &_layout, vtkIdType _i,
+                                int _x, int _y, int _z, float &_value) {
+    // same operations in the same order as vtkImageMathematics and vtkImageConvolve, which iterates z, y, x
+    const auto extent = _layout.GetExtent();
+    double maskSum = 0;
+    double imageSum = 0;
+    auto kernelIdx = 0;
+    for (auto dz = -1; dz <= 1; ++dz) {
+        for (auto dy = -1; dy <= 1; ++dy) {
+            for (auto dx = -1; dx <= 1; ++dx, ++kernelIdx) {
+                if (_x + dx < extent[0] || _x + dx > extent[1] || _y + dy < extent[2] || _y + dy > extent[3] ||
+                    _z + dz < extent[4] || _z + dz > extent[5]) {
+                    continue; // zero boundary
+                }
+                auto n = _layout.GetNeighborId(_i, _x, _y, _z, dx, dy, dz);
+                auto mask = static_cast<float>(_mask[n]);
+                float maskedImage = _img[n] * mask;
+                imageSum += maskedImage * kernel[kernelIdx];
+                maskSum += mask * kernel[kernelIdx];
+            }
+        }
+    }
+
+    auto convMask = static_cast<float>(maskSum);
+    if (!convMask) {
+        return false;
+    }
+    _value = static_cast<float>(imageSum) / convMask;
+    return true;
+}
+
+template<class TLayout>
+bool ImageExtender::isBorder(const TLayout &_layout, int _x, int _y, int _z) {
+    const auto extent = _layout.GetExtent();
+    return _x == extent[0] || _y == extent[2] || _z == extent[4] || _x == extent[1] || _y == extent[3] ||
+           _z == extent[5];
+}
+
+template<class TLayout>
+bool ImageExtender::hasMaskedNeighbour(const TLayout &_layout, vtkIdType _i, int _x, int _y, int _z) const {
+    const auto extent = _layout.GetExtent();
+    for (auto dz = -1; dz <= 1; ++dz) {
+        for (auto dy = -1; dy <= 1; ++dy) {
+            for (auto dx = -1; dx <= 1; ++dx) {
+                if (_x + dx < extent[0] || _x + dx > extent[1] || _y + dy < extent[2] || _y + dy > extent[3] ||
+                    _z + dz < extent[4] || _z + dz > extent[5]) {
+                    continue;
+                }
+                if (m_Mask[_layout.GetNeighborId(_i, _x, _y, _z, dx, dy, dz)]) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+template<class TLayout>
+void ImageExtender::normalizeOldMask(const TLayout &_layout) {
+    Parallel::For(_layout.GetNumberOfUnits(), 1, [&](std::size_t, std::size_t _begin, std::size_t _end) {
+        for (auto unit = _begin; unit < _end; ++unit) {
+            _layout.ForEachVoxel(unit, [&](vtkIdType _i, int _x, int _y, int _z) {
+                if (m_Mask[_i]) {
+                    m_Mask[_i] = isBorder(_layout, _x, _y, _z) ? 0 : 1;
+                }
+            });
+        }
+    });
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <vtkImageData.h>
+#include <vtkType.h>
+
+#include "TileGrid.h"
+
+/**
+ * Extends a float image beyond a mask, one voxel layer per Step(). Each unmasked voxel next to the mask gets the
+ * weighted average of its masked 26-neighbourhood and is added to the mask.
+ *
+ * Only the frontier (unmasked voxels with a masked neighbour) can change in a step, so the extender keeps the frontier
+ * between steps and only evaluates those voxels, in parallel. The mask is scanned once on construction. Results are
+ * bit-identical to the former implementations:
+ *  - Old: the extendsurface C kernel of the original MATLAB implementation. Border voxels are never extended and are
+ *    removed from the mask, mask values are treated as signed char.
+ *  - New: mask multiplication followed by two vtkImageConvolve passes with a zero boundary.
+ *
+ * The image has to be float, the mask unsigned char, both with one component and the same dimensions. Both are
+ * modified in place and must outlive the extender. The same applies to the voxel data of a TileGrid, where the image
+ * border is the border of the grid extent and the voxels of inactive tiles are read as unmasked 0 and never extended.
+ */
+class ImageExtender {
+public:
+    enum class Method {
+        Old, New
+    };
+
+    ImageExtender(vtkImageData *_img, vtkImageData *_mask, Method _method);
+
+    /**
+     * Extends the voxel data _img with the mask _mask, both with _grid.GetStorageSize() values. The grid must outlive
+     * the extender.
+     */
+    ImageExtender(float *_img, unsigned char *_mask, const TileGrid &_grid, Method _method);
+
+    /**
+     * Extends the image by one voxel layer. If _maxVal is set, extended voxels keep their value if it is larger than
+     * the average.
+     */
+    void Step(bool _maxVal);
+
+    std::size_t GetFrontierSize() const {
+        return m_Frontier.size();
+    }
+
+private:
+    // the voxel ids and neighbors of a dense image or a TileGrid, see ImageExtender.cpp
+    template<class TLayout>
+    void initialize(const TLayout &_layout);
+    template<class TLayout>
+    void step(const TLayout &_layout, bool _maxVal);
+
+    // the weighted average an unmasked voxel _i gets in a step, false if the voxel is not extended. Thread safe.
+    template<class TLayout>
+    static bool evaluate(const float *_img, const unsigned char *_mask, const TLayout &_layout, Method _method,
+                         vtkIdType _i, float &_value);
+    template<class TLayout>
+    static bool evaluateOld(const float *_img, const unsigned char *_mask, const TLayout &_layout, vtkIdType _i, int _x,
+                            int _y, int _z, float &_value);
+    template<class TLayout>
+    static bool evaluateNew(const float *_img, const unsigned char *_mask, const TLayout &_layout, vtkIdType _i, int _x,
+                            int _y, int _z, float &_value);
+    template<class TLayout>
+    static bool isBorder(const TLayout &_layout, int _x, int _y, int _z);
+    template<class TLayout>
+    bool hasMaskedNeighbour(const TLayout &_layout, vtkIdType _i, int _x, int _y, int _z) const;
+    template<class TLayout>
+    void normalizeOldMask(const TLayout &_layout);
+
+    float *m_Image;
+    unsigned char *m_Mask;
+    int m_Dim[3];
+    const TileGrid *m_Grid;             // nullptr for a dense image
+    Method m_Method;
+    std::vector<vtkIdType> m_Frontier;  // sorted voxel ids
+    bool m_NormalizeMask;               // Old: the first step sets masked voxels to 1 and border voxels to 0
+};
@@ -0,0 +1,148 @@
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+#include "MappingReport.h"
+
+namespace {
+    std::string escapeJson(const std::string &_s) {
+        std::string escaped;
+        for (auto c : _s) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    // resets the peak resident memory of the process to its current value, false if that is not supported
+    bool resetPeakResident() {
+#if defined(__linux__)
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        clearRefs << "5";
+        clearRefs.flush();
+        return static_cast<bool>(clearRefs);
+#else
+        return false;
+#endif
+    }
+}
+
+void MappingReport::Clear() {
+    m_Stages.clear();
+    m_CurrentName.clear();
+}
+
+void MappingReport::Begin(std::string _name) {
+    m_CurrentName = std::move(_name);
+    m_CurrentPeakReset = resetPeakResident();
+    m_CurrentStartMemory = GetResidentMemory();
+    m_CurrentStart = std::chrono::steady_clock::now();
+}
+
+void MappingReport::End(std::size_t _estimatedDataKiB) {
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - m_CurrentStart;
+    auto memory = GetResidentMemory();
+    auto start = static_cast<long long>(m_CurrentStartMemory.currentKiB);
+
+    // without a reset, a peak that was not raised may stem from an earlier stage
+    auto peakKnown = memory.peakKiB > 0 && (m_CurrentPeakReset || memory.peakKiB > m_CurrentStartMemory.peakKiB);
+    m_Stages.push_back({m_CurrentName, duration.count(), _estimatedDataKiB,
+                        static_cast<long long>(memory.currentKiB) - start,
+                        peakKnown ? static_cast<long long>(memory.peakKiB) - start : -1});
+}
+
+double MappingReport::GetTotalSeconds() const {
+    auto total = 0.0;
+    for (const auto &stage : m_Stages) {
+        total += stage.seconds;
+    }
+    return total;
+}
+
+std::size_t MappingReport::GetTotalEstimatedDataKiB() const {
+    std::size_t total = 0;
+    for (const auto &stage : m_Stages) {
+        total += stage.estimatedDataKiB;
+    }
+    return total;
+}
+
+std::string MappingReport::ToJson() const {
+    std::ostringstream json;
+    json << "{\n  \"totalSeconds\": " << GetTotalSeconds() << ",\n  \"stages\": [";
+    for (std::size_t i = 0; i < m_Stages.size(); ++i) {
+        const auto &stage = m_Stages[i];
+        json << (i ? ",\n" : "\n") << "    {\"name\": \"" << escapeJson(stage.name) << "\", \"seconds\": " << stage.seconds
+             << ", \"estimatedDataKiB\": " << stage.estimatedDataKiB << ", \"residentDeltaKiB\": "
+             << stage.residentDeltaKiB << ", \"peakGrowthKiB\": " << stage.peakGrowthKiB << "}";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+
+bool MappingReport::WriteJson(const std::string &_filename) const {
+    std::ofstream file(_filename);
+    file << ToJson();
+    return static_cast<bool>(file);
+}
+
+MappingReport::ResidentMemory MappingReport::GetResidentMemory() {
+    ResidentMemory memory = {0, 0};
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        memory.currentKiB = counters.WorkingSetSize / 1024;
+        memory.peakKiB = counters.PeakWorkingSetSize / 1024;
+    }
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) ==
+        KERN_SUCCESS) {
+        memory.currentKiB = info.resident_size / 1024;
+        memory.peakKiB = info.resident_size_max / 1024;
+    }
+#elif defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        std::size_t kiB;
+        if (fields >> key >> kiB) {
+            if (key == "VmRSS:") {
+                memory.currentKiB = kiB;
+            } else if (key == "VmHWM:") {
+                memory.peakKiB = kiB;
+            }
+        }
+    }
+#endif
+    return memory;
+}
+
+std::ostream &operator<<(std::ostream &_out, const MappingReport &_report) {
+    auto flags = _out.flags();
+    auto precision = _out.precision();
+    _out << "stage timings (s), estimated created data (KiB), measured resident change and peak growth (KiB, -1 "
+            "unknown):";
+    for (const auto &stage : _report.GetStages()) {
+        _out << "\n  " << std::left << std::setw(32) << stage.name << std::right << std::fixed << std::setprecision(3)
+             << std::setw(10) << stage.seconds << std::setw(12) << stage.estimatedDataKiB << std::setw(12)
+             << stage.residentDeltaKiB << std::setw(12) << stage.peakGrowthKiB;
+    }
+    _out << "\n  " << std::left << std::setw(32) << "total" << std::right << std::fixed << std::setprecision(3)
+         << std::setw(10) << _report.GetTotalSeconds();
+    _out.flags(flags);
+    _out.precision(precision);
+    return _out;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Timing and memory of the stages of a material mapping run.
+ *
+ * Stages are recorded sequentially: Begin() starts a stage, End() records its wall time, the estimated memory of the
+ * data it created (as computed by the caller) and two measured values of the resident memory of the process: its
+ * change from Begin() to End() and its peak during the stage. On Linux, Begin() resets the peak of the process through
+ * /proc/self/clear_refs. Where it cannot be reset, the peak is only known for stages that raise the previous peak.
+ * The measured values cover the whole process: for concurrent mappings they include the other mappings, whose
+ * Begin() also resets the peak. The report can be written to a log or as JSON.
+ */
+class MappingReport {
+public:
+    struct Stage {
+        std::string name;
+        double seconds;
+        std::size_t estimatedDataKiB;   // memory of the data created by the stage, as estimated by the caller
+        long long residentDeltaKiB;     // measured change of the resident memory from Begin() to End()
+        long long peakGrowthKiB;        // measured peak resident memory during the stage minus the one at Begin(),
+                                        // -1 if unknown
+    };
+
+    void Clear();
+
+    void Begin(std::string _name);
+
+    /**
+     * Ends the stage started by the last Begin(). _estimatedDataKiB is the memory of the data created by the stage.
+     */
+    void End(std::size_t _estimatedDataKiB = 0);
+
+    const std::vector<Stage> &GetStages() const {
+        return m_Stages;
+    }
+
+    double GetTotalSeconds() const;
+
+    /**
+     * Sum of the estimated data created by all stages, e.g. the VOI, the masks and the other intermediates.
+     */
+    std::size_t GetTotalEstimatedDataKiB() const;
+
+    std::string ToJson() const;
+
+    bool WriteJson(const std::string &_filename) const;
+
+    /**
+     * Current and peak resident memory of the process, 0 if not available on this platform.
+     */
+    struct ResidentMemory {
+        std::size_t currentKiB;
+        std::size_t peakKiB;
+    };
+
+    static ResidentMemory GetResidentMemory();
+
+private:
+    std::vector<Stage> m_Stages;
+    std::string m_CurrentName;
+    std::chrono::steady_clock::time_point m_CurrentStart;
+    ResidentMemory m_CurrentStartMemory = {0, 0};
+    bool m_CurrentPeakReset = false;
+};
+
+std::ostream &operator<<(std::ostream &_out, const MappingReport &_report);
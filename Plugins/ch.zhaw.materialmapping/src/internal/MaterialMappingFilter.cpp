@@ -1,27 +1,37 @@
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
 #include <limits>
+#include <numeric>
+#include <vector>
 
 #include <vtkDoubleArray.h>
 #include <vtkCellArray.h>
+#include <vtkIdList.h>
 #include <vtkPointData.h>
 #include <vtkCellData.h>
+#include <vtkFieldData.h>
+#include <vtkIntArray.h>
 #include <vtkImageInterpolator.h>
+#include <vtkImageInterpolatorInternals.h>
 #include <vtkTetra.h>
-#include <vtkMetaImageWriter.h>
-#include <vtkUnstructuredGridGeometryFilter.h>
 #include <vtkExtractVOI.h>
-#include <vtkDataSetSurfaceFilter.h>
-#include <vtkPolyDataToImageStencil.h>
-#include <vtkImageContinuousErode3D.h>
-#include <vtkImageLogic.h>
-#include <vtkImageMathematics.h>
-#include <vtkImageConvolve.h>
 #include <vtkImageCast.h>
-#include <vtkImageConstantPad.h>
+#include <vtkTemplateAliasMacro.h>
 
+#include <mitkExceptionMacro.h>
 #include <mitkProgressBar.h>
 
+#include "GemIOResources.h"
 #include "MaterialMappingFilter.h"
+#include "Parallel.h"
+
+namespace
+{
+	const std::size_t mappedSlabSize = 64 << 20; // bytes of float VOI slices per slab of a mapped CT
+	const std::size_t minimumPointsPerThread = 1 << 10; // nodes or samples interpolated per thread at least
+}
 
 MaterialMappingFilter::MaterialMappingFilter()
         : m_PointArrayName("E"),
@@ -32,15 +42,40 @@ MaterialMappingFilter::MaterialMappingFilter()
 
 void MaterialMappingFilter::GenerateData()
 {
+	// the queued intermediate images are written before the update returns, on every path out of it
+	struct VerboseWriterReset
+	{
+		std::unique_ptr<AsyncImageWriter>& writer;
+		~VerboseWriterReset() { writer.reset(); }
+	} verboseWriterReset{m_VerboseWriter};
+
 	mitk::UnstructuredGrid::Pointer inputGrid = const_cast<mitk::UnstructuredGrid *>(this->GetInput());
-	if (inputGrid.IsNull() || m_IntensityImage == nullptr || m_IntensityImage.IsNull())
+	auto hasIntensityImage = m_IntensityImage != nullptr && m_IntensityImage.IsNotNull();
+	if (inputGrid.IsNull() || (!hasIntensityImage && m_IntensityImageFile.empty()))
 	{
 		return;
 	}
 
-	mitk::ProgressBar::GetInstance()->AddStepsToDo(7);
+	// a CT file is mapped, only the pages of the VOI are read
+	std::unique_ptr<MemoryMappedImage> mappedCt;
+	if (!m_IntensityImageFile.empty())
+	{
+		mappedCt = MemoryMappedImage::OpenMetaImage(m_IntensityImageFile);
+		if (!mappedCt)
+		{
+			return;
+		}
+	}
+
+	// one run maps all branches. The stages up to the stencil are shared, each branch adds 4 progress steps
+	auto branches = m_Branches;
+	if (branches.empty())
+	{
+		branches.push_back({m_DoPeelStep, m_PointArrayName, m_CellArrayName});
+	}
+	addProgressSteps(2 + 4 * branches.size());
+	m_Report.Clear();
 
-	auto importedVtkImage = const_cast<vtkImageData *>(m_IntensityImage->GetVtkImageData());
 	vtkSmartPointer<vtkUnstructuredGrid> vtkInputGrid = inputGrid->GetVtkUnstructuredGrid();
 
 	MITK_INFO("ch.zhaw.materialmapping") << "density functors";
@@ -48,7 +83,11 @@ void MaterialMappingFilter::GenerateData()
 	MITK_INFO("ch.zhaw.materialmapping") << m_PowerLawFunctor;
 
 	MITK_INFO("ch.zhaw.materialmapping") << "material mapping parameters";
-	MITK_INFO("ch.zhaw.materialmapping") << "peel step: " << m_DoPeelStep;
+	for (const auto &branch : branches)
+	{
+		MITK_INFO("ch.zhaw.materialmapping") << "peel step: " << branch.doPeelStep
+			<< " (point array: '" << branch.pointArrayName << "', cell array: '" << branch.cellArrayName << "')";
+	}
 	MITK_INFO("ch.zhaw.materialmapping") << "image extend: " << m_NumberOfExtendImageSteps;
 	MITK_INFO("ch.zhaw.materialmapping") << "minimum element value: " << m_MinimumElementValue;
 	MITK_INFO("ch.zhaw.materialmapping") << "method: " << (m_Method == Method::Old ? "old" : "new");
@@ -58,143 +97,397 @@ void MaterialMappingFilter::GenerateData()
 	// since the memory is shared between vtk and mitk, manually correcting it will break rendering. For now,
 	// we'll create a copy and work with that.
 	// TODO: keep an eye on this
-	auto mitkOrigin = m_IntensityImage->GetGeometry()->GetOrigin();
+	m_Report.Begin("ct import");
 	auto vtkImage = vtkSmartPointer<vtkImageData>::New();
-	vtkImage->ShallowCopy(importedVtkImage);
-	vtkImage->SetOrigin(mitkOrigin[0], mitkOrigin[1], mitkOrigin[2]);
-
-	if (m_VerboseOutput)
+	if (mappedCt)
 	{
-		writeMetaImageToVerboseOut("01_ct_input.mhd", vtkImage);
+		vtkImage->ShallowCopy(mappedCt->GetImage());
 	}
+	else
+	{
+		auto importedVtkImage = const_cast<vtkImageData *>(m_IntensityImage->GetVtkImageData());
+		auto mitkOrigin = m_IntensityImage->GetGeometry()->GetOrigin();
+		vtkImage->ShallowCopy(importedVtkImage);
+		vtkImage->SetOrigin(mitkOrigin[0], mitkOrigin[1], mitkOrigin[2]);
+	}
+	m_Report.End();
 
-	// we would not gain anything by handling integer type scalars individually, so it's easier to work with floats from the beginning
-	auto imageCast = vtkSmartPointer<vtkImageCast>::New();
-	imageCast->SetInputData(vtkImage);
-	imageCast->SetOutputScalarTypeToFloat();
-	imageCast->Update();
-	vtkImage = imageCast->GetOutput();
-	mitk::ProgressBar::GetInstance()->Progress();
-
-	if (m_VerboseOutput)
+	if (m_VerboseOutput && !mappedCt) // a mapped CT would be read completely
 	{
-		writeMetaImageToVerboseOut("02_ct_casted.mhd", vtkImage);
+		writeMetaImageToVerboseOut("01_ct_input.mhd", vtkImage, false); // the CT is only read
 	}
 
-	auto surface = extractSurface(vtkInputGrid);
-	auto voi = extractVOI(vtkImage, surface);
+	// the cells are decomposed into tetrahedra once, they define the VOI bounds and are rasterised into the stencil.
+	// Both are kept with the other geometry intermediates for the next update. Stages served from the cache report no
+	// data memory.
+	m_Report.Begin("tetrahedra");
+	auto previousCache = m_GeometryCache.get();
+	auto& cache = updateGeometryCache(vtkInputGrid, vtkImage);
+	const auto& voxelizer = *cache.voxelizer;
+	m_Report.End(&cache == previousCache ? 0 : voxelizer.GetMemorySize() / 1024);
+	if (!voxelizer.IsValid())
+	{
+		// an unsupported mesh would get an empty stencil, i.e. all values 0. The update fails instead
+		m_GeometryCache.reset();
+		progress(2 + 4 * branches.size());
+		mitkThrow() << "the mesh has " << vtkInputGrid->GetNumberOfPoints() << " points, the material mapping supports "
+			<< std::numeric_limits<std::uint32_t>::max() << " at most";
+	}
 
 	if (m_VerboseOutput)
 	{
-		writeMetaImageToVerboseOut("03_ct_voi.mhd", vtkImage);
+		writeMetaImageToVerboseOut("03_ct_voi.mhd", extractVOI(vtkImage, voxelizer.GetBounds()), false);
 	}
 
-	inplaceApplyFunctorsToImage(voi);
-	mitk::ProgressBar::GetInstance()->Progress();
+	// Only the VOI is read from the CT memory. It is evaluated to E and padded with 0 slices in the same pass. The VOI
+	// only stores its active tiles, all per-voxel stages up to the node interpolation only visit those
+	m_Report.Begin("voi tiles");
+	std::size_t tilesKiB = 0;
+	if (!cache.tiles)
+	{
+		cache.tiles.reset(new TileMask(createTileMask(vtkInputGrid, voxelizer, vtkImage, voxelizer.GetBounds())));
+		MITK_INFO("ch.zhaw.materialmapping") << "active VOI tiles: " << cache.tiles->GetNumberOfActiveTiles() << " of "
+			<< cache.tiles->GetNumberOfTiles();
+		tilesKiB = cache.tiles->GetMemorySize() / 1024;
+	}
+	m_Report.End(tilesKiB);
 
-	// pad with 0 slices
-	auto padder = vtkSmartPointer<vtkImageConstantPad>::New();
-	auto extent = voi->GetExtent();
-	auto border = static_cast<int>(m_NumberOfExtendImageSteps + 1);
-	int paddedExtents[6];
-	for (auto i = 0; i < 6; ++i)
+	m_Report.Begin("functor lookup table");
+	auto lookupTable = m_LookupTable;
+	if (!lookupTable)
 	{
-		paddedExtents[i] = extent[i] + border * (2 * (i % 2) - 1);
+		lookupTable = std::make_shared<const EMorganLookupTable>(m_BoneDensityFunctor, m_PowerLawFunctor);
 	}
-	padder->SetInputData(voi);
-	padder->SetOutputWholeExtent(paddedExtents);
-	padder->SetConstant(0);
-	padder->Update();
-	voi = padder->GetOutput();
+	m_Report.End(m_LookupTable ? 0 : (lookupTable->GetMaxCt() - lookupTable->GetMinCt() + 1) * sizeof(double) / 1024);
 
-	VtkImage stencil;
-	stencil = createStencil(surface, voi);
-	mitk::ProgressBar::GetInstance()->Progress();
+	// create ouput. Points, cells and the input arrays are shared with the input mesh, only the new arrays are added
+	m_Report.Begin("output");
+	auto out = vtkSmartPointer<vtkUnstructuredGrid>::New();
+	out->ShallowCopy(vtkInputGrid);
+	if (m_NumberOfMaterialBins > 0)
+	{
+		// the field data is shared as well, the material values are added to a copy
+		auto fieldData = vtkSmartPointer<vtkFieldData>::New();
+		fieldData->ShallowCopy(vtkInputGrid->GetFieldData());
+		out->SetFieldData(fieldData);
+	}
+	m_Report.End();
 
+	// the element weights only depend on the mesh. They are kept with the input mesh and reused by later updates and
+	// other filters mapping the same mesh
+	ElementWeights::Pointer elementWeights;
+	if (std::any_of(branches.begin(), branches.end(), [](const Branch& _b) { return _b.cellArrayName != ""; }))
+	{
+		m_Report.Begin("element weights");
+		bool created;
+		elementWeights = ElementWeights::GetOrCreate(inputGrid, &created);
+		m_Report.End(created ? elementWeights->GetMemorySize() / 1024 : 0);
+	}
 
-	MaterialMappingFilter::VtkImage mask;
-	if (m_DoPeelStep)
+	// the padded VOI is processed in z-slabs (see SetSlabSlices()), by default a single slab covers it. The erosion and each
+	// extend step reach one slice further, the trilinear sampling of the nodes one more: the halo keeps the values the
+	// nodes of the slab core read identical to the whole VOI
+	int paddedExtent[6];
+	computePaddedVOIExtent(vtkImage, voxelizer.GetBounds(), paddedExtent);
+	const auto paddedSlices = paddedExtent[5] - paddedExtent[4] + 1;
+	const auto halo = static_cast<int>(m_NumberOfExtendImageSteps) + 2;
+	auto slabSlices = static_cast<int>(m_SlabSlices);
+	if (slabSlices == 0 && mappedCt)
 	{
-		mask = createPeeledMask(voi, stencil);
+		auto sliceSize = static_cast<std::size_t>(paddedExtent[1] - paddedExtent[0] + 1) *
+			(paddedExtent[3] - paddedExtent[2] + 1) * sizeof(float);
+		slabSlices = std::max(static_cast<int>(mappedSlabSize / sliceSize), 4 * halo);
 	}
-	else
+	if (slabSlices == 0 || slabSlices > paddedSlices)
 	{
-		mask = stencil;
+		slabSlices = paddedSlices;
 	}
-	mitk::ProgressBar::GetInstance()->Progress();
-
-	if (m_VerboseOutput)
+	const auto numberOfSlabs = std::max(1, (paddedSlices + slabSlices - 1) / slabSlices);
+	const auto slabbed = numberOfSlabs > 1;
+	if (slabbed)
 	{
-		writeMetaImageToVerboseOut("04_e_voi.mhd", voi);
-		writeMetaImageToVerboseOut("05_stencil.mhd", stencil);
-		writeMetaImageToVerboseOut("06_peeled_mask.mhd", mask);
+		// each further slab adds the voi and stencil steps and 3 steps per branch, the elements are completed per slab
+		addProgressSteps((numberOfSlabs - 1) * (2 + 3 * branches.size()));
+		MITK_INFO("ch.zhaw.materialmapping") << "VOI slabs: " << numberOfSlabs << " of " << slabSlices << " slices, halo "
+			<< halo;
+
+		// the whole VOI is never rasterised, the cached masks of a previous update are released
+		std::vector<unsigned char>().swap(cache.stencil);
+		std::vector<unsigned char>().swap(cache.erodedStencil);
 	}
+	const auto progressSteps = 2 + 4 * branches.size() + (numberOfSlabs - 1) * (2 + 3 * branches.size());
 
-	for (auto i = 0u; i < m_NumberOfExtendImageSteps; ++i)
+	// the node and element values of each branch, filled slab by slab
+	std::vector<VtkDoubleArray> nodeData(branches.size()), elementData(branches.size());
+	std::vector<vtkIdType> slabSamples, slabSampleStarts, slabElements, slabElementStarts;
+
+	for (auto s = 0; s < numberOfSlabs; ++s)
 	{
-		switch (m_Method)
+		const auto coreBegin = paddedExtent[4] + s * slabSlices;
+		const auto coreEnd = std::min(coreBegin + slabSlices - 1, paddedExtent[5]);
+		const auto zBegin = slabbed ? std::max(coreBegin - halo, paddedExtent[4]) : paddedExtent[4];
+		const auto zEnd = slabbed ? std::min(coreEnd + halo, paddedExtent[5]) : paddedExtent[5];
+		auto slabVerbosePrefix = slabbed ? "slab" + std::to_string(s) + "_" : std::string();
+		auto slabReportPrefix = slabbed ? "slab " + std::to_string(s) + ": " : std::string();
+
+		m_Report.Begin(slabReportPrefix + "voi (read, functors, pad)");
+		int slabExtent[6] = {paddedExtent[0], paddedExtent[1], paddedExtent[2], paddedExtent[3], zBegin, zEnd};
+		TileGrid grid(*cache.tiles, slabExtent);
+		auto voi = createEVOI(vtkImage, voxelizer.GetBounds(), *lookupTable, grid, mappedCt.get());
+		if (voi.empty())
+		{
+			// nothing is mapped, all progress steps are completed (the scalar type already fails the first slab)
+			m_Report.End();
+			progress(progressSteps);
+			return;
+		}
+		m_Report.End((grid.GetMemorySize() + voi.size() * sizeof(float)) / 1024);
+		progress();
+
+		// the stencil of a single slab is kept for the next update, the ones of several slabs are not
+		m_Report.Begin(slabReportPrefix + "stencil and node samples");
+		std::size_t stencilKiB = 0;
+		std::vector<unsigned char> slabStencil;
+		auto& stencil = slabbed ? slabStencil : cache.stencil;
+		if (stencil.empty())
+		{
+			stencil = voxelizer.CreateMask(grid);
+			stencilKiB = stencil.size() / 1024;
+		}
+		if (cache.nodeSamples.size() != static_cast<std::size_t>(vtkInputGrid->GetNumberOfPoints()))
+		{
+			cache.nodeSamples = createNodeSamples(vtkInputGrid, paddedExtent, vtkImage->GetOrigin(), vtkImage->GetSpacing());
+			stencilKiB += cache.nodeSamples.size() * sizeof(NodeSample) / 1024;
+		}
+		if (slabbed && s == 0)
 		{
-		case Method::Old:
+			// the samples of each slab core by the slice of their first corner, samples outside of the VOI are written
+			// by the first slab. The elements are averaged by the slab sampling the last of their nodes
+			std::vector<int> nodeSlabs(vtkInputGrid->GetNumberOfPoints(), 0);
+			slabSampleStarts.assign(numberOfSlabs + 1, 0);
+			for (const auto& sample : cache.nodeSamples)
 			{
-				inplaceExtendImageOld(voi, mask, true);
-				break;
+				if (sample.inside)
+				{
+					nodeSlabs[sample.pointId] = (sample.indices[4] - paddedExtent[4]) / slabSlices;
+				}
+				++slabSampleStarts[nodeSlabs[sample.pointId] + 1];
 			}
-
-		case Method::New:
+			std::partial_sum(slabSampleStarts.begin(), slabSampleStarts.end(), slabSampleStarts.begin());
+			slabSamples.resize(cache.nodeSamples.size());
+			auto next = slabSampleStarts;
+			for (std::size_t n = 0; n < cache.nodeSamples.size(); ++n)
 			{
-				inplaceExtendImage(voi, mask, true);
-				break;
+				slabSamples[next[nodeSlabs[cache.nodeSamples[n].pointId]]++] = n;
 			}
+			if (elementWeights)
+			{
+				elementWeights->GroupElements(nodeSlabs.data(), numberOfSlabs, slabElements, slabElementStarts);
+			}
+			stencilKiB += (slabSamples.size() + slabElements.size()) * sizeof(vtkIdType) / 1024;
 		}
+		m_Report.End(stencilKiB);
+		progress();
 
 		if (m_VerboseOutput)
 		{
-			writeMetaImageToVerboseOut("07_peeled_mask_extended_" + std::to_string(i) + ".mhd", mask);
-			writeMetaImageToVerboseOut("08_e_voi_extended_" + std::to_string(i) + ".mhd", voi);
+			writeMetaImageToVerboseOut(slabVerbosePrefix + "04_e_voi.mhd", grid.CreateImage(voi.data()), false);
+			writeMetaImageToVerboseOut(slabVerbosePrefix + "05_stencil.mhd", grid.CreateImage(stencil.data()), false);
 		}
-	}
-	mitk::ProgressBar::GetInstance()->Progress();
 
-    // create ouput
-    auto out = vtkSmartPointer<vtkUnstructuredGrid>::New();
-    out->DeepCopy(vtkInputGrid);
+		// the peeled mask of the slab, created by the first peeling branch
+		std::vector<unsigned char> slabErodedStencil;
+		auto& erodedStencil = slabbed ? slabErodedStencil : cache.erodedStencil;
+		for (auto b = 0u; b < branches.size(); ++b)
+		{
+			const auto &branch = branches[b];
+			auto verbosePrefix = slabVerbosePrefix + (branches.size() > 1 ? "branch" + std::to_string(b) + "_" : std::string());
+			auto reportPrefix = slabReportPrefix + (branches.size() > 1 ? "branch " + std::to_string(b) + ": " : std::string());
+
+			// the extend steps work in place, so all but the last branch work on a copy of the shared VOI. The cached
+			// stencil and peeled mask are never extended, each branch extends a copy.
+			std::vector<float> voiCopy;
+			auto& branchVoi = b + 1 < branches.size() ? voiCopy : voi;
+			if (b + 1 < branches.size())
+			{
+				m_Report.Begin(reportPrefix + "voi copy");
+				voiCopy = voi;
+				m_Report.End(voiCopy.size() * sizeof(float) / 1024);
+			}
 
-	auto nodeDataE = interpolateToNodes(vtkInputGrid, voi, m_PointArrayName, m_MinimumElementValue);
-	if(m_PointArrayName != "")
-	{
-		out->GetPointData()->AddArray(nodeDataE);
-	}
+			std::vector<unsigned char> mask;
+			std::size_t erodedStencilKiB = 0;
+			if (branch.doPeelStep)
+			{
+				m_Report.Begin(reportPrefix + "peel");
+				if (erodedStencil.empty())
+				{
+					erodedStencil = erodeMask(stencil, grid);
+					erodedStencilKiB = erodedStencil.size() / 1024;
+				}
+				mask = erodedStencil;
+			}
+			else
+			{
+				m_Report.Begin(reportPrefix + "mask copy");
+				mask = stencil;
+			}
+			m_Report.End(erodedStencilKiB + mask.size() / 1024);
+			progress();
+
+			if (m_VerboseOutput)
+			{
+				writeMetaImageToVerboseOut(verbosePrefix + "06_peeled_mask.mhd", grid.CreateImage(mask.data()), false);
+			}
+
+			m_Report.Begin(reportPrefix + "extend frontier");
+			auto extender = createImageExtender(branchVoi, mask, grid);
+			m_Report.End(extender.GetFrontierSize() * sizeof(vtkIdType) / 1024);
+			for (auto i = 0u; i < m_NumberOfExtendImageSteps; ++i)
+			{
+				m_Report.Begin(reportPrefix + "extend step " + std::to_string(i));
+				extender.Step(true);
+				m_Report.End(extender.GetFrontierSize() * sizeof(vtkIdType) / 1024);
+
+				if (m_VerboseOutput)
+				{
+					writeMetaImageToVerboseOut(verbosePrefix + "07_peeled_mask_extended_" + std::to_string(i) + ".mhd",
+					                           grid.CreateImage(mask.data()), false);
+					writeMetaImageToVerboseOut(verbosePrefix + "08_e_voi_extended_" + std::to_string(i) + ".mhd",
+					                           grid.CreateImage(branchVoi.data()), false);
+				}
+			}
+			progress();
+
+			// the nodes of the slab core, their corners lie within the slab
+			m_Report.Begin(reportPrefix + "node interpolation");
+			std::size_t nodeDataKiB = 0;
+			if (!nodeData[b])
+			{
+				nodeData[b] = vtkSmartPointer<vtkDoubleArray>::New();
+				nodeData[b]->SetNumberOfComponents(1);
+				nodeData[b]->SetName(branch.pointArrayName.c_str());
+				nodeData[b]->SetNumberOfTuples(vtkInputGrid->GetNumberOfPoints());
+				nodeDataKiB = nodeData[b]->GetActualMemorySize();
+			}
+			interpolateToNodes(cache.nodeSamples, slabbed ? slabSamples.data() + slabSampleStarts[s] : nullptr,
+			                   slabbed ? slabSampleStarts[s + 1] - slabSampleStarts[s] : static_cast<vtkIdType>(cache.nodeSamples.size()), grid,
+			                   branchVoi.data(), m_MinimumElementValue, nodeData[b]->GetPointer(0));
+			m_Report.End(nodeDataKiB);
+			if (s + 1 == numberOfSlabs && branch.pointArrayName != "")
+			{
+				out->GetPointData()->AddArray(nodeData[b]);
+			}
+			if (s + 1 < numberOfSlabs)
+			{
+				progress();
+			}
 
-    mitk::ProgressBar::GetInstance()->Progress();
+			// the elements whose nodes are all sampled now
+			if (branch.cellArrayName != "")
+			{
+				m_Report.Begin(reportPrefix + "element averaging");
+				std::size_t elementDataKiB = 0;
+				if (!elementData[b])
+				{
+					elementData[b] = vtkSmartPointer<vtkDoubleArray>::New();
+					elementData[b]->SetNumberOfComponents(1);
+					elementData[b]->SetName(branch.cellArrayName.c_str());
+					elementData[b]->SetNumberOfTuples(elementWeights->GetNumberOfElements());
+					elementDataKiB = elementData[b]->GetActualMemorySize();
+				}
+				if (slabbed)
+				{
+					elementWeights->Apply(nodeData[b]->GetPointer(0), elementData[b]->GetPointer(0),
+					                      slabElements.data() + slabElementStarts[s],
+					                      slabElementStarts[s + 1] - slabElementStarts[s]);
+				}
+				else
+				{
+					elementWeights->Apply(nodeData[b]->GetPointer(0), elementData[b]->GetPointer(0));
+				}
+				m_Report.End(elementDataKiB);
 
-    if(m_CellArrayName != "")
-    {
-        auto elementDataE = nodesToElements(vtkInputGrid, nodeDataE, m_CellArrayName);
-        out->GetCellData()->AddArray(elementDataE);
-    }
-    mitk::ProgressBar::GetInstance()->Progress();
+				if (s + 1 == numberOfSlabs)
+				{
+					out->GetCellData()->AddArray(elementData[b]);
+					if (m_NumberOfMaterialBins > 0)
+					{
+						m_Report.Begin(reportPrefix + "material bins");
+						addMaterialBins(out, elementData[b]);
+						m_Report.End(elementData[b]->GetNumberOfTuples() * sizeof(int) / 1024);
+					}
+				}
+			}
+			if (s + 1 == numberOfSlabs)
+			{
+				progress(2);
+			}
+		}
+	}
 
 	this->GetOutput()->SetVtkUnstructuredGrid(out);
+
+	MITK_INFO("ch.zhaw.materialmapping") << m_Report;
+	if (m_VerboseOutput)
+	{
+		m_Report.WriteJson(m_VerboseOutputDirectory + "/report.json");
+	}
 }
 
-MaterialMappingFilter::VtkUGrid MaterialMappingFilter::extractSurface(const VtkUGrid _volMesh) const
+MaterialMappingFilter::GeometryCache& MaterialMappingFilter::updateGeometryCache(const VtkUGrid _mesh,
+                                                                                const VtkImage _img)
 {
-	auto surfaceFilter = vtkSmartPointer<vtkUnstructuredGridGeometryFilter>::New();
-	surfaceFilter->SetInputData(_volMesh);
-	surfaceFilter->PassThroughCellIdsOn();
-	surfaceFilter->PassThroughPointIdsOn();
-	surfaceFilter->MergingOff();
-	surfaceFilter->Update();
-	return surfaceFilter->GetOutput();
+	// the mesh is compared by identity and modification time, the CT only by its geometry: its values are read anew
+	// on every update anyway
+	auto isValid = [&](const GeometryCache& _cache)
+		{
+			if (_cache.mesh != _mesh || _cache.meshTime != _mesh->GetMTime() ||
+				_cache.numberOfPoints != _mesh->GetNumberOfPoints() || _cache.numberOfCells != _mesh->GetNumberOfCells() ||
+				_cache.method != m_Method || _cache.numberOfExtendImageSteps != m_NumberOfExtendImageSteps ||
+				_cache.skipInactiveTiles != m_SkipInactiveTiles)
+			{
+				return false;
+			}
+			for (auto i = 0; i < 3; ++i)
+			{
+				if (_cache.extent[2 * i] != _img->GetExtent()[2 * i] ||
+					_cache.extent[2 * i + 1] != _img->GetExtent()[2 * i + 1] ||
+					_cache.origin[i] != _img->GetOrigin()[i] || _cache.spacing[i] != _img->GetSpacing()[i])
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+	if (m_GeometryCache && isValid(*m_GeometryCache))
+	{
+		MITK_INFO("ch.zhaw.materialmapping") << "reusing the geometry of the last update";
+		return *m_GeometryCache;
+	}
+
+	m_GeometryCache.reset(new GeometryCache());
+	auto& cache = *m_GeometryCache;
+	cache.mesh = _mesh;
+	cache.meshTime = _mesh->GetMTime();
+	cache.numberOfPoints = _mesh->GetNumberOfPoints();
+	cache.numberOfCells = _mesh->GetNumberOfCells();
+	_img->GetExtent(cache.extent);
+	_img->GetOrigin(cache.origin);
+	_img->GetSpacing(cache.spacing);
+	cache.method = m_Method;
+	cache.numberOfExtendImageSteps = m_NumberOfExtendImageSteps;
+	cache.skipInactiveTiles = m_SkipInactiveTiles;
+	cache.voxelizer.reset(new MeshVoxelizer(_mesh));
+	return cache;
 }
 
-MaterialMappingFilter::VtkImage MaterialMappingFilter::extractVOI(const VtkImage _img, const VtkUGrid _surMesh) const
+void MaterialMappingFilter::computeVOIExtent(const VtkImage _img, const double _bounds[6], int _voiExt[6]) const
 {
-	auto voi = vtkSmartPointer<vtkExtractVOI>::New();
 	auto spacing = _img->GetSpacing();
 	auto origin = _img->GetOrigin();
 	auto extent = _img->GetExtent();
-	auto bounds = _surMesh->GetBounds();
 
 	auto clamp = [](double x, int a, int b)
 		{
@@ -203,15 +496,59 @@ MaterialMappingFilter::VtkImage MaterialMappingFilter::extractVOI(const VtkImage
 
 	auto border = static_cast<int>(m_NumberOfExtendImageSteps + 1);
 
-	int voiExt[6];
 	for (auto i = 0; i < 2; ++i)
 	{
 		for (auto j = 0; j < 3; ++j)
 		{
-			auto val = (bounds[i + 2 * j] - origin[j]) / spacing[j] + (2 * i - 1) * border; // coordinate -> index
-			voiExt[i + 2 * j] = clamp(val, extent[2 * j], extent[2 * j + 1]); // prevent wrap around
+			auto val = (_bounds[i + 2 * j] - origin[j]) / spacing[j] + (2 * i - 1) * border; // coordinate -> index
+			_voiExt[i + 2 * j] = clamp(val, extent[2 * j], extent[2 * j + 1]); // prevent wrap around
 		}
 	}
+}
+
+void MaterialMappingFilter::computePaddedVOIExtent(const VtkImage _img, const double _bounds[6], int _paddedExt[6]) const
+{
+	int voiExt[6];
+	computeVOIExtent(_img, _bounds, voiExt);
+
+	auto border = static_cast<int>(m_NumberOfExtendImageSteps + 1);
+	for (auto i = 0; i < 6; ++i)
+	{
+		_paddedExt[i] = voiExt[i] + border * (2 * (i % 2) - 1);
+	}
+}
+
+TileMask MaterialMappingFilter::createTileMask(const VtkUGrid _mesh, const MeshVoxelizer& _voxelizer,
+                                               const VtkImage _img, const double _bounds[6]) const
+{
+	int paddedExtent[6];
+	computePaddedVOIExtent(_img, _bounds, paddedExtent);
+	TileMask tiles(paddedExtent, _img->GetOrigin(), _img->GetSpacing());
+	if (!m_SkipInactiveTiles)
+	{
+		tiles.ActivateAll();
+		return tiles;
+	}
+
+	// the mask and the voxels the extends reach lie within the tetrahedra dilated by the extend steps. The nodes read
+	// their direct neighbors, nodes not belonging to a tetrahedron included.
+	auto border = static_cast<int>(m_NumberOfExtendImageSteps + 1);
+	_voxelizer.ActivateTiles(tiles, border);
+	double point[6];
+	for (vtkIdType i = 0; i < _mesh->GetNumberOfPoints(); ++i)
+	{
+		_mesh->GetPoint(i, point);
+		double bounds[6] = {point[0], point[0], point[1], point[1], point[2], point[2]};
+		tiles.Activate(bounds, 1);
+	}
+	return tiles;
+}
+
+MaterialMappingFilter::VtkImage MaterialMappingFilter::extractVOI(const VtkImage _img, const double _bounds[6]) const
+{
+	auto voi = vtkSmartPointer<vtkExtractVOI>::New();
+	int voiExt[6];
+	computeVOIExtent(_img, _bounds, voiExt);
 	voi->SetVOI(voiExt);
 	voi->SetInputData(_img);
 	voi->Update();
@@ -232,197 +569,139 @@ MaterialMappingFilter::VtkImage MaterialMappingFilter::extractVOI(const VtkImage
 	}
 }
 
-MaterialMappingFilter::VtkImage MaterialMappingFilter::createStencil(const VtkUGrid _surMesh, const VtkImage _img) const
+namespace
 {
-	// configure
-	auto gridToPolyDataFilter = vtkSmartPointer<vtkDataSetSurfaceFilter>::New();
-
-	auto polyDataToStencilFilter = vtkSmartPointer<vtkPolyDataToImageStencil>::New();
-	polyDataToStencilFilter->SetOutputSpacing(_img->GetSpacing());
-	polyDataToStencilFilter->SetOutputOrigin(_img->GetOrigin());
-
-	auto blankImage = vtkSmartPointer<vtkImageData>::New();
-	blankImage->CopyStructure(_img);
-	blankImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-	unsigned char* p = (unsigned char *) (blankImage->GetScalarPointer());
-	for (auto i = 0; i < blankImage->GetNumberOfPoints(); i++)
+	// evaluates the VOI _voiExt of _ct into the voxel data _e of _grid, the blocks are processed in parallel
+	template<class TPixel>
+	void evaluateVOI(vtkImageData* _ct, const int _voiExt[6], const TileGrid& _grid, float* _e,
+	                 const EMorganLookupTable& _lookupTable)
 	{
-		p[i] = 0;
-	}
-
-	auto stencil = vtkSmartPointer<vtkImageStencil>::New();
-	stencil->ReverseStencilOn();
-	stencil->SetBackgroundValue(1);
+		vtkIdType ctIncrements[3];
+		_ct->GetIncrements(ctIncrements);
+		auto ctStart = static_cast<const TPixel *>(_ct->GetScalarPointer(_voiExt[0], _voiExt[2], _voiExt[4]));
 
-	// pipeline
-	gridToPolyDataFilter->SetInputData(_surMesh);
-	polyDataToStencilFilter->SetInputConnection(gridToPolyDataFilter->GetOutputPort());
-	stencil->SetInputData(blankImage);
-	stencil->SetStencilConnection(polyDataToStencilFilter->GetOutputPort());
-	stencil->Update();
-	return stencil->GetOutput();
+		Parallel::For(_grid.GetNumberOfBlocks(), 1, [&](std::size_t, std::size_t _begin, std::size_t _end)
+			{
+				for (auto b = _begin; b < _end; ++b)
+				{
+					_grid.ForEachRow(b, [&](vtkIdType _id, int _xBegin, int _xEnd, int _y, int _z)
+						{
+							if (_y < _voiExt[2] || _y > _voiExt[3] || _z < _voiExt[4] || _z > _voiExt[5])
+							{
+								return; // padding
+							}
+							auto ct = ctStart + (_z - _voiExt[4]) * ctIncrements[2] + (_y - _voiExt[2]) * ctIncrements[1];
+							auto e = _e + _id - _xBegin;
+							for (auto x = std::max(_xBegin, _voiExt[0]); x < std::min(_xEnd, _voiExt[1] + 1); ++x)
+							{
+								e[x] = static_cast<float>(_lookupTable(ct[(x - _voiExt[0]) * ctIncrements[0]]));
+							}
+						});
+				}
+			});
+	}
 }
 
-MaterialMappingFilter::VtkImage MaterialMappingFilter::createPeeledMask(const VtkImage _img, const VtkImage _mask)
+std::vector<float> MaterialMappingFilter::createEVOI(const VtkImage _img, const double _bounds[6],
+                                                     const EMorganLookupTable& _lookupTable, const TileGrid& _grid,
+                                                     const MemoryMappedImage* _mappedCt) const
 {
-	// configure
-	auto erodeFilter = vtkSmartPointer<vtkImageContinuousErode3D>::New();
-	switch (m_Method)
-	{
-	case Method::Old:
-		{
-			erodeFilter->SetKernelSize(3, 3, 1);
-			break;
-		}
-
-	case Method::New:
-		{
-			erodeFilter->SetKernelSize(3, 3, 3);
-			break;
-		}
-	}
-
-	auto xorLogic = vtkSmartPointer<vtkImageLogic>::New();
-	xorLogic->SetOperationToXor();
-	xorLogic->SetOutputTrueValue(1);
+	// the voxels of the grid outside of the VOI are the 0 padding for the image extends
+	std::vector<float> e(_grid.GetStorageSize(), 0.0f);
 
-	// pipeline
-	erodeFilter->SetInputData(_mask);
-	erodeFilter->Update();
-	xorLogic->SetInput1Data(_mask);
-	xorLogic->SetInput2Data(erodeFilter->GetOutput());
-	xorLogic->Update();
-
-	// extend
-	auto imgCopy = vtkSmartPointer<vtkImageData>::New();
-	imgCopy->DeepCopy(_img);
-	auto erodedMaskCopy = vtkSmartPointer<vtkImageData>::New();
-	erodedMaskCopy->DeepCopy(erodeFilter->GetOutput());
-
-	switch (m_Method)
+	// the CT slices within the grid, a slab may lie in the padding only
+	int voiExt[6];
+	computeVOIExtent(_img, _bounds, voiExt);
+	voiExt[4] = std::max(voiExt[4], _grid.GetExtent()[4]);
+	voiExt[5] = std::min(voiExt[5], _grid.GetExtent()[5]);
+	auto evaluate = voiExt[4] <= voiExt[5];
+	switch (_img->GetScalarType())
 	{
-	case Method::Old:
-		{
-			inplaceExtendImageOld(imgCopy, erodedMaskCopy, true);
-			break;
-		}
-
-	case Method::New:
-		{
-			inplaceExtendImage(imgCopy, erodedMaskCopy, true);
-			break;
-		}
+		vtkTemplateAliasMacro(if (evaluate) evaluateVOI<VTK_TT>(_img, voiExt, _grid, e.data(), _lookupTable));
+	default:
+		MITK_ERROR("ch.zhaw.materialmapping") << "unsupported CT scalar type " << _img->GetScalarTypeAsString();
+		return std::vector<float>();
 	}
 
-	unsigned char* peelPoints = (unsigned char *) xorLogic->GetOutput()->GetScalarPointer();
-	unsigned char* corePoints = (unsigned char *) erodeFilter->GetOutput()->GetScalarPointer();
-	float* im = (float *) _img->GetScalarPointer();
-	float* tim = (float *) imgCopy->GetScalarPointer();
-	for (auto i = 0; i < _img->GetNumberOfPoints(); i++)
+	// the pages of a mapped CT are released once the slab is evaluated
+	if (_mappedCt && evaluate)
 	{
-		if (peelPoints[i] && im[i] > tim[i])
-		{
-			corePoints[i] = 1;
-		}
+		_mappedCt->ReleaseSlices(voiExt[4], voiExt[5] + 1);
 	}
-
-	return erodeFilter->GetOutput();
+	return e;
 }
 
-void MaterialMappingFilter::inplaceExtendImage(VtkImage _img, VtkImage _mask, bool _maxval)
+std::vector<unsigned char> MaterialMappingFilter::erodeMask(const std::vector<unsigned char>& _mask,
+                                                            const TileGrid& _grid) const
 {
-	assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
-
-	static const double kernel[27] = {
-		1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
-		1 / sqrt(2), 1, 1 / sqrt(2),
-		1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
-		1 / sqrt(2), 1, 1 / sqrt(2),
-		1, 0, 1,
-		1 / sqrt(2), 1, 1 / sqrt(2),
-		1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
-		1 / sqrt(2), 1, 1 / sqrt(2),
-		1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3)
-	};
-
-	auto math = vtkSmartPointer<vtkImageMathematics>::New();
-	auto imageconv = vtkSmartPointer<vtkImageConvolve>::New();
-	auto maskconv = vtkSmartPointer<vtkImageConvolve>::New();
-
-	// vtkImageMathematics needs both inputs to have the same scalar type
-	auto mask_float = vtkSmartPointer<vtkImageData>::New();
-	mask_float->CopyStructure(_mask);
-	mask_float->AllocateScalars(VTK_FLOAT, 1);
-	for (auto i = 0; i < mask_float->GetNumberOfPoints(); i++)
-	{
-		mask_float->GetPointData()->GetScalars()->SetTuple1(i, _mask->GetPointData()->GetScalars()->GetTuple1(i));
-	}
-
-	math->SetOperationToMultiply();
-	math->SetInput1Data(_img);
-	math->SetInput2Data(mask_float);
-	imageconv->SetKernel3x3x3(kernel);
-	imageconv->SetInputConnection(math->GetOutputPort());
-	imageconv->Update();
-	maskconv->SetKernel3x3x3(kernel);
-	maskconv->SetInputData(mask_float);
-	maskconv->Update();
-	auto maskPoints = (unsigned char *) (_mask->GetScalarPointer());
-	auto convMaskPoints = (float *) (maskconv->GetOutput()->GetScalarPointer());
-	auto convImgPoints = (float *) (imageconv->GetOutput()->GetScalarPointer());
-	auto imagePoints = (float *) (_img->GetScalarPointer());
-
-	for (auto i = 0; i < _img->GetNumberOfPoints(); i++)
-	{
-		if (convMaskPoints[i] && !maskPoints[i])
+	// neighborhood of vtkImageContinuousErode3D: the ellipsoid inscribed in the 3x3x1 (Old) or 3x3x3 (New) kernel, as
+	// offsets in the neighborhood of a block
+	const auto n = TileGrid::NeighborhoodSize;
+	auto kernelDepth = m_Method == Method::Old ? 1 : 3;
+	std::vector<int> hood;
+	for (auto dz = -(kernelDepth / 2); dz <= kernelDepth / 2; ++dz)
+	{
+		for (auto dy = -1; dy <= 1; ++dy)
 		{
-			auto val = convImgPoints[i] / convMaskPoints[i];
-			if (_maxval)
+			for (auto dx = -1; dx <= 1; ++dx)
 			{
-				if (imagePoints[i] < val)
+				auto rz = kernelDepth * 0.5;
+				if ((dx / 1.5) * (dx / 1.5) + (dy / 1.5) * (dy / 1.5) + (dz / rz) * (dz / rz) <= 1.0)
 				{
-					imagePoints[i] = val;
+					hood.push_back(dx + n * (dy + n * dz));
 				}
 			}
-			else
-			{
-				imagePoints[i] = val;
-			}
-			maskPoints[i] = 1;
 		}
 	}
-}
 
-// uses some C code and unsafe function calls
-#include "lib/extendsurface3d.c"
+	// erosion: the minimum of the neighborhood, neighbors outside of the grid extent are ignored (the maximum value
+	// in the block neighborhood). Voxels outside of the mask stay 0, the neighbors in inactive tiles read 0
+	std::vector<unsigned char> core(_grid.GetStorageSize(), 0);
+	Parallel::For(_grid.GetNumberOfBlocks(), 1, [&](std::size_t, std::size_t _begin, std::size_t _end)
+		{
+			std::vector<unsigned char> neighborhood(n * n * n);
+			for (auto b = _begin; b < _end; ++b)
+			{
+				_grid.GetNeighborhood(b, _mask.data(), std::numeric_limits<unsigned char>::max(), neighborhood.data());
+				for (auto i = b * TileGrid::TileVoxels; i < (b + 1) * TileGrid::TileVoxels; ++i)
+				{
+					auto minimum = _mask[i];
+					if (!minimum)
+					{
+						continue; // also the voxels outside of the extent
+					}
+					auto local = static_cast<int>(i - b * TileGrid::TileVoxels);
+					auto center = neighborhood.data() + (local % TileGrid::TileSize + 1) +
+						n * ((local / TileGrid::TileSize) % TileGrid::TileSize + 1 + n * (local / (TileGrid::TileSize * TileGrid::TileSize) + 1));
+					for (auto d : hood)
+					{
+						minimum = std::min(minimum, center[d]);
+					}
+					core[i] = minimum;
+				}
+			}
+		});
+	return core;
+}
 
-void MaterialMappingFilter::inplaceExtendImageOld(VtkImage _img, VtkImage _mask, bool _maxval)
+MaterialMappingFilter::VtkImage MaterialMappingFilter::erodeMask(const VtkImage _mask) const
 {
-	assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
-
-	int* dim = _img->GetDimensions();
-	char* cx = (char *) malloc(dim[0] * dim[1] * dim[2] * sizeof(char));
-	float* ct_stack_ext_ptr = (float *) malloc(dim[0] * dim[1] * dim[2] * sizeof(float));
-
-	extendsurface(dim[1], dim[0], dim[2],
-	              (float *) (_img->GetScalarPointer()),
-	              (char *) (_mask->GetScalarPointer()), ct_stack_ext_ptr, cx);
-	float* ct_stack_ptr = (float *) (_img->GetScalarPointer());
-	unsigned char* c = (unsigned char *) (_mask->GetScalarPointer());
+	assert(_mask->GetScalarType() == VTK_UNSIGNED_CHAR && "Mask scalar type needs to be unsigned char!");
+
+	// a grid of all tiles of the image
+	TileMask tiles(_mask->GetExtent(), _mask->GetOrigin(), _mask->GetSpacing());
+	tiles.ActivateAll();
+	TileGrid grid(tiles, _mask->GetExtent());
+	std::vector<unsigned char> mask(grid.GetStorageSize());
+	grid.ReadImage(_mask, mask.data());
+	return grid.CreateImage(erodeMask(mask, grid).data());
+}
 
-	for (int i = 0; i < _mask->GetNumberOfPoints(); i++)
-	{
-		if (_maxval)
-		{
-			if (ct_stack_ptr[i] < ct_stack_ext_ptr[i])
-				ct_stack_ptr[i] = ct_stack_ext_ptr[i];
-		}
-		else
-			ct_stack_ptr[i] = ct_stack_ext_ptr[i];
-		c[i] = cx[i];
-	}
-	free(cx);
-	free(ct_stack_ext_ptr);
+ImageExtender MaterialMappingFilter::createImageExtender(std::vector<float>& _img, std::vector<unsigned char>& _mask,
+                                                         const TileGrid& _grid) const
+{
+	auto method = m_Method == Method::Old ? ImageExtender::Method::Old : ImageExtender::Method::New;
+	return ImageExtender(_img.data(), _mask.data(), _grid, method);
 }
 
 MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::interpolateToNodes(const VtkUGrid _mesh,
@@ -430,102 +709,230 @@ MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::interpolateToNodes(
                                                                                 std::string _name,
                                                                                 double _minElem) const
 {
+	assert(_img->GetScalarType() == VTK_FLOAT && "Input image scalar type needs to be float!");
+
+	// a grid of all tiles of the image
+	TileMask tiles(_img->GetExtent(), _img->GetOrigin(), _img->GetSpacing());
+	tiles.ActivateAll();
+	TileGrid grid(tiles, _img->GetExtent());
+	std::vector<float> img(grid.GetStorageSize());
+	grid.ReadImage(_img, img.data());
+
+	auto samples = createNodeSamples(_mesh, _img);
 	auto data = vtkSmartPointer<vtkDoubleArray>::New();
 	data->SetNumberOfComponents(1);
 	data->SetName(_name.c_str());
-
-	auto interpolator = vtkSmartPointer<vtkImageInterpolator>::New();
-	interpolator->Initialize(_img);
-	interpolator->SetInterpolationModeToLinear();
-	interpolator->Update();
-
-	for (auto i = 0; i < _mesh->GetNumberOfPoints(); ++i)
-	{
-		auto p = _mesh->GetPoint(i);
-		auto val = interpolator->Interpolate(p[0], p[1], p[2], 0);
-		data->InsertTuple1(i, val > _minElem ? val : _minElem);
-	}
-
+	data->SetNumberOfTuples(static_cast<vtkIdType>(samples.size()));
+	interpolateToNodes(samples, nullptr, static_cast<vtkIdType>(samples.size()), grid, img.data(), _minElem,
+	                   data->GetPointer(0));
 	return data;
 }
 
-MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::nodesToElements(const VtkUGrid _mesh,
-                                                                             VtkDoubleArray _nodeData,
-                                                                             std::string _name) const
+std::vector<MaterialMappingFilter::NodeSample> MaterialMappingFilter::createNodeSamples(const VtkUGrid _mesh,
+                                                                                       const VtkImage _img) const
 {
-	auto data = vtkSmartPointer<vtkDoubleArray>::New();
-	data->SetNumberOfComponents(1);
-	data->SetName(_name.c_str());
+	return createNodeSamples(_mesh, _img->GetExtent(), _img->GetOrigin(), _img->GetSpacing());
+}
+
+std::vector<MaterialMappingFilter::NodeSample> MaterialMappingFilter::createNodeSamples(const VtkUGrid _mesh,
+                                                                                       const int _extent[6],
+                                                                                       const double _origin[3],
+                                                                                       const double _spacing[3]) const
+{
+	auto numberOfPoints = _mesh->GetNumberOfPoints();
 
-	for (auto i = 0; i < _mesh->GetNumberOfCells(); ++i)
+	// same sampling as vtkImageInterpolator in linear mode with its defaults (clamped border, tolerance, out value 0),
+	// on a float image with the given structure
+	double bounds[6];
+	auto interpolatorDefaults = vtkSmartPointer<vtkImageInterpolator>::New();
+	for (auto k = 0; k < 6; ++k)
 	{
-		auto cellpoints = _mesh->GetCell(i)->GetPoints();
-		auto numberOfNodes = cellpoints->GetNumberOfPoints();
+		bounds[k] = _extent[k] + (k % 2 ? 1 : -1) * interpolatorDefaults->GetTolerance();
+	}
 
-		// get centroid
-		double centroid[3] = {0, 0, 0};
-		for (auto j = 0; j < numberOfNodes; ++j)
+	auto toStructured = [&](vtkIdType _pointId, double _point[3])
 		{
-			auto cellpoint = cellpoints->GetPoint(j);
+			_mesh->GetPoint(_pointId, _point);
 			for (auto k = 0; k < 3; ++k)
 			{
-				centroid[k] = (centroid[k] * j + cellpoint[k]) / (j + 1);
+				_point[k] = (_point[k] - _origin[k]) / _spacing[k];
 			}
-		}
+		};
 
-		// calculate nodal weight = squared distance to centroid
-		double minDistance = std::numeric_limits<double>::max();
-		std::vector<double> squaredDistances(numberOfNodes);
-		for (auto j = 0; j < numberOfNodes; ++j)
+	// the points are visited in blocks of 8x8x8 voxels, so neighboring samples share cache lines
+	const auto blockSize = 8;
+	int blocks[3];
+	for (auto k = 0; k < 3; ++k)
+	{
+		blocks[k] = (_extent[2 * k + 1] - _extent[2 * k]) / blockSize + 1;
+	}
+	std::vector<int> blockIds(numberOfPoints);
+	Parallel::For(numberOfPoints, minimumPointsPerThread, [&](vtkIdType, vtkIdType _begin, vtkIdType _end)
 		{
-			auto cellpoint = cellpoints->GetPoint(j);
-			double squaredDistance = 0;
-			for (auto k = 0; k < 3; ++k)
+			double point[3];
+			for (auto i = _begin; i < _end; ++i)
 			{
-				squaredDistance += pow(cellpoint[k] - centroid[k], 2);
+				toStructured(i, point);
+				int block[3];
+				for (auto k = 0; k < 3; ++k)
+				{
+					auto index = std::min(std::max(point[k] - _extent[2 * k], 0.0), static_cast<double>(_extent[2 * k + 1] - _extent[2 * k]));
+					block[k] = static_cast<int>(index) / blockSize;
+				}
+				blockIds[i] = block[0] + blocks[0] * (block[1] + blocks[1] * block[2]);
 			}
-			squaredDistance = sqrt(squaredDistance);
-			squaredDistances.at(j) = squaredDistance;
+		});
+
+	// counting sort of the point ids by block
+	std::vector<vtkIdType> blockStarts(static_cast<std::size_t>(blocks[0]) * blocks[1] * blocks[2] + 1, 0);
+	for (auto blockId : blockIds)
+	{
+		++blockStarts[blockId + 1];
+	}
+	std::partial_sum(blockStarts.begin(), blockStarts.end(), blockStarts.begin());
+	std::vector<NodeSample> samples(numberOfPoints);
+	for (vtkIdType i = 0; i < numberOfPoints; ++i)
+	{
+		samples[blockStarts[blockIds[i]]++].pointId = i;
+	}
 
-			// if a node aligns with the centroid, we set it's weight to the next closest one
-			if (squaredDistance == 0)
-				squaredDistance = 1;
+	Parallel::For(numberOfPoints, minimumPointsPerThread, [&](vtkIdType, vtkIdType _begin, vtkIdType _end)
+		{
+			double point[3];
+			for (auto n = _begin; n < _end; ++n)
+			{
+				auto& sample = samples[n];
+				toStructured(sample.pointId, point);
 
-			if (squaredDistance < minDistance)
-				minDistance = squaredDistance;
-		}
+				sample.inside = point[0] >= bounds[0] && point[0] <= bounds[1] && point[1] >= bounds[2] &&
+					point[1] <= bounds[3] && point[2] >= bounds[4] && point[2] <= bounds[5];
+				if (!sample.inside)
+				{
+					continue;
+				}
+
+				for (auto k = 0; k < 3; ++k)
+				{
+					auto index0 = vtkInterpolationMath::Floor(point[k], sample.fractions[k]);
+					auto index1 = index0 + (sample.fractions[k] != 0);
+					sample.indices[2 * k] = vtkInterpolationMath::Clamp(index0, _extent[2 * k], _extent[2 * k + 1]);
+					sample.indices[2 * k + 1] = vtkInterpolationMath::Clamp(index1, _extent[2 * k], _extent[2 * k + 1]);
+				}
+			}
+		});
+
+	return samples;
+}
 
-		// invert weight and normalize
-		double value = 0, denom = 0;
-		for (auto j = 0; j < numberOfNodes; ++j)
+void MaterialMappingFilter::interpolateToNodes(const std::vector<NodeSample>& _samples, const vtkIdType* _sampleIds,
+                                               vtkIdType _numberOfSamples, const TileGrid& _grid, const float* _img,
+                                               double _minElem, double* _values) const
+{
+	Parallel::For(_numberOfSamples, minimumPointsPerThread, [&](vtkIdType, vtkIdType _begin, vtkIdType _end)
 		{
-			// normalize the weight so the node closest to the centroid has a weight of 1.0
-			auto normalizedWeight = minDistance / squaredDistances.at(j);
-			denom += normalizedWeight;
-			value += normalizedWeight * _nodeData->GetTuple1(_mesh->GetCell(i)->GetPointId(j));
-		}
-		auto weightedValue = value / denom;
-		data->InsertTuple1(i, weightedValue);
-	}
+			for (auto n = _begin; n < _end; ++n)
+			{
+				const auto& sample = _samples[_sampleIds ? _sampleIds[n] : n];
+				double val = 0;
+				if (sample.inside)
+				{
+					// trilinear weights and summation order of vtkImageInterpolator
+					const auto& f = sample.fractions;
+					const auto& i = sample.indices;
+					auto corner = [&](int _x, int _y, int _z)
+						{
+							return _img[_grid.GetId(i[_x], i[2 + _y], i[4 + _z])];
+						};
+
+					double rx = 1 - f[0];
+					double ry = 1 - f[1];
+					double rz = 1 - f[2];
+					double ryrz = ry * rz;
+					double ryfz = ry * f[2];
+					double fyrz = f[1] * rz;
+					double fyfz = f[1] * f[2];
+
+					val = (rx * (ryrz * corner(0, 0, 0) + ryfz * corner(0, 0, 1) + fyrz * corner(0, 1, 0) +
+					             fyfz * corner(0, 1, 1)) +
+						f[0] * (ryrz * corner(1, 0, 0) + ryfz * corner(1, 0, 1) + fyrz * corner(1, 1, 0) +
+						        fyfz * corner(1, 1, 1)));
+				}
+				_values[sample.pointId] = val > _minElem ? val : _minElem;
+			}
+		});
+}
+
+MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::nodesToElements(const VtkUGrid _mesh,
+                                                                             VtkDoubleArray _nodeData,
+                                                                             std::string _name) const
+{
+	auto weights = ElementWeights::New();
+	weights->Compute(_mesh);
+	return nodesToElements(*weights, _nodeData, _name);
+}
 
+MaterialMappingFilter::VtkDoubleArray MaterialMappingFilter::nodesToElements(const ElementWeights& _weights,
+                                                                             VtkDoubleArray _nodeData,
+                                                                             std::string _name) const
+{
+	auto data = vtkSmartPointer<vtkDoubleArray>::New();
+	data->SetNumberOfComponents(1);
+	data->SetName(_name.c_str());
+	data->SetNumberOfTuples(_weights.GetNumberOfElements());
+	_weights.Apply(_nodeData->GetPointer(0), data->GetPointer(0));
 	return data;
 }
 
-void MaterialMappingFilter::inplaceApplyFunctorsToImage(MaterialMappingFilter::VtkImage _img)
+void MaterialMappingFilter::addMaterialBins(vtkUnstructuredGrid* _out, VtkDoubleArray _elementData) const
+{
+	std::string name = _elementData->GetName();
+	MaterialQuantizer quantizer(m_NumberOfMaterialBins, m_MaterialBinning);
+	auto result = quantizer.Quantize(_elementData->GetPointer(0), _elementData->GetNumberOfTuples());
+
+	auto ids = vtkSmartPointer<vtkIntArray>::New();
+	ids->SetName((name + GEM_DATA_ARRAY_SUFFIX_MATERIAL_ID).c_str());
+	ids->SetNumberOfComponents(1);
+	ids->SetNumberOfTuples(result.ids.size());
+	for (std::size_t i = 0; i < result.ids.size(); ++i)
+	{
+		ids->SetValue(i, result.ids[i] + 1);
+	}
+	_out->GetCellData()->AddArray(ids);
+
+	auto values = vtkSmartPointer<vtkDoubleArray>::New();
+	values->SetName((name + GEM_DATA_ARRAY_SUFFIX_MATERIAL_VALUES).c_str());
+	values->SetNumberOfComponents(1);
+	values->SetNumberOfTuples(result.values.size());
+	std::copy(result.values.begin(), result.values.end(), values->GetPointer(0));
+	_out->GetFieldData()->AddArray(values);
+
+	MITK_INFO("ch.zhaw.materialmapping") << name << ": " << result.ids.size() << " elements in " << result.values.size()
+		<< " materials, max error " << result.maxAbsoluteError << " (" << 100 * result.maxRelativeError
+		<< " %), rms error " << result.rmsError;
+}
+
+void MaterialMappingFilter::addProgressSteps(unsigned int _steps)
 {
-	for (auto i = 0; i < _img->GetNumberOfPoints(); i++)
+	if (m_ReportProgress)
 	{
-		auto valCT = _img->GetPointData()->GetScalars()->GetTuple1(i);
-		auto valDensity = m_BoneDensityFunctor(valCT);
-		auto valEMorgan = m_PowerLawFunctor(std::max(valDensity, 0.0));
-		_img->GetPointData()->GetScalars()->SetTuple1(i, valEMorgan);
+		mitk::ProgressBar::GetInstance()->AddStepsToDo(_steps);
 	}
 }
 
-void MaterialMappingFilter::writeMetaImageToVerboseOut(const std::string _filename, vtkSmartPointer<vtkImageData> _img)
+void MaterialMappingFilter::progress(unsigned int _steps)
 {
-	vtkSmartPointer<vtkMetaImageWriter> writer = vtkSmartPointer<vtkMetaImageWriter>::New();
-	writer->SetFileName((m_VerboseOutputDirectory + "/" + _filename).c_str());
-	writer->SetInputData(_img);
-	writer->Write();
+	if (m_ReportProgress)
+	{
+		mitk::ProgressBar::GetInstance()->Progress(_steps);
+	}
+}
+
+void MaterialMappingFilter::writeMetaImageToVerboseOut(const std::string _filename, vtkSmartPointer<vtkImageData> _img,
+                                                       bool _snapshot)
+{
+	if (!m_VerboseWriter)
+	{
+		m_VerboseWriter.reset(new AsyncImageWriter());
+	}
+	m_VerboseWriter->Write(m_VerboseOutputDirectory + "/" + _filename, _img, _snapshot);
 }
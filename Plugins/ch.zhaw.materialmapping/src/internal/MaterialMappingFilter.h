@@ -1,6 +1,8 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <mitkImage.h>
 #include <mitkUnstructuredGridToUnstructuredGridFilter.h>
@@ -11,8 +13,18 @@
 #include <vtkImageStencil.h>
 
 
+#include "AsyncImageWriter.h"
 #include "BoneDensityFunctor.h"
 #include "PowerLawFunctor.h"
+#include "EMorganLookupTable.h"
+#include "ElementWeights.h"
+#include "ImageExtender.h"
+#include "MappingReport.h"
+#include "MaterialQuantizer.h"
+#include "MemoryMappedImage.h"
+#include "MeshVoxelizer.h"
+#include "TileGrid.h"
+#include "TileMask.h"
 
 /**
  * Given the input:
@@ -22,19 +34,53 @@
  * - Power Law Functor
  * This filter outputs a material mapped mesh.
  *
- *  1. Creates a working copy of the CT image
- *  2. Casts the working copy value type to float
- *  3. Extracts a surface out of the unstructured grid (ugrid)
- *  4. Extracts a volume of interest (VOI) defined by the axis aligned bounding box of the surface + padding
- *  5. Evaluates the given functors for each voxel in the VOI
- *  6. Get a stencil from the surface
- *  7. (configurable) peel step.
+ *  1. Creates a shallow working copy of the CT image
+ *  2. Decomposes the cells of the unstructured grid (ugrid) into tetrahedra
+ *  3. Computes a volume of interest (VOI) defined by the axis aligned bounding box of the mesh + padding
+ *  4. Reads the VOI from the CT memory in its original type ...
+ *  5. ... and evaluates the given functors for each voxel in the VOI, resulting in a float image. By default, the
+ *     VOI only stores the 8x8x8 voxel tiles around the tetrahedra and nodes (see TileMask and TileGrid), steps 4 to 9
+ *     only visit those. The other tiles read as 0 and are never reached by the extends.
+ *  6. Get a stencil by rasterising the tetrahedra
+ *  7. (configurable) peel step: the stencil is eroded by one voxel layer. As in the original implementation, the
+ *     peeled voxels are never put back (their value can not exceed the maximum of itself and its extension), so the
+ *     peeled mask is the eroded stencil and does not depend on the functors.
  *  8. (configurable) image extends.
  *  9. Interpolate functor results to mesh nodes (=points)
- * 10. Calculate element (=cell) values by averaging surrounding node values.
+ * 10. Calculate element (=cell) values by averaging surrounding node values. The node weights are computed once per
+ *     mesh and kept with the input mesh (see ElementWeights).
  * 11. Add point and cell data (both named "E") to the output mesh.
+ *     (configurable) Quantise the cell data into material bins, see SetMaterialBins().
  * 12. Return mesh
  *
+ * The output mesh shares its points, cells and the input arrays with the input mesh (shallow copy), modifying them in
+ * place modifies the input as well.
+ *
+ * Steps 7 to 11 can be run for several branches (see AddBranch()), e.g. with and without peel step. Steps 1 to 6 are
+ * then computed only once and all resulting arrays are added to the same output mesh.
+ *
+ * The intermediates that only depend on the geometry (tetrahedra, stencil, peeled mask and the node
+ * sampling positions) are kept between updates. As long as the mesh, the CT geometry and the method do not change,
+ * an update with different functors only re-evaluates the VOI, the extends and the node/element
+ * values.
+ *
+ * With SetSlabSlices(), steps 4 to 9 run on z-slabs of the padded VOI, one after the other. Each slab is evaluated,
+ * rasterised, peeled, extended and sampled with a halo of NumberOfExtendImageSteps + 2 slices on both sides (the
+ * erosion and each extend step reach one slice further, the trilinear sampling one more), so the nodes of its core read
+ * the same values as in the whole VOI. The element values are averaged as soon as all their nodes are sampled. The
+ * output is identical to processing the whole VOI at once, the peak memory of the images is bounded by the slab size.
+ * Only the node samples are kept between updates then, the stencil and the peeled mask are recomputed per slab.
+ *
+ * With SetIntensityImageFile(), the CT is mapped into memory from an uncompressed MetaImage file instead of being
+ * loaded, so the CT may be larger than the RAM. Unless set otherwise, the VOI is then processed in slabs of about
+ * 64 MiB of float slices, and the CT pages of a slab are released once it is evaluated.
+ *
+ * With SetIntermediateResultOutputDirectory(), the intermediate images are written as compressed MetaImages by a
+ * background thread. Update() returns once all of them are written. The tiled VOI images are written dense, with 0
+ * in the inactive tiles.
+ *
+ * Update() throws a mitk::Exception for meshes with 2^32 or more points (see MeshVoxelizer).
+ *
  * Note that 2 different mapping methods are available:
  * - The "old" or current one. This is the approach discussed in the paper.
  * - A newer one containing some improvements for more accurate results that have yet to be verified.
@@ -66,6 +112,13 @@ public:
 		m_IntensityImage = _p;
 	}
 
+	// Maps the CT from an uncompressed MetaImage file (.mhd/.raw or .mha) instead of using the intensity image. An empty
+	// filename selects the intensity image again.
+	void SetIntensityImageFile(std::string _filename)
+	{
+		m_IntensityImageFile = _filename;
+	}
+
 	void SetDensityFunctor(BoneDensityFunctor&& _f)
 	{
 		m_BoneDensityFunctor = _f;
@@ -76,6 +129,13 @@ public:
 		m_PowerLawFunctor = _f;
 	}
 
+	// Evaluates the VOI with the given table instead of one built from the functors, e.g. to share it between several
+	// filters. The table is only read and may be used by several filters concurrently.
+	void SetLookupTable(std::shared_ptr<const EMorganLookupTable> _t)
+	{
+		m_LookupTable = _t;
+	}
+
 	void SetDoPeelStep(bool _b)
 	{
 		m_DoPeelStep = _b;
@@ -86,6 +146,27 @@ public:
 		m_NumberOfExtendImageSteps = _i;
 	}
 
+	// Processes the padded VOI in z-slabs with a core of _slices slices (0: the whole VOI at once, or slabs of about
+	// 64 MiB with a mapped CT). The output does not depend on it
+	void SetSlabSlices(unsigned int _slices)
+	{
+		m_SlabSlices = _slices;
+	}
+
+	// Stores and processes only the active tiles of the VOI (default). Otherwise all tiles of the padded VOI are
+	// active. The output does not depend on it
+	void SetSkipInactiveTiles(bool _b)
+	{
+		m_SkipInactiveTiles = _b;
+	}
+
+	// Reports the stages to the mitk::ProgressBar (default). Filters updated concurrently, e.g. by
+	// MaterialMappingHelper::ComputeBatch, disable it: the progress bar must only be used from one thread
+	void SetReportProgress(bool _b)
+	{
+		m_ReportProgress = _b;
+	}
+
 	void SetMinElementValue(float _f)
 	{
 		m_MinimumElementValue = _f;
@@ -107,6 +188,41 @@ public:
         m_CellArrayName = _s;
     }
 
+	// Clusters the element values of each branch into at most _numberOfBins materials (0 disables the quantisation).
+	// The material number of each element (1 based) is added as int cell array <cell array name>_MATERIAL_ID, the
+	// value of each material as field data array <cell array name>_MATERIAL_VALUES. The element values are kept.
+	void SetMaterialBins(unsigned int _numberOfBins, MaterialQuantizer::Binning _binning = MaterialQuantizer::Binning::KMeans)
+	{
+		m_NumberOfMaterialBins = _numberOfBins;
+		m_MaterialBinning = _binning;
+	}
+
+	// Adds a mapping branch sharing all stages up to the peel step. Empty array names skip the respective output.
+	// If no branch is added, a single branch configured by SetDoPeelStep(), SetPointArrayName() and SetCellArrayName()
+	// is run.
+	void AddBranch(bool _doPeelStep, std::string _pointArrayName, std::string _cellArrayName)
+	{
+		m_Branches.push_back({_doPeelStep, _pointArrayName, _cellArrayName});
+	}
+
+	void ClearBranches()
+	{
+		m_Branches.clear();
+	}
+
+	// Releases the geometry intermediates kept from the last update
+	void ClearGeometryCache()
+	{
+		m_GeometryCache.reset();
+	}
+
+	// Timing and memory of the stages of the last update. Also logged and, with an intermediate result output
+	// directory, written to report.json
+	const MappingReport& GetReport() const
+	{
+		return m_Report;
+	}
+
 	virtual void GenerateData() override;
 
 protected:
@@ -115,32 +231,92 @@ protected:
 	using VtkUGrid = vtkSmartPointer<vtkUnstructuredGridBase>;
 	using VtkDoubleArray = vtkSmartPointer<vtkDoubleArray>;
 
+	struct Branch
+	{
+		bool doPeelStep;
+		std::string pointArrayName;
+		std::string cellArrayName;
+	};
+
+	// trilinear sampling position of a mesh node in the VOI
+	struct NodeSample
+	{
+		vtkIdType pointId;
+		bool inside;
+		int indices[6]; // x0, x1, y0, y1, z0, z1 of the corner voxels
+		double fractions[3];
+	};
+
+	// intermediates that only depend on the mesh, the CT geometry, the method, the number of extend steps (VOI size) and
+	// the tile setting
+	struct GeometryCache
+	{
+		VtkUGrid mesh;
+		unsigned long meshTime;
+		vtkIdType numberOfPoints, numberOfCells;
+		int extent[6];
+		double origin[3];
+		double spacing[3];
+		Method method;
+		unsigned int numberOfExtendImageSteps;
+		bool skipInactiveTiles;
+		std::unique_ptr<MeshVoxelizer> voxelizer;
+		std::unique_ptr<TileMask> tiles; // active tiles of the padded VOI
+		std::vector<unsigned char> stencil; // on the TileGrid of the padded VOI
+		std::vector<unsigned char> erodedStencil; // peeled mask, created by the first peeling branch
+		std::vector<NodeSample> nodeSamples; // in voxel block order, sampling the padded VOI
+	};
+
 	MaterialMappingFilter();
 
 	virtual ~MaterialMappingFilter()
 	{
 	};
 
-	VtkUGrid extractSurface(const VtkUGrid) const;
-	VtkImage extractVOI(const VtkImage, const VtkUGrid) const;
-	VtkImage createStencil(const VtkUGrid, const VtkImage) const;
-	VtkImage createPeeledMask(const VtkImage _img, const VtkImage _mask);
-	void inplaceExtendImage(VtkImage _img, VtkImage _mask, bool _maxVal); // weighted average in neighborhood, performed in place
-	void inplaceExtendImageOld(VtkImage _img, VtkImage _mask, bool _maxVal);
-	void inplaceApplyFunctorsToImage(VtkImage _img);
+	void computeVOIExtent(const VtkImage, const double _bounds[6], int _voiExt[6]) const;
+	void computePaddedVOIExtent(const VtkImage, const double _bounds[6], int _paddedExt[6]) const; // VOI + 0 slices for the extends
+	TileMask createTileMask(const VtkUGrid, const MeshVoxelizer&, const VtkImage, const double _bounds[6]) const;
+	VtkImage extractVOI(const VtkImage, const double _bounds[6]) const;
+	GeometryCache& updateGeometryCache(const VtkUGrid, const VtkImage); // resets the cache if its inputs changed
+	std::vector<float> createEVOI(const VtkImage _ct, const double _bounds[6], const EMorganLookupTable&, const TileGrid&,
+	                              const MemoryMappedImage* _mappedCt) const; // cropped, evaluated and padded in one pass, on the grid (e.g. a slab of the padded VOI). The pages of a mapped CT are released. Empty for an unsupported CT scalar type
+	std::vector<unsigned char> erodeMask(const std::vector<unsigned char>& _mask, const TileGrid&) const; // the peeled mask
+	VtkImage erodeMask(const VtkImage _mask) const;
+	ImageExtender createImageExtender(std::vector<float>& _img, std::vector<unsigned char>& _mask, const TileGrid&) const; // weighted average in neighborhood, performed in place
+	std::vector<NodeSample> createNodeSamples(const VtkUGrid, const VtkImage) const;
+	std::vector<NodeSample> createNodeSamples(const VtkUGrid, const int _extent[6], const double _origin[3], const double _spacing[3]) const;
+	void interpolateToNodes(const std::vector<NodeSample>&, const vtkIdType* _sampleIds, vtkIdType _numberOfSamples, const TileGrid&,
+	                        const float* _img, double _minElem, double* _values) const; // the samples _sampleIds (all if nullptr), which have to lie within the grid
 	VtkDoubleArray interpolateToNodes(const VtkUGrid, const VtkImage, std::string _name, double _minElem) const; // "interpolateToNodes". evaluates both functors for each vertex of the mesh
-	VtkDoubleArray nodesToElements(const VtkUGrid, VtkDoubleArray _nodeData, std::string _name) const;
+	VtkDoubleArray nodesToElements(const VtkUGrid, VtkDoubleArray _nodeData, std::string _name) const; // computes the weights
+	VtkDoubleArray nodesToElements(const ElementWeights&, VtkDoubleArray _nodeData, std::string _name) const;
+	void addMaterialBins(vtkUnstructuredGrid* _out, VtkDoubleArray _elementData) const; // adds the material id and value arrays of _elementData
 
 	mitk::Image::Pointer m_IntensityImage;
+	std::string m_IntensityImageFile;
 	BoneDensityFunctor m_BoneDensityFunctor;
 	PowerLawFunctor m_PowerLawFunctor;
-	bool m_DoPeelStep = true, m_VerboseOutput;
+	std::shared_ptr<const EMorganLookupTable> m_LookupTable;
+	bool m_DoPeelStep = true, m_VerboseOutput = false;
+	bool m_SkipInactiveTiles = true;
+	bool m_ReportProgress = true;
 	std::string m_VerboseOutputDirectory;
     std::string m_PointArrayName;
     std::string m_CellArrayName;
 	float m_MinimumElementValue = 0.0;
 	unsigned int m_NumberOfExtendImageSteps = 3;
+	unsigned int m_SlabSlices = 0;
+	unsigned int m_NumberOfMaterialBins = 0;
+	MaterialQuantizer::Binning m_MaterialBinning = MaterialQuantizer::Binning::KMeans;
 	Method m_Method;
+	std::vector<Branch> m_Branches;
+	std::unique_ptr<GeometryCache> m_GeometryCache;
+	MappingReport m_Report;
+	std::unique_ptr<AsyncImageWriter> m_VerboseWriter; // exists during an update with intermediate result output
+
+	void addProgressSteps(unsigned int _steps); // mitk::ProgressBar, if progress is reported
+	void progress(unsigned int _steps = 1);
 
-	void writeMetaImageToVerboseOut(const std::string filename, vtkSmartPointer<vtkImageData> image);
+	// queues the image for writing, a snapshot is taken unless _snapshot is false (image not modified any more)
+	void writeMetaImageToVerboseOut(const std::string filename, vtkSmartPointer<vtkImageData> image, bool _snapshot = true);
 };
@@ -1,68 +1,181 @@
 #include "MaterialMappingHelper.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include <vtkCellData.h>
 #include <vtkDoubleArray.h>
 #include <vtkPointData.h>
 
+#include <mitkException.h>
+#include <mitkProgressBar.h>
+
 #include "GemIOResources.h"
 #include "MaterialMappingFilter.h"
 
 
-namespace MaterialMappingHelper
+namespace
 {
-    /*
-     * Runs the material mapping on the given input for all methods
-     * Method A: 0 erosion steps, 3 dilation steps (output element E-values)
-     * Method B: 1 erosion step, 3 dilation steps (output element E-values)
-     * Method C: 1 erosion step, 3 dilation steps (output nodal E-values)
-     * Method D: 1 erosion step, 3 dilation steps (output nodal E-values). Same output as in C
-     * Method E: 0 erosion steps, 3 dilation steps (output element E-values). Same output as in A
-     */
-    mitk::UnstructuredGrid::Pointer Compute(mitk::UnstructuredGrid::Pointer spMesh,
+    // maps spMesh with filter and adds the D and E aliases. If spLookupTable is set, it replaces the functors
+    mitk::UnstructuredGrid::Pointer mapMesh(MaterialMappingFilter::Pointer filter,
+                                            mitk::UnstructuredGrid::Pointer spMesh,
                                             mitk::Image::Pointer spIntensityImage,
                                             MaterialMappingFilter::Method eMethod,
                                             BoneDensityFunctor densityFunctor,
                                             PowerLawFunctor powerLawFunctor,
-                                            float fMinE)
+                                            float fMinE,
+                                            std::shared_ptr<const EMorganLookupTable> spLookupTable)
     {
-        auto filter = MaterialMappingFilter::New();
+        filter->ClearBranches();
 
-        // B & C
+        // B & C with peel step, A without. Both branches share the VOI, functor and stencil stages
         filter->SetInput(spMesh);
         filter->SetIntensityImage(spIntensityImage);
         filter->SetMethod(eMethod);
         filter->SetDensityFunctor(std::move(densityFunctor));
         filter->SetPowerLawFunctor(std::move(powerLawFunctor));
-        filter->SetDoPeelStep(true);
+        filter->SetLookupTable(spLookupTable);
         filter->SetNumberOfExtendImageSteps(3);
         filter->SetMinElementValue(fMinE);
-        filter->SetPointArrayName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C);
-        filter->SetCellArrayName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_B);
-        auto spMeshBC = filter->GetOutput();
-        filter->Update();
-
-        // A
-        filter->SetInput(spMeshBC);
-        filter->SetDoPeelStep(false);
-        filter->SetPointArrayName("");
-        filter->SetCellArrayName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A);
+        filter->AddBranch(true, GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C, GEM_DATA_ARRAY_NAME_MATMAP_METHOD_B);
+        filter->AddBranch(false, "", GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A);
+        filter->Modified();
         auto spMeshResult = filter->GetOutput();
         filter->Update();
+        spMeshResult->DisconnectPipeline(); // the next call creates a new output
 
-        // Copy D
+        // D and E are aliases of C and A. The shallow copies share the value buffer, no values are copied
         auto dataD = vtkSmartPointer<vtkDoubleArray>::New();
-        dataD->SetNumberOfComponents(1);
-        dataD->DeepCopy(spMeshResult->GetVtkUnstructuredGrid()->GetPointData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C));
+        dataD->ShallowCopy(spMeshResult->GetVtkUnstructuredGrid()->GetPointData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_C));
         dataD->SetName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_D);
         spMeshResult->GetVtkUnstructuredGrid()->GetPointData()->AddArray(dataD);
 
-        // Copy E
         auto dataE = vtkSmartPointer<vtkDoubleArray>::New();
-        dataE->SetNumberOfComponents(1);
-        dataE->DeepCopy(spMeshResult->GetVtkUnstructuredGrid()->GetCellData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A));
+        dataE->ShallowCopy(spMeshResult->GetVtkUnstructuredGrid()->GetCellData()->GetArray(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_A));
         dataE->SetName(GEM_DATA_ARRAY_NAME_MATMAP_METHOD_E);
         spMeshResult->GetVtkUnstructuredGrid()->GetCellData()->AddArray(dataE);
 
         return spMeshResult;
     }
-}
\ No newline at end of file
+}
+
+namespace MaterialMappingHelper
+{
+    /*
+     * Runs the material mapping on the given input for all methods
+     * Method A: 0 erosion steps, 3 dilation steps (output element E-values)
+     * Method B: 1 erosion step, 3 dilation steps (output element E-values)
+     * Method C: 1 erosion step, 3 dilation steps (output nodal E-values)
+     * Method D: 1 erosion step, 3 dilation steps (output nodal E-values). Same output as in C
+     * Method E: 0 erosion steps, 3 dilation steps (output element E-values). Same output as in A
+     *
+     * If spFilter is given, it is used for the mapping. It keeps the geometry intermediates of the last call, so calls
+     * that only change the functors skip the geometry stages.
+     *
+     * Throws the mitk::Exception of a failed mapping.
+     */
+    mitk::UnstructuredGrid::Pointer Compute(mitk::UnstructuredGrid::Pointer spMesh,
+                                            mitk::Image::Pointer spIntensityImage,
+                                            MaterialMappingFilter::Method eMethod,
+                                            BoneDensityFunctor densityFunctor,
+                                            PowerLawFunctor powerLawFunctor,
+                                            float fMinE,
+                                            MaterialMappingFilter::Pointer spFilter)
+    {
+        auto filter = spFilter.IsNotNull() ? spFilter : MaterialMappingFilter::New();
+        return mapMesh(filter, spMesh, spIntensityImage, eMethod, std::move(densityFunctor),
+                       std::move(powerLawFunctor), fMinE, nullptr);
+    }
+
+    /*
+     * Runs Compute() for each mesh. The functors are evaluated into a single lookup table shared by all mappings,
+     * each mesh reads only its own VOI from the CT. Up to uiConcurrentMeshes meshes are mapped at the same time by
+     * worker threads. The progress bar and the log are only used from the calling thread, one step per mapped mesh.
+     * A mesh that fails to map is logged and has no result mesh.
+     */
+    std::vector<BatchResult> ComputeBatch(const std::vector<mitk::UnstructuredGrid::Pointer>& vMeshes,
+                                          mitk::Image::Pointer spIntensityImage,
+                                          MaterialMappingFilter::Method eMethod,
+                                          BoneDensityFunctor densityFunctor,
+                                          PowerLawFunctor powerLawFunctor,
+                                          float fMinE,
+                                          unsigned int uiConcurrentMeshes)
+    {
+        std::vector<BatchResult> vResults(vMeshes.size());
+        auto spLookupTable = std::make_shared<const EMorganLookupTable>(densityFunctor, powerLawFunctor);
+
+        // the vtk image of the CT is created on first access, not concurrently by the mappings
+        spIntensityImage->GetVtkImageData();
+
+        mitk::ProgressBar::GetInstance()->AddStepsToDo(static_cast<unsigned int>(vMeshes.size()));
+
+        std::atomic<std::size_t> nextMesh(0);
+        std::mutex mappedMutex;
+        std::condition_variable mappedCondition;
+        std::deque<std::size_t> mappedMeshes; // finished by the workers, not yet reported
+        auto work = [&]()
+        {
+            for (auto i = nextMesh++; i < vMeshes.size(); i = nextMesh++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                auto filter = MaterialMappingFilter::New();
+                filter->SetReportProgress(false);
+                mitk::UnstructuredGrid::Pointer spMeshResult;
+                try
+                {
+                    spMeshResult = mapMesh(filter, vMeshes[i], spIntensityImage, eMethod, densityFunctor,
+                                           powerLawFunctor, fMinE, spLookupTable);
+                }
+                catch (const mitk::Exception& e)
+                {
+                    // the other meshes are still mapped, the failed one has no result mesh
+                    MITK_ERROR("ch.zhaw.materialmapping") << "mesh " << i + 1 << " not mapped: " << e.GetDescription();
+                }
+                std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+                auto& result = vResults[i];
+                result.spMesh = spMeshResult;
+                result.dSeconds = duration.count();
+                result.report = filter->GetReport();
+                result.ulDataKiB = result.report.GetTotalEstimatedDataKiB();
+                {
+                    std::lock_guard<std::mutex> lock(mappedMutex);
+                    mappedMeshes.push_back(i);
+                }
+                mappedCondition.notify_one();
+            }
+        };
+
+        auto numberOfThreads = std::max<std::size_t>(1, std::min<std::size_t>(uiConcurrentMeshes, vMeshes.size()));
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < numberOfThreads; ++t)
+        {
+            threads.emplace_back(work);
+        }
+        for (std::size_t reported = 0; reported < vMeshes.size(); ++reported)
+        {
+            std::size_t i;
+            {
+                std::unique_lock<std::mutex> lock(mappedMutex);
+                mappedCondition.wait(lock, [&]() { return !mappedMeshes.empty(); });
+                i = mappedMeshes.front();
+                mappedMeshes.pop_front();
+            }
+            MITK_INFO("ch.zhaw.materialmapping") << "mesh " << i + 1 << "/" << vMeshes.size() << " mapped in "
+                << vResults[i].dSeconds << " s, " << vResults[i].ulDataKiB << " KiB data (estimated)";
+            mitk::ProgressBar::GetInstance()->Progress();
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        return vResults;
+    }
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include <mitkImage.h>
 #include <mitkUnstructuredGrid.h>
 #include "MaterialMappingFilter.h"
@@ -11,5 +13,22 @@ namespace MaterialMappingHelper
                                             MaterialMappingFilter::Method eMethod,
                                             BoneDensityFunctor densityFunctor,
                                             PowerLawFunctor powerLawFunctor,
-                                            float fMinE);
+                                            float fMinE,
+                                            MaterialMappingFilter::Pointer spFilter = nullptr);
+
+    struct BatchResult
+    {
+        mitk::UnstructuredGrid::Pointer spMesh; // null if the mapping failed
+        double dSeconds; // wall time of the mapping
+        unsigned long ulDataKiB; // estimated memory of the VOI, masks and intermediates created by the mapping
+        MappingReport report; // stages of the mapping
+    };
+
+    std::vector<BatchResult> ComputeBatch(const std::vector<mitk::UnstructuredGrid::Pointer>& vMeshes,
+                                          mitk::Image::Pointer spIntensityImage,
+                                          MaterialMappingFilter::Method eMethod,
+                                          BoneDensityFunctor densityFunctor,
+                                          PowerLawFunctor powerLawFunctor,
+                                          float fMinE,
+                                          unsigned int uiConcurrentMeshes = 2);
 }
\ No newline at end of file
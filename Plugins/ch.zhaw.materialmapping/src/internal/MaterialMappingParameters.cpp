@@ -0,0 +1,158 @@
+#include <limits>
+
+#include <mitkLogMacros.h>
+
+#include <vnl/algo/vnl_lsqr.h>
+#include <vnl/vnl_sparse_matrix_linear_system.h>
+
+#include "MaterialMappingParameters.h"
+
+namespace {
+    // the element itself if it has the name, otherwise its first child with the name
+    const TiXmlElement *findSection(const TiXmlElement *_element, const char *_name) {
+        if (_element == nullptr || std::string(_element->Value()) == _name) {
+            return _element;
+        }
+        return _element->FirstChildElement(_name);
+    }
+}
+
+namespace MaterialMappingParameters {
+    BoneDensityParameters::RhoCt FitRhoCt(const std::vector<std::pair<double, double>> &_dataPoints,
+                                          double _unitFactor) {
+        vnl_vector<double> x(2);
+        x[0] = x[1] = 0.0;
+
+        if (_dataPoints.size() > 1) { // on windows, lsqr.minimize crashes when called with too few data points
+            vnl_sparse_matrix<double> A(_dataPoints.size(), 2);
+            vnl_vector<double> b(_dataPoints.size());
+
+            for (auto i = 0u; i < _dataPoints.size(); ++i) {
+                A(i, 0) = _dataPoints[i].first;
+                A(i, 1) = 1;
+                b[i] = _dataPoints[i].second / _unitFactor;
+            }
+            vnl_sparse_matrix_linear_system<double> ls(A, b);
+
+            vnl_lsqr lsqr(ls);
+            lsqr.minimize(x);
+        }
+
+        return BoneDensityParameters::RhoCt(x[0], x[1]);
+    }
+
+    const TiXmlElement *LoadFile(const std::string &_filename, TiXmlDocument &_doc) {
+        if (!_doc.LoadFile(_filename.c_str())) {
+            MITK_ERROR("ch.zhaw.materialmapping") << "could not read " << _filename << ": " << _doc.ErrorDesc();
+            return nullptr;
+        }
+        return _doc.RootElement();
+    }
+
+    bool ReadCalibration(const TiXmlElement *_element, Calibration &_calibration) {
+        auto section = findSection(_element, "Calibration");
+        if (section == nullptr) {
+            MITK_ERROR("ch.zhaw.materialmapping") << "invalid file format: no calibration.";
+            return false;
+        }
+
+        std::string unit;
+        if (section->QueryStringAttribute("unit", &unit) != TIXML_SUCCESS) {
+            MITK_ERROR("ch.zhaw.materialmapping") << "invalid file format: could not read calibration unit.";
+            return false;
+        }
+        if (unit == "mgHA/cm³") {
+            _calibration.unitFactor = 1000.0;
+        } else if (unit == "gHA/cm³") {
+            _calibration.unitFactor = 1.0;
+        } else {
+            MITK_ERROR("ch.zhaw.materialmapping") << "invalid calibration unit: " << unit;
+            return false;
+        }
+
+        _calibration.dataPoints.clear();
+        for (auto child = section->FirstChildElement("DataPoint"); child; child = child->NextSiblingElement()) {
+            double hu, rho;
+            if (child->QueryDoubleAttribute("HU", &hu) != TIXML_SUCCESS ||
+                child->QueryDoubleAttribute("rho", &rho) != TIXML_SUCCESS) {
+                MITK_ERROR("ch.zhaw.materialmapping") << "invalid file format: invalid calibration data point.";
+                return false;
+            }
+            _calibration.dataPoints.push_back(std::make_pair(hu, rho));
+        }
+        return true;
+    }
+
+    bool ReadDensityFunctor(const TiXmlElement *_element, const Calibration &_calibration,
+                            BoneDensityFunctor &_functor) {
+        _functor = BoneDensityFunctor();
+        _functor.SetRhoCt(FitRhoCt(_calibration.dataPoints, _calibration.unitFactor));
+
+        auto section = findSection(_element, "BoneDensityParameters");
+        if (section == nullptr) {
+            return true;
+        }
+
+        bool b;
+        double offset, divisor;
+        auto rhoCt = section->FirstChildElement("RhoCT");
+        if (rhoCt && rhoCt->QueryBoolAttribute("AutomaticFit", &b) == TIXML_SUCCESS && !b) {
+            double slope;
+            if (rhoCt->QueryDoubleAttribute("slope", &slope) != TIXML_SUCCESS ||
+                rhoCt->QueryDoubleAttribute("offset", &offset) != TIXML_SUCCESS) {
+                MITK_ERROR("ch.zhaw.materialmapping") << "invalid file format: invalid rho_ct.";
+                return false;
+            }
+            _functor.SetRhoCt(BoneDensityParameters::RhoCt(slope, offset));
+        }
+
+        // rho_app is only applied on top of rho_ash
+        auto rhoAsh = section->FirstChildElement("RhoAsh");
+        if (rhoAsh && rhoAsh->QueryBoolAttribute("enabled", &b) == TIXML_SUCCESS && b) {
+            if (rhoAsh->QueryDoubleAttribute("offset", &offset) != TIXML_SUCCESS ||
+                rhoAsh->QueryDoubleAttribute("divisor", &divisor) != TIXML_SUCCESS) {
+                MITK_ERROR("ch.zhaw.materialmapping") << "invalid file format: invalid rho_ash.";
+                return false;
+            }
+            _functor.SetRhoAsh(BoneDensityParameters::RhoAsh(offset, divisor));
+
+            auto rhoApp = section->FirstChildElement("RhoApp");
+            if (rhoApp && rhoApp->QueryBoolAttribute("enabled", &b) == TIXML_SUCCESS && b) {
+                if (rhoApp->QueryDoubleAttribute("divisor", &divisor) != TIXML_SUCCESS) {
+                    MITK_ERROR("ch.zhaw.materialmapping") << "invalid file format: invalid rho_app.";
+                    return false;
+                }
+                _functor.SetRhoApp(BoneDensityParameters::RhoApp(divisor));
+            }
+        }
+        return true;
+    }
+
+    bool ReadPowerLawFunctor(const TiXmlElement *_element, PowerLawFunctor &_functor) {
+        auto section = findSection(_element, "PowerLaws");
+        if (section == nullptr) {
+            MITK_ERROR("ch.zhaw.materialmapping") << "invalid file format: no power laws.";
+            return false;
+        }
+
+        _functor = PowerLawFunctor();
+        for (auto child = section->FirstChildElement("PowerLawParameters"); child; child = child->NextSiblingElement()) {
+            double factor, exponent, offset, rangeMax;
+            if (child->QueryDoubleAttribute("factor", &factor) != TIXML_SUCCESS ||
+                child->QueryDoubleAttribute("exponent", &exponent) != TIXML_SUCCESS ||
+                child->QueryDoubleAttribute("offset", &offset) != TIXML_SUCCESS ||
+                child->QueryDoubleAttribute("rangeMax", &rangeMax) != TIXML_SUCCESS) {
+                MITK_ERROR("ch.zhaw.materialmapping") << "invalid file format: invalid power law.";
+                return false;
+            }
+
+            // the widgets save an open upper bound ("max") as the lowest float, see PowerLawWidgetManager::createFunctor.
+            // The file holds it rounded to 6 digits
+            if (rangeMax <= 0.9999 * std::numeric_limits<float>::lowest()) {
+                rangeMax = std::numeric_limits<float>::max();
+            }
+            _functor.AddPowerLaw(PowerLawParameters(factor, exponent, offset), rangeMax);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <tinyxml.h>
+
+#include "BoneDensityFunctor.h"
+#include "BoneDensityParameters.h"
+#include "PowerLawFunctor.h"
+
+/**
+ * Qt independent reader of the parameters saved by the material mapping view: the parameter file (*.matmap) or single
+ * sections of it, e.g. the calibration table of CalibrationDataModel or the power laws of PowerLawWidgetManager.
+ *
+ * The Read functions accept the section element itself or an element containing it (the root of a parameter file).
+ * Errors are logged and reported by returning false.
+ */
+namespace MaterialMappingParameters {
+    struct Calibration {
+        double unitFactor = 1000.0; // density divisor to gHA/cm³, 1000 for mgHA/cm³
+        std::vector<std::pair<double, double>> dataPoints; // HU, density
+    };
+
+    /**
+     * Least squares fit of rho_ct [gHA/cm³] = slope * HU + offset. Slope and offset are 0 for less than 2 data points.
+     */
+    BoneDensityParameters::RhoCt FitRhoCt(const std::vector<std::pair<double, double>> &_dataPoints, double _unitFactor);
+
+    /**
+     * Returns the root element of the XML file or nullptr if it can not be read.
+     */
+    const TiXmlElement *LoadFile(const std::string &_filename, TiXmlDocument &_doc);
+
+    bool ReadCalibration(const TiXmlElement *_element, Calibration &_calibration);
+
+    /**
+     * Reads the BoneDensityParameters section. If the section is missing or its rho_ct is fitted automatically, rho_ct is
+     * fitted to _calibration, as in the view.
+     */
+    bool ReadDensityFunctor(const TiXmlElement *_element, const Calibration &_calibration, BoneDensityFunctor &_functor);
+
+    bool ReadPowerLawFunctor(const TiXmlElement *_element, PowerLawFunctor &_functor);
+}
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cmath>
+#include <sstream>
 
 #include <berryISelectionService.h>
 #include <berryIWorkbenchWindow.h>
@@ -8,10 +9,10 @@
 #include <QShortcut>
 #include <QtConcurrentRun>
 #include <QWidget>
+#include <mitkException.h>
 #include <mitkImage.h>
 #include <tinyxml.h>
 
-#include <vtkImageCast.h>
 #include <vtkCellArray.h>
 #include <vtkPointData.h>
 
@@ -20,6 +21,7 @@
 #include "WorkbenchUtils.h"
 #include "GuiHelpers.h"
 #include "MaterialMappingFilter.h"
+#include "EMorganLookupTable.h"
 #include "PowerLawWidget.h"
 
 const std::string MaterialMappingView::VIEW_ID = "org.mitk.views.materialmapping";
@@ -92,12 +94,15 @@ void MaterialMappingView::CreateQtPartControl(QWidget *parent) {
 
     // signals
     connect(m_Controls.startButton, SIGNAL(clicked()), this, SLOT(startButtonClicked()));
+    connect(m_Controls.startBatchButton, SIGNAL(clicked()), this, SLOT(startBatchButtonClicked()));
     connect(m_Controls.saveParametersButton, SIGNAL(clicked()), this, SLOT(saveParametersButtonClicked()));
     connect(m_Controls.loadParametersButton, SIGNAL(clicked()), this, SLOT(loadParametersButtonClicked()));
     connect(&m_CalibrationDataModel, SIGNAL(dataChanged()), this, SLOT(tableDataChanged()));
     connect(m_Controls.addPowerLawButton, SIGNAL(clicked()), m_PowerLawWidgetManager.get(), SLOT(addPowerLaw()));
     connect(m_Controls.removePowerLawButton, SIGNAL(clicked()), m_PowerLawWidgetManager.get(), SLOT(removePowerLaw()));
     connect(m_Controls.unitSelectionComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(unitSelectionChanged(int)));
+    connect(m_Controls.unstructuredGridComboBox, SIGNAL(OnSelectionChanged(const mitk::DataNode *)), this, SLOT(inputSelectionChanged()));
+    connect(m_Controls.greyscaleImageComboBox, SIGNAL(OnSelectionChanged(const mitk::DataNode *)), this, SLOT(inputSelectionChanged()));
 
     m_Controls.unitSelectionComboBox->setCurrentIndex(0);
     unitSelectionChanged(0);
@@ -148,12 +153,33 @@ void MaterialMappingView::startButtonClicked() {
 //            auto result = filter->GetOutput();
 //            filter->Update();
 
-            auto result = MaterialMappingHelper::Compute(ugrid,
-                                                         image,
-                                                         gui::getSelectedMappingMethod(m_Controls),
-                                                         gui::createDensityFunctor(m_Controls, m_CalibrationDataModel),
-                                                         m_PowerLawWidgetManager->createFunctor(),
-                                                         m_Controls.fParamSpinBox->value());
+            if (m_ReleaseMappingFilter.exchange(false) || m_MappingFilter.IsNull()) {
+                m_MappingFilter = MaterialMappingFilter::New();
+            }
+            mitk::UnstructuredGrid::Pointer result;
+            try {
+                result = MaterialMappingHelper::Compute(ugrid,
+                                                        image,
+                                                        gui::getSelectedMappingMethod(m_Controls),
+                                                        gui::createDensityFunctor(m_Controls, m_CalibrationDataModel),
+                                                        m_PowerLawWidgetManager->createFunctor(),
+                                                        m_Controls.fParamSpinBox->value(),
+                                                        m_MappingFilter);
+            } catch (const mitk::Exception &e) {
+                MITK_ERROR("ch.zhaw.materialmapping") << "mapping failed: " << e.GetDescription();
+                showReport(std::string("mapping failed: ") + e.GetDescription());
+                m_ReleaseMappingFilter = false;
+                m_MappingFilter = nullptr;
+                m_Controls.scrollArea->setEnabled(true);
+                return;
+            }
+
+            std::ostringstream report;
+            report << m_MappingFilter->GetReport();
+            showReport(report.str());
+            if (m_ReleaseMappingFilter.exchange(false)) {
+                m_MappingFilter = nullptr; // the input changed while mapping
+            }
 
             mitk::DataNode::Pointer newNode = mitk::DataNode::New();
             newNode->SetData(result);
@@ -172,6 +198,88 @@ void MaterialMappingView::startButtonClicked() {
     }
 }
 
+void MaterialMappingView::inputSelectionChanged() {
+    // the geometry cache of the filter pins the previous mesh and its intermediates. The worker uses the filter, so
+    // while it is mapping, it releases the filter itself
+    if (m_WorkerFuture.isRunning()) {
+        m_ReleaseMappingFilter = true;
+    } else {
+        m_MappingFilter = nullptr;
+    }
+}
+
+void MaterialMappingView::NodeRemoved(const mitk::DataNode *_node) {
+    if (dynamic_cast<mitk::Image *>(_node->GetData()) || dynamic_cast<mitk::UnstructuredGrid *>(_node->GetData())) {
+        inputSelectionChanged();
+    }
+}
+
+void MaterialMappingView::startBatchButtonClicked() {
+    MITK_INFO("ch.zhaw.materialmapping") << "processing batch input";
+    mitk::DataNode *imageNode = m_Controls.greyscaleImageComboBox->GetSelectedNode();
+    gui::setMandatoryQSSField(m_Controls.greyscaleSelector, (imageNode == nullptr));
+    if (imageNode == nullptr) {
+        return;
+    }
+    mitk::Image::Pointer image = dynamic_cast<mitk::Image *>(imageNode->GetData());
+
+    // all unstructured grids selected in the data manager
+    std::vector<mitk::DataNode::Pointer> ugridNodes;
+    std::vector<mitk::UnstructuredGrid::Pointer> ugrids;
+    for (auto node : this->GetDataManagerSelection()) {
+        auto ugrid = dynamic_cast<mitk::UnstructuredGrid *>(node->GetData());
+        if (ugrid != nullptr) {
+            ugridNodes.push_back(node);
+            ugrids.push_back(ugrid);
+        }
+    }
+    if (image.IsNull() || ugrids.empty()) {
+        QMessageBox::warning(0, "", "Select an image and at least one unstructured grid in the Data Manager.");
+        return;
+    }
+
+    auto work = [this, image, ugridNodes, ugrids]() {
+        m_Controls.scrollArea->setEnabled(false);
+
+        auto results = MaterialMappingHelper::ComputeBatch(ugrids,
+                                                           image,
+                                                           gui::getSelectedMappingMethod(m_Controls),
+                                                           gui::createDensityFunctor(m_Controls, m_CalibrationDataModel),
+                                                           m_PowerLawWidgetManager->createFunctor(),
+                                                           m_Controls.fParamSpinBox->value());
+
+        std::ostringstream report;
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (results[i].spMesh.IsNull()) {
+                report << ugridNodes[i]->GetName() << ": mapping failed, see the log\n\n";
+                continue;
+            }
+            auto name = ugridNodes[i]->GetName() + " (material mapped)";
+            MITK_INFO("ch.zhaw.materialmapping") << name << ": " << results[i].dSeconds << " s, "
+                                                 << results[i].ulDataKiB << " KiB data (estimated)";
+            report << name << ": " << results[i].dSeconds << " s, " << results[i].ulDataKiB << " KiB data (estimated)\n"
+                   << results[i].report << "\n\n";
+
+            mitk::DataNode::Pointer newNode = mitk::DataNode::New();
+            newNode->SetData(results[i].spMesh);
+            newNode->SetProperty("name", mitk::StringProperty::New(name));
+            newNode->SetProperty("layer", mitk::IntProperty::New(1));
+            this->GetDataStorage()->Add(newNode);
+        }
+        showReport(report.str());
+
+        m_Controls.scrollArea->setEnabled(true);
+    };
+
+    m_WorkerFuture = QtConcurrent::run(static_cast<std::function<void()>>(work));
+}
+
+void MaterialMappingView::showReport(const std::string &_report) {
+    // called from the worker thread, the text is set in the GUI thread
+    QMetaObject::invokeMethod(m_Controls.reportTextEdit, "setPlainText", Qt::QueuedConnection,
+                              Q_ARG(QString, QString::fromStdString(_report)));
+}
+
 void MaterialMappingView::tableDataChanged() {
     // in case new data was loaded from a file, we need to update the combo box
     int index = static_cast<int>(m_CalibrationDataModel.getUnit());
@@ -238,18 +346,10 @@ void MaterialMappingView::createEMorganImage() {
     auto vtkImage = vtkSmartPointer<vtkImageData>::New();
     vtkImage->ShallowCopy(const_cast<vtkImageData *>(image->GetVtkImageData()));
     vtkImage->SetOrigin(mitkOrigin[0], mitkOrigin[1], mitkOrigin[2]);
-    auto imageCast = vtkSmartPointer<vtkImageCast>::New();
-    imageCast->SetInputData(vtkImage);
-    imageCast->SetOutputScalarTypeToFloat();
-    imageCast->Update();
-    vtkImage = imageCast->GetOutput();
-
-    for (auto i = 0; i < vtkImage->GetNumberOfPoints(); i++) {
-        auto ct_val = vtkImage->GetPointData()->GetScalars()->GetTuple1(i);
-        auto rho = densityFunctor(ct_val);
-        auto val = powerLawFunctor(rho);
-        vtkImage->GetPointData()->GetScalars()->SetTuple1(i, val);
-    }
+
+    // evaluates the CT scalars in their own type, no clamping of negative densities
+    EMorganLookupTable lookupTable(densityFunctor, powerLawFunctor, -32768, 65535, false);
+    vtkImage = lookupTable.CreateEImage(vtkImage);
 
     // save results
     mitk::Image::Pointer result = mitk::Image::New();
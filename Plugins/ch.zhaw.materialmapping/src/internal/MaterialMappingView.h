@@ -5,11 +5,14 @@
 #include <QmitkAbstractView.h>
 #include <QFuture>
 
+#include <atomic>
+
 #include "ui_MaterialMappingViewControls.h"
 #include "CalibrationDataModel.h"
 #include "test/Runner.h"
 #include "BoneDensityFunctor.h"
 #include "PowerLawWidgetManager.h"
+#include "MaterialMappingFilter.h"
 
 class MaterialMappingView : public QmitkAbstractView {
     Q_OBJECT
@@ -25,18 +28,22 @@ public:
 protected slots:
     void deleteSelectedRows();
     void startButtonClicked();
+    void startBatchButtonClicked();
     void tableDataChanged();
     void unitSelectionChanged(int);
     void compareGrids();
     void createEMorganImage();
     void loadParametersButtonClicked();
     void saveParametersButtonClicked();
+    void inputSelectionChanged();
     bool eventFilter(QObject *, QEvent *) override;
 
 protected:
     virtual void CreateQtPartControl(QWidget *parent) override;
     virtual void SetFocus() override {}; // required by blueberry
+    virtual void NodeRemoved(const mitk::DataNode *_node) override;
     bool isValidSelection();
+    void showReport(const std::string &); // thread safe
 
     Ui::MaterialMappingViewControls m_Controls;
     CalibrationDataModel m_CalibrationDataModel;
@@ -45,4 +52,6 @@ protected:
     std::unique_ptr<PowerLawWidgetManager> m_PowerLawWidgetManager;
 
     QFuture<void> m_WorkerFuture;
+    MaterialMappingFilter::Pointer m_MappingFilter; // reused, keeps the geometry of the last mapping
+    std::atomic<bool> m_ReleaseMappingFilter{false}; // set while mapping, the worker releases the filter when done
 };
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "MaterialQuantizer.h"
+
+namespace {
+    // assigns the values in ascending _order to the nearest of the ascending _centers
+    template<class TCallback>
+    void sweepNearest(const double *_values, const std::vector<std::size_t> &_order,
+                      const std::vector<double> &_centers, TCallback _callback) {
+        std::size_t c = 0;
+        for (auto i : _order) {
+            while (c + 1 < _centers.size() && _values[i] > 0.5 * (_centers[c] + _centers[c + 1])) {
+                ++c;
+            }
+            _callback(i, c);
+        }
+    }
+}
+
+MaterialQuantizer::MaterialQuantizer(unsigned int _numberOfBins, Binning _binning)
+        : m_NumberOfBins(std::max(1u, _numberOfBins)),
+          m_Binning(_binning) {
+}
+
+MaterialQuantizer::Result MaterialQuantizer::Quantize(const double *_values, std::size_t _n) const {
+    Result result;
+    if (_n == 0) {
+        return result;
+    }
+
+    auto ids = m_Binning == Binning::KMeans ? assignKMeans(_values, _n)
+                                             : assignUniform(_values, _n, m_Binning == Binning::LogUniform);
+
+    // material values are the means of the bins, empty bins are dropped
+    std::vector<double> sums(m_NumberOfBins, 0.0);
+    std::vector<std::size_t> counts(m_NumberOfBins, 0);
+    for (std::size_t i = 0; i < _n; ++i) {
+        sums[ids[i]] += _values[i];
+        ++counts[ids[i]];
+    }
+    std::vector<int> materials(m_NumberOfBins, -1);
+    for (auto b = 0u; b < m_NumberOfBins; ++b) {
+        if (counts[b] > 0) {
+            materials[b] = static_cast<int>(result.values.size());
+            result.values.push_back(sums[b] / counts[b]);
+            result.counts.push_back(counts[b]);
+        }
+    }
+
+    result.ids.resize(_n);
+    auto squaredError = 0.0;
+    for (std::size_t i = 0; i < _n; ++i) {
+        result.ids[i] = materials[ids[i]];
+        auto error = std::abs(result.values[result.ids[i]] - _values[i]);
+        result.maxAbsoluteError = std::max(result.maxAbsoluteError, error);
+        squaredError += error * error;
+        if (_values[i] != 0.0) {
+            result.maxRelativeError = std::max(result.maxRelativeError, error / std::abs(_values[i]));
+        }
+    }
+    result.rmsError = std::sqrt(squaredError / _n);
+    return result;
+}
+
+std::vector<int> MaterialQuantizer::assignUniform(const double *_values, std::size_t _n, bool _log) const {
+    auto transform = [_log](double _v) {
+        return _log ? std::log(_v) : _v;
+    };
+    auto isBinned = [_log](double _v) {
+        return !_log || _v > 0.0;
+    };
+
+    auto min = std::numeric_limits<double>::max(), max = std::numeric_limits<double>::lowest();
+    for (std::size_t i = 0; i < _n; ++i) {
+        if (isBinned(_values[i])) {
+            min = std::min(min, transform(_values[i]));
+            max = std::max(max, transform(_values[i]));
+        }
+    }
+
+    std::vector<int> ids(_n, 0);
+    auto width = (max - min) / m_NumberOfBins;
+    if (!(width > 0.0)) {
+        return ids; // a single distinct (positive) value
+    }
+    for (std::size_t i = 0; i < _n; ++i) {
+        if (isBinned(_values[i])) {
+            auto bin = static_cast<long long>((transform(_values[i]) - min) / width);
+            ids[i] = static_cast<int>(std::min<long long>(std::max(bin, 0ll), m_NumberOfBins - 1));
+        }
+    }
+    return ids;
+}
+
+std::vector<int> MaterialQuantizer::assignKMeans(const double *_values, std::size_t _n) const {
+    const auto maxIterations = 100;
+
+    std::vector<std::size_t> order(_n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [_values](std::size_t _a, std::size_t _b) {
+        return _values[_a] < _values[_b];
+    });
+
+    // start at the quantiles, duplicates are merged
+    auto k = std::min<std::size_t>(m_NumberOfBins, _n);
+    std::vector<double> centers;
+    for (std::size_t j = 0; j < k; ++j) {
+        centers.push_back(_values[order[(2 * j + 1) * _n / (2 * k)]]);
+    }
+    centers.erase(std::unique(centers.begin(), centers.end()), centers.end());
+
+    for (auto iteration = 0; iteration < maxIterations; ++iteration) {
+        std::vector<double> sums(centers.size(), 0.0);
+        std::vector<std::size_t> counts(centers.size(), 0);
+        sweepNearest(_values, order, centers, [&](std::size_t _i, std::size_t _c) {
+            sums[_c] += _values[_i];
+            ++counts[_c];
+        });
+
+        std::vector<double> updated;
+        for (std::size_t c = 0; c < centers.size(); ++c) {
+            if (counts[c] > 0) {
+                updated.push_back(sums[c] / counts[c]);
+            }
+        }
+        if (updated == centers) {
+            break;
+        }
+        centers.swap(updated);
+    }
+
+    std::vector<int> ids(_n);
+    sweepNearest(_values, order, centers, [&](std::size_t _i, std::size_t _c) {
+        ids[_i] = static_cast<int>(_c);
+    });
+    return ids;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Clusters element values (e.g. E) into a small number of materials.
+ *
+ * FE solvers need one material definition per distinct value, so a continuous value per element results in as many
+ * materials as elements. The quantizer assigns each value to one of at most _numberOfBins materials and reports the
+ * error of replacing the values by the value of their material. The material value is the mean of its members.
+ *
+ * Binning:
+ * - Uniform: bins of equal width between the minimum and maximum value.
+ * - LogUniform: bins of equal width in log space, values <= 0 are assigned to the first bin.
+ * - KMeans: 1D k-means (Lloyd) started from the quantiles of the values, minimises the squared error.
+ *
+ * Empty bins are dropped, so the result may contain fewer materials than bins.
+ */
+class MaterialQuantizer {
+public:
+    enum class Binning {
+        Uniform, LogUniform, KMeans
+    };
+
+    struct Result {
+        std::vector<int> ids;           // material per value, 0 based
+        std::vector<double> values;     // value of each material, ascending
+        std::vector<std::size_t> counts; // number of values per material
+        double maxAbsoluteError = 0.0;
+        double rmsError = 0.0;
+        double maxRelativeError = 0.0;  // relative to the original value, values of 0 are skipped
+    };
+
+    MaterialQuantizer(unsigned int _numberOfBins, Binning _binning);
+
+    Result Quantize(const double *_values, std::size_t _n) const;
+
+    unsigned int GetNumberOfBins() const {
+        return m_NumberOfBins;
+    }
+
+    Binning GetBinning() const {
+        return m_Binning;
+    }
+
+private:
+    // assigns the values to bins, bins may be empty
+    std::vector<int> assignUniform(const double *_values, std::size_t _n, bool _log) const;
+
+    std::vector<int> assignKMeans(const double *_values, std::size_t _n) const;
+
+    unsigned int m_NumberOfBins;
+    Binning m_Binning;
+};
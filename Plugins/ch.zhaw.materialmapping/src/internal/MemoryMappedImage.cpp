@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkType.h>
+
+#include <mitkLogMacros.h>
+
+#include "MemoryMappedImage.h"
+
+namespace {
+    bool isLittleEndianHost() {
+        const std::uint16_t one = 1;
+        return *reinterpret_cast<const unsigned char *>(&one) == 1;
+    }
+
+    int toVtkScalarType(const std::string &_metType) {
+        static const std::map<std::string, int> types = {
+                {"MET_CHAR",   VTK_SIGNED_CHAR},
+                {"MET_UCHAR",  VTK_UNSIGNED_CHAR},
+                {"MET_SHORT",  VTK_SHORT},
+                {"MET_USHORT", VTK_UNSIGNED_SHORT},
+                {"MET_INT",    VTK_INT},
+                {"MET_UINT",   VTK_UNSIGNED_INT},
+                {"MET_FLOAT",  VTK_FLOAT},
+                {"MET_DOUBLE", VTK_DOUBLE}};
+        auto it = types.find(_metType);
+        return it == types.end() ? VTK_VOID : it->second;
+    }
+
+    std::string trim(const std::string &_s) {
+        auto begin = _s.find_first_not_of(" \t\r\n");
+        auto end = _s.find_last_not_of(" \t\r\n");
+        return begin == std::string::npos ? std::string() : _s.substr(begin, end - begin + 1);
+    }
+
+    bool isTrue(const std::string &_value) {
+        return _value == "True" || _value == "true" || _value == "TRUE" || _value == "1";
+    }
+
+    template<class T>
+    bool readValues(const std::map<std::string, std::string> &_header, const std::string &_key, T *_values) {
+        auto it = _header.find(_key);
+        if (it == _header.end()) {
+            return false;
+        }
+        std::istringstream stream(it->second);
+        for (auto i = 0; i < 3; ++i) {
+            if (!(stream >> _values[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string directory(const std::string &_filename) {
+        auto slash = _filename.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : _filename.substr(0, slash + 1);
+    }
+}
+
+std::unique_ptr<MemoryMappedImage> MemoryMappedImage::OpenMetaImage(const std::string &_filename) {
+    std::ifstream file(_filename, std::ios::binary);
+    if (!file) {
+        MITK_ERROR("ch.zhaw.materialmapping") << "could not open " << _filename;
+        return nullptr;
+    }
+
+    // the header ends with the ElementDataFile line, LOCAL data follows directly
+    std::map<std::string, std::string> header;
+    std::string line;
+    while (std::getline(file, line)) {
+        auto equals = line.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+        auto key = trim(line.substr(0, equals));
+        header[key] = trim(line.substr(equals + 1));
+        if (key == "ElementDataFile") {
+            break;
+        }
+    }
+    auto localDataOffset = static_cast<std::size_t>(file.tellg());
+
+    auto fail = [&_filename](const std::string &_reason) {
+        MITK_ERROR("ch.zhaw.materialmapping") << "could not map " << _filename << ": " << _reason;
+        return nullptr;
+    };
+    auto value = [&header](const std::string &_key) {
+        auto it = header.find(_key);
+        return it == header.end() ? std::string() : it->second;
+    };
+
+    if (value("NDims") != "3") {
+        return fail("only 3D images are supported");
+    }
+    if (isTrue(value("CompressedData"))) {
+        return fail("compressed data can't be mapped");
+    }
+    if (isTrue(value("BinaryDataByteOrderMSB")) || isTrue(value("ElementByteOrderMSB")) || !isLittleEndianHost()) {
+        return fail("only little endian data on little endian hosts is supported");
+    }
+    if (!value("ElementNumberOfChannels").empty() && value("ElementNumberOfChannels") != "1") {
+        return fail("only single channel images are supported");
+    }
+
+    int dimensions[3];
+    double spacing[3] = {1, 1, 1}, origin[3] = {0, 0, 0};
+    if (!readValues(header, "DimSize", dimensions)) {
+        return fail("DimSize missing");
+    }
+    if (!readValues(header, "ElementSpacing", spacing)) {
+        readValues(header, "ElementSize", spacing);
+    }
+    if (!readValues(header, "Offset", origin) && !readValues(header, "Origin", origin)) {
+        readValues(header, "Position", origin);
+    }
+    double matrix[9];
+    std::istringstream matrixStream(value("TransformMatrix"));
+    for (auto i = 0; i < 9 && matrixStream >> matrix[i]; ++i) {
+        if (matrix[i] != (i % 4 == 0 ? 1.0 : 0.0)) {
+            MITK_WARN("ch.zhaw.materialmapping") << _filename << ": the orientation is ignored";
+            break;
+        }
+    }
+
+    auto scalarType = toVtkScalarType(value("ElementType"));
+    if (scalarType == VTK_VOID) {
+        return fail("unsupported element type " + value("ElementType"));
+    }
+
+    auto dataFile = value("ElementDataFile");
+    std::string dataFilename;
+    long long headerSize = 0;
+    if (dataFile == "LOCAL") {
+        dataFilename = _filename;
+        headerSize = static_cast<long long>(localDataOffset);
+    } else if (dataFile.empty() || dataFile == "LIST" || dataFile.find('%') != std::string::npos ||
+               dataFile.find(' ') != std::string::npos) {
+        return fail("only a single data file is supported");
+    } else {
+        dataFilename = dataFile.front() == '/' || dataFile.find(':') != std::string::npos ? dataFile
+                                                                                           : directory(_filename) + dataFile;
+        if (!value("HeaderSize").empty()) {
+            headerSize = std::stoll(value("HeaderSize"));
+        }
+    }
+
+    if (headerSize >= 0) {
+        return OpenRaw(dataFilename, dimensions, spacing, origin, scalarType, static_cast<std::size_t>(headerSize));
+    }
+
+    // HeaderSize = -1: the data is at the end of the file
+    std::ifstream data(dataFilename, std::ios::binary | std::ios::ate);
+    auto dataSize = static_cast<long long>(dimensions[0]) * dimensions[1] * dimensions[2] *
+                    vtkDataArray::GetDataTypeSize(scalarType);
+    auto fileSize = static_cast<long long>(data.tellg());
+    if (!data || fileSize < dataSize) {
+        return fail("data file " + dataFilename + " is too small");
+    }
+    return OpenRaw(dataFilename, dimensions, spacing, origin, scalarType, static_cast<std::size_t>(fileSize - dataSize));
+}
+
+std::unique_ptr<MemoryMappedImage> MemoryMappedImage::OpenRaw(const std::string &_filename, const int _dimensions[3],
+                                                              const double _spacing[3], const double _origin[3],
+                                                              int _vtkScalarType, std::size_t _headerSize) {
+    std::unique_ptr<MemoryMappedImage> image(new MemoryMappedImage());
+    if (!image->map(_filename)) {
+        return nullptr;
+    }
+
+    auto numberOfVoxels = static_cast<std::size_t>(_dimensions[0]) * _dimensions[1] * _dimensions[2];
+    auto scalarSize = static_cast<std::size_t>(vtkDataArray::GetDataTypeSize(_vtkScalarType));
+    if (scalarSize == 0 || _headerSize + numberOfVoxels * scalarSize > image->m_MappingSize) {
+        MITK_ERROR("ch.zhaw.materialmapping") << "could not map " << _filename << ": the file is too small";
+        return nullptr;
+    }
+    // the mapping is page aligned, so the scalars are only aligned if the data offset is. Misaligned scalars are
+    // undefined behaviour and slow on some platforms, e.g. a .mha header of odd length followed by short data
+    if (_headerSize % scalarSize != 0) {
+        MITK_ERROR("ch.zhaw.materialmapping") << "could not map " << _filename << ": the data offset " << _headerSize
+                                              << " is not a multiple of the scalar size " << scalarSize
+                                              << ", store the data in a separate file (.mhd/.raw)";
+        return nullptr;
+    }
+    image->m_DataOffset = _headerSize;
+    image->m_SliceSize = static_cast<std::size_t>(_dimensions[0]) * _dimensions[1] * scalarSize;
+
+    // the scalars use the mapping, they are never freed by vtk (save = 1)
+    vtkSmartPointer<vtkDataArray> scalars;
+    scalars.TakeReference(vtkDataArray::CreateDataArray(_vtkScalarType));
+    scalars->SetNumberOfComponents(1);
+    scalars->SetVoidArray(image->m_Mapping + _headerSize, static_cast<vtkIdType>(numberOfVoxels), 1);
+
+    image->m_Image = vtkSmartPointer<vtkImageData>::New();
+    image->m_Image->SetDimensions(_dimensions[0], _dimensions[1], _dimensions[2]);
+    image->m_Image->SetSpacing(_spacing[0], _spacing[1], _spacing[2]);
+    image->m_Image->SetOrigin(_origin[0], _origin[1], _origin[2]);
+    image->m_Image->GetPointData()->SetScalars(scalars);
+
+    MITK_INFO("ch.zhaw.materialmapping") << "mapped " << _filename << ": " << _dimensions[0] << "x" << _dimensions[1]
+                                         << "x" << _dimensions[2] << " " << image->m_Image->GetScalarTypeAsString();
+    return image;
+}
+
+MemoryMappedImage::~MemoryMappedImage() {
+    m_Image = nullptr;
+#ifdef _WIN32
+    if (m_Mapping) {
+        UnmapViewOfFile(m_Mapping);
+    }
+    if (m_FileMapping) {
+        CloseHandle(m_FileMapping);
+    }
+    if (m_File && m_File != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_File);
+    }
+#else
+    if (m_Mapping) {
+        munmap(m_Mapping, m_MappingSize);
+    }
+    if (m_File >= 0) {
+        close(m_File);
+    }
+#endif
+}
+
+bool MemoryMappedImage::map(const std::string &_filename) {
+    m_Filename = _filename;
+    auto fail = [&_filename]() {
+        MITK_ERROR("ch.zhaw.materialmapping") << "could not map " << _filename;
+        return false;
+    };
+
+#ifdef _WIN32
+    m_File = CreateFileA(_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (m_File == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_File, &size) || size.QuadPart == 0) {
+        return fail();
+    }
+    m_MappingSize = static_cast<std::size_t>(size.QuadPart);
+    m_FileMapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_FileMapping) {
+        return fail();
+    }
+    m_Mapping = static_cast<char *>(MapViewOfFile(m_FileMapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    m_File = open(_filename.c_str(), O_RDONLY);
+    struct stat status;
+    if (m_File < 0 || fstat(m_File, &status) != 0 || status.st_size == 0) {
+        return fail();
+    }
+    m_MappingSize = static_cast<std::size_t>(status.st_size);
+    auto mapping = mmap(nullptr, m_MappingSize, PROT_READ, MAP_SHARED, m_File, 0);
+    m_Mapping = mapping == MAP_FAILED ? nullptr : static_cast<char *>(mapping);
+#endif
+    return m_Mapping != nullptr || fail();
+}
+
+void MemoryMappedImage::ReleaseSlices(int _zBegin, int _zEnd) const {
+    auto extent = m_Image->GetExtent();
+    _zBegin = std::max(_zBegin, extent[4]);
+    _zEnd = std::min(_zEnd, extent[5] + 1);
+    if (_zBegin >= _zEnd) {
+        return;
+    }
+
+    // whole pages only, pages shared with the neighbouring slices are kept
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    std::size_t pageSize = info.dwPageSize;
+#else
+    auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    auto begin = m_DataOffset + (_zBegin - extent[4]) * m_SliceSize;
+    auto end = m_DataOffset + (_zEnd - extent[4]) * m_SliceSize;
+    begin = (begin + pageSize - 1) / pageSize * pageSize;
+    end = end / pageSize * pageSize;
+    if (begin >= end) {
+        return;
+    }
+
+#ifdef _WIN32
+    // unlocking pages that are not locked removes them from the working set
+    VirtualUnlock(m_Mapping + begin, end - begin);
+#else
+    madvise(m_Mapping + begin, end - begin, MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+/**
+ * Read only CT volume mapped into memory from an uncompressed raw or MetaImage file.
+ *
+ * The image returned by GetImage() uses the mapped file as its scalars: nothing is read until a voxel is accessed, and
+ * the operating system only keeps the accessed pages resident. ReleaseSlices() drops the pages of slices that are not
+ * needed any more from the resident memory, so a volume larger than the RAM can be processed slice by slice.
+ *
+ * The scalars must not be modified. Only single component images in the byte order of the host are supported, whose
+ * data offset in the file is a multiple of the scalar size.
+ */
+class MemoryMappedImage {
+public:
+    /**
+     * Maps a MetaImage (.mhd with a separate data file or .mha with local data). Returns nullptr and logs the reason if
+     * the file can't be mapped, e.g. for compressed data.
+     */
+    static std::unique_ptr<MemoryMappedImage> OpenMetaImage(const std::string &_filename);
+
+    /**
+     * Maps a raw file of _dimensions voxels of _vtkScalarType, starting at _headerSize bytes.
+     */
+    static std::unique_ptr<MemoryMappedImage> OpenRaw(const std::string &_filename, const int _dimensions[3],
+                                                      const double _spacing[3], const double _origin[3],
+                                                      int _vtkScalarType, std::size_t _headerSize = 0);
+
+    ~MemoryMappedImage();
+
+    MemoryMappedImage(const MemoryMappedImage &) = delete;
+
+    MemoryMappedImage &operator=(const MemoryMappedImage &) = delete;
+
+    vtkImageData *GetImage() const {
+        return m_Image;
+    }
+
+    const std::string &GetFilename() const {
+        return m_Filename;
+    }
+
+    /**
+     * Drops the mapped pages of the slices [_zBegin, _zEnd) (extent indices) from the resident memory. They are read
+     * again from the file on the next access.
+     */
+    void ReleaseSlices(int _zBegin, int _zEnd) const;
+
+private:
+    MemoryMappedImage() = default;
+
+    bool map(const std::string &_filename);
+
+    std::string m_Filename;
+    char *m_Mapping = nullptr;
+    std::size_t m_MappingSize = 0;
+    std::size_t m_DataOffset = 0;
+    std::size_t m_SliceSize = 0; // bytes
+#ifdef _WIN32
+    void *m_File = nullptr;
+    void *m_FileMapping = nullptr;
+#else
+    int m_File = -1;
+#endif
+    vtkSmartPointer<vtkImageData> m_Image;
+};
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <mitkLogMacros.h>
+
+#include <vtkCellType.h>
+#include <vtkGenericCell.h>
+#include <vtkIdList.h>
+#include <vtkPoints.h>
+
+#include "MeshVoxelizer.h"
+#include "Parallel.h"
+#include "TileGrid.h"
+#include "TileMask.h"
+
+namespace {
+    // points on a face shared by two tetrahedra have to be inside at least one of them
+    const double barycentricTolerance = 1e-10;
+    const double indexTolerance = 1e-6;
+
+    // z-slices per slab of CreateMask (one layer of VOI tiles), and the fewest tetrahedra a thread bins
+    const int slabSize = 8;
+    const std::size_t minimumBinningChunkSize = 4096;
+
+    // vtkQuadraticTetra: corners 0-3, midside nodes 4 (0,1), 5 (1,2), 6 (0,2), 7 (0,3), 8 (1,3), 9 (2,3)
+    const int quadraticTetraDecomposition[8][4] = {
+            {0, 4, 6, 7}, {4, 1, 5, 8}, {6, 5, 2, 9}, {7, 8, 9, 3},
+            {4, 5, 6, 8}, {4, 6, 7, 8}, {6, 7, 8, 9}, {5, 6, 8, 9}
+    };
+
+    // inverse of the edge matrix of the tetrahedron _p: maps p - _p[0] to the barycentric coordinates of the vertices 1
+    // to 3. False if the tetrahedron is degenerate (covers no volume).
+    bool invert(const double _p[4][3], double _inverse[3][3]) {
+        double e[3][3];  // edge vectors as columns
+        for (auto i = 0; i < 3; ++i) {
+            e[i][0] = _p[1][i] - _p[0][i];
+            e[i][1] = _p[2][i] - _p[0][i];
+            e[i][2] = _p[3][i] - _p[0][i];
+        }
+
+        auto det = e[0][0] * (e[1][1] * e[2][2] - e[1][2] * e[2][1])
+                   - e[0][1] * (e[1][0] * e[2][2] - e[1][2] * e[2][0])
+                   + e[0][2] * (e[1][0] * e[2][1] - e[1][1] * e[2][0]);
+        auto scale = 1.0;
+        for (auto j = 0; j < 3; ++j) {
+            scale *= std::sqrt(e[0][j] * e[0][j] + e[1][j] * e[1][j] + e[2][j] * e[2][j]);
+        }
+        if (std::abs(det) <= 1e-12 * scale) {
+            return false;
+        }
+
+        // inverse by the adjugate
+        _inverse[0][0] = (e[1][1] * e[2][2] - e[1][2] * e[2][1]) / det;
+        _inverse[0][1] = (e[0][2] * e[2][1] - e[0][1] * e[2][2]) / det;
+        _inverse[0][2] = (e[0][1] * e[1][2] - e[0][2] * e[1][1]) / det;
+        _inverse[1][0] = (e[1][2] * e[2][0] - e[1][0] * e[2][2]) / det;
+        _inverse[1][1] = (e[0][0] * e[2][2] - e[0][2] * e[2][0]) / det;
+        _inverse[1][2] = (e[0][2] * e[1][0] - e[0][0] * e[1][2]) / det;
+        _inverse[2][0] = (e[1][0] * e[2][1] - e[1][1] * e[2][0]) / det;
+        _inverse[2][1] = (e[0][1] * e[2][0] - e[0][0] * e[2][1]) / det;
+        _inverse[2][2] = (e[0][0] * e[1][1] - e[0][1] * e[1][0]) / det;
+        return true;
+    }
+}
+
+MeshVoxelizer::MeshVoxelizer(vtkUnstructuredGridBase *_mesh)
+        : m_Mesh(_mesh) {
+    for (auto i = 0; i < 3; ++i) {
+        m_Bounds[2 * i] = std::numeric_limits<double>::max();
+        m_Bounds[2 * i + 1] = -std::numeric_limits<double>::max();
+    }
+
+    // the point ids of the tetrahedra are stored in 32 bits
+    m_Valid = _mesh->GetNumberOfPoints() <= std::numeric_limits<std::uint32_t>::max();
+    if (!m_Valid) {
+        MITK_ERROR("ch.zhaw.materialmapping") << "meshes with more than " << std::numeric_limits<std::uint32_t>::max()
+                                              << " points are not supported";
+        _mesh = nullptr;
+    }
+
+    auto pointIds = vtkSmartPointer<vtkIdList>::New();
+    auto cell = vtkSmartPointer<vtkGenericCell>::New();
+    auto triangulationIds = vtkSmartPointer<vtkIdList>::New();
+    auto triangulationPoints = vtkSmartPointer<vtkPoints>::New();
+
+    for (vtkIdType cellId = 0; _mesh && cellId < _mesh->GetNumberOfCells(); ++cellId) {
+        switch (_mesh->GetCellType(cellId)) {
+            case VTK_TETRA: {
+                _mesh->GetCellPoints(cellId, pointIds);
+                addTetrahedron(pointIds->GetId(0), pointIds->GetId(1), pointIds->GetId(2), pointIds->GetId(3));
+                break;
+            }
+
+            case VTK_QUADRATIC_TETRA: {
+                _mesh->GetCellPoints(cellId, pointIds);
+                for (const auto &t : quadraticTetraDecomposition) {
+                    addTetrahedron(pointIds->GetId(t[0]), pointIds->GetId(t[1]), pointIds->GetId(t[2]),
+                                   pointIds->GetId(t[3]));
+                }
+                break;
+            }
+
+            default: {
+                _mesh->GetCell(cellId, cell);
+                if (cell->GetCellDimension() != 3) {
+                    break;
+                }
+                // the ids of the triangulation are the mesh point ids of the cell
+                cell->Triangulate(0, triangulationIds, triangulationPoints);
+                for (vtkIdType t = 0; t + 3 < triangulationIds->GetNumberOfIds(); t += 4) {
+                    addTetrahedron(triangulationIds->GetId(t), triangulationIds->GetId(t + 1),
+                                   triangulationIds->GetId(t + 2), triangulationIds->GetId(t + 3));
+                }
+                break;
+            }
+        }
+    }
+    m_Tetrahedra.shrink_to_fit();
+
+    if (m_Tetrahedra.empty()) {
+        for (auto i = 0; i < 3; ++i) {
+            m_Bounds[2 * i] = 1;
+            m_Bounds[2 * i + 1] = -1;
+        }
+    }
+}
+
+void MeshVoxelizer::getPoints(const PointIds &_ids, double _p[4][3], double _bounds[6]) const {
+    for (auto j = 0; j < 4; ++j) {
+        m_Mesh->GetPoint(_ids[j], _p[j]);
+    }
+    for (auto i = 0; i < 3; ++i) {
+        _bounds[2 * i] = std::min(std::min(_p[0][i], _p[1][i]), std::min(_p[2][i], _p[3][i]));
+        _bounds[2 * i + 1] = std::max(std::max(_p[0][i], _p[1][i]), std::max(_p[2][i], _p[3][i]));
+    }
+}
+
+void MeshVoxelizer::addTetrahedron(vtkIdType _p0, vtkIdType _p1, vtkIdType _p2, vtkIdType _p3) {
+    PointIds ids = {{static_cast<std::uint32_t>(_p0), static_cast<std::uint32_t>(_p1),
+                     static_cast<std::uint32_t>(_p2), static_cast<std::uint32_t>(_p3)}};
+    double p[4][3], bounds[6], inverse[3][3];
+    getPoints(ids, p, bounds);
+    for (auto i = 0; i < 3; ++i) {
+        m_Bounds[2 * i] = std::min(m_Bounds[2 * i], bounds[2 * i]);
+        m_Bounds[2 * i + 1] = std::max(m_Bounds[2 * i + 1], bounds[2 * i + 1]);
+    }
+    if (invert(p, inverse)) {
+        m_Tetrahedra.push_back(ids); // degenerate tetrahedra are dropped
+    }
+}
+
+void MeshVoxelizer::ActivateTiles(TileMask &_tiles, int _border) const {
+    double p[4][3], bounds[6];
+    for (const auto &ids : m_Tetrahedra) {
+        getPoints(ids, p, bounds);
+        _tiles.Activate(bounds, _border);
+    }
+}
+
+template<class TMark>
+void MeshVoxelizer::rasterize(const int _extent[6], const double _origin[3], const double _spacing[3],
+                              TMark _mark) const {
+    const int nx = _extent[1] - _extent[0] + 1;
+    const int ny = _extent[3] - _extent[2] + 1;
+    const int nz = _extent[5] - _extent[4] + 1;
+    if (nx <= 0 || ny <= 0 || nz <= 0) {
+        return;
+    }
+
+    // voxel index range [first, last] of the tetrahedron bounds in dimension _d, clamped to _min, _max
+    auto indexRange = [&](const double _bounds[6], int _d, int _min, int _max, int &_first, int &_last) {
+        auto first = std::ceil((_bounds[2 * _d] - _origin[_d]) / _spacing[_d] - indexTolerance);
+        auto last = std::floor((_bounds[2 * _d + 1] - _origin[_d]) / _spacing[_d] + indexTolerance);
+        _first = static_cast<int>(std::max<double>(first, _min));
+        _last = static_cast<int>(std::min<double>(last, _max));
+        return _first <= _last;
+    };
+
+    // the mask is split into z-slabs of slabSize slices. Each tetrahedron is listed in the slabs it overlaps, in one
+    // parallel pass over the tetrahedra (one list per slab and chunk, so the chunks do not share a list)
+    const int numberOfSlabs = (nz + slabSize - 1) / slabSize;
+    const auto numberOfChunks = Parallel::NumberOfChunks(m_Tetrahedra.size(), minimumBinningChunkSize);
+    std::vector<std::vector<std::vector<std::size_t>>> bins(numberOfChunks,
+                                                            std::vector<std::vector<std::size_t>>(numberOfSlabs));
+    Parallel::For(m_Tetrahedra.size(), minimumBinningChunkSize, [&](std::size_t _chunk, std::size_t _begin,
+                                                                     std::size_t _end) {
+        int first[3], last[3];
+        double p[4][3], bounds[6];
+        auto &chunkBins = bins[_chunk];
+        for (auto t = _begin; t < _end; ++t) {
+            getPoints(m_Tetrahedra[t], p, bounds);
+            if (!indexRange(bounds, 2, _extent[4], _extent[5], first[2], last[2]) ||
+                !indexRange(bounds, 1, _extent[2], _extent[3], first[1], last[1]) ||
+                !indexRange(bounds, 0, _extent[0], _extent[1], first[0], last[0])) {
+                continue;
+            }
+            for (auto slab = (first[2] - _extent[4]) / slabSize; slab <= (last[2] - _extent[4]) / slabSize; ++slab) {
+                chunkBins[slab].push_back(t);
+            }
+        }
+    });
+
+    // each thread owns a range of slabs, so no voxel is written by two threads. The transform of a tetrahedron is
+    // computed by each slab it overlaps.
+    auto rasterizeTetrahedron = [&](int _zBegin, int _zEnd, std::size_t _t) {
+        int first[3], last[3];
+        double p[4][3], bounds[6], inverse[3][3];
+        getPoints(m_Tetrahedra[_t], p, bounds);
+        if (!indexRange(bounds, 2, _zBegin, _zEnd - 1, first[2], last[2]) ||
+            !indexRange(bounds, 1, _extent[2], _extent[3], first[1], last[1]) ||
+            !indexRange(bounds, 0, _extent[0], _extent[1], first[0], last[0]) ||
+            !invert(p, inverse)) {
+            return;
+        }
+
+        for (auto z = first[2]; z <= last[2]; ++z) {
+            auto dz = _origin[2] + z * _spacing[2] - p[0][2];
+            for (auto y = first[1]; y <= last[1]; ++y) {
+                auto dy = _origin[1] + y * _spacing[1] - p[0][1];
+                for (auto x = first[0]; x <= last[0]; ++x) {
+                    auto dx = _origin[0] + x * _spacing[0] - p[0][0];
+                    auto b1 = inverse[0][0] * dx + inverse[0][1] * dy + inverse[0][2] * dz;
+                    auto b2 = inverse[1][0] * dx + inverse[1][1] * dy + inverse[1][2] * dz;
+                    auto b3 = inverse[2][0] * dx + inverse[2][1] * dy + inverse[2][2] * dz;
+                    if (b1 >= -barycentricTolerance && b2 >= -barycentricTolerance &&
+                        b3 >= -barycentricTolerance && 1 - b1 - b2 - b3 >= -barycentricTolerance) {
+                        _mark(x, y, z);
+                    }
+                }
+            }
+        }
+    };
+
+    Parallel::For(numberOfSlabs, 1, [&](int, int _begin, int _end) {
+        for (auto slab = _begin; slab < _end; ++slab) {
+            auto zBegin = _extent[4] + slab * slabSize;
+            auto zEnd = std::min(zBegin + slabSize, _extent[5] + 1);
+            for (const auto &chunkBins : bins) {
+                for (auto t : chunkBins[slab]) {
+                    rasterizeTetrahedron(zBegin, zEnd, t);
+                }
+            }
+        }
+    });
+}
+
+vtkSmartPointer<vtkImageData> MeshVoxelizer::CreateMask(vtkImageData *_img) const {
+    auto mask = vtkSmartPointer<vtkImageData>::New();
+    mask->CopyStructure(_img);
+    mask->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    auto maskPoints = static_cast<unsigned char *>(mask->GetScalarPointer());
+    std::fill(maskPoints, maskPoints + mask->GetNumberOfPoints(), 0);
+
+    int extent[6];
+    mask->GetExtent(extent);
+    const vtkIdType nx = extent[1] - extent[0] + 1;
+    const vtkIdType ny = extent[3] - extent[2] + 1;
+    rasterize(extent, mask->GetOrigin(), mask->GetSpacing(), [&](int _x, int _y, int _z) {
+        maskPoints[(_x - extent[0]) + (_y - extent[2]) * nx + (_z - extent[4]) * nx * ny] = 1;
+    });
+    return mask;
+}
+
+std::vector<unsigned char> MeshVoxelizer::CreateMask(const TileGrid &_grid) const {
+    std::vector<unsigned char> mask(_grid.GetStorageSize(), 0);
+    rasterize(_grid.GetExtent(), _grid.GetOrigin(), _grid.GetSpacing(), [&](int _x, int _y, int _z) {
+        auto id = _grid.GetId(_x, _y, _z);
+        if (_grid.IsStored(id)) {
+            mask[id] = 1;
+        }
+    });
+    return mask;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkUnstructuredGridBase.h>
+
+class TileGrid;
+class TileMask;
+
+/**
+ * Inside/outside mask of a volume mesh, rasterised directly from its cells.
+ *
+ * The cells are decomposed into linear tetrahedra once on construction: quadratic tetrahedra into 8 tetrahedra using
+ * their midside nodes (the same piecewise linear surface a subdivided surface extraction gives), other 3D cells by their
+ * own triangulation. A voxel is inside if its center lies inside any of the tetrahedra. The tetrahedra are binned to the
+ * z-slabs of the mask they overlap in one parallel pass, then the slabs are rasterised in parallel, each from its bin.
+ *
+ * Only the 4 point ids of each tetrahedron are stored (16 bytes), the coordinates are read from the mesh and the
+ * barycentric transform is computed where a tetrahedron is rasterised. The mesh must not change while the voxelizer is
+ * used. Meshes with 2^32 or more points are not supported, see IsValid().
+ *
+ * This replaces surface extraction + vtkPolyDataToImageStencil. Results only differ for voxel centers on (or within
+ * rounding distance of) the mesh surface.
+ */
+class MeshVoxelizer {
+public:
+    explicit MeshVoxelizer(vtkUnstructuredGridBase *_mesh);
+
+    /**
+     * False if the mesh is not supported (2^32 or more points). The voxelizer has no tetrahedra then, its masks are
+     * empty.
+     */
+    bool IsValid() const {
+        return m_Valid;
+    }
+
+    /**
+     * Bounds of the points of the 3D cells, as {xmin, xmax, ymin, ymax, zmin, zmax}.
+     */
+    const double *GetBounds() const {
+        return m_Bounds;
+    }
+
+    std::size_t GetNumberOfTetrahedra() const {
+        return m_Tetrahedra.size();
+    }
+
+    /**
+     * Memory of the tetrahedra in bytes.
+     */
+    std::size_t GetMemorySize() const {
+        return m_Tetrahedra.capacity() * sizeof(PointIds);
+    }
+
+    /**
+     * Creates an unsigned char image with the structure of _img: 1 for voxels inside the mesh, 0 otherwise.
+     */
+    vtkSmartPointer<vtkImageData> CreateMask(vtkImageData *_img) const;
+
+    /**
+     * Creates the voxel data of the same mask on a TileGrid. Inside voxels of inactive tiles are dropped.
+     */
+    std::vector<unsigned char> CreateMask(const TileGrid &_grid) const;
+
+    /**
+     * Activates the tiles overlapping the bounding boxes of the tetrahedra, dilated by _border voxels.
+     */
+    void ActivateTiles(TileMask &_tiles, int _border) const;
+
+private:
+    using PointIds = std::array<std::uint32_t, 4>;
+
+    // reads the points of a tetrahedron and their bounds
+    void getPoints(const PointIds &_ids, double _p[4][3], double _bounds[6]) const;
+    void addTetrahedron(vtkIdType _p0, vtkIdType _p1, vtkIdType _p2, vtkIdType _p3);
+    // calls _mark(x, y, z) for the inside voxels of _extent, no voxel is marked by two threads
+    template<class TMark>
+    void rasterize(const int _extent[6], const double _origin[3], const double _spacing[3], TMark _mark) const;
+
+    vtkSmartPointer<vtkUnstructuredGridBase> m_Mesh;
+    std::vector<PointIds> m_Tetrahedra;
+    double m_Bounds[6];
+    bool m_Valid;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * Splits of an index range [0, _n) into contiguous chunks processed by one thread each.
+ *
+ * There is one chunk per hardware thread, but no chunk is smaller than _minimumChunkSize (except the last one), so
+ * small ranges are not spread over threads that cost more to start than they save. The caller's thread processes the
+ * first chunk.
+ */
+namespace Parallel {
+    // number of chunks For splits [0, _n) into, e.g. to allocate a per chunk buffer
+    template<class TIndex>
+    TIndex NumberOfChunks(TIndex _n, std::size_t _minimumChunkSize = 1) {
+        if (_n <= 0) {
+            return 1;
+        }
+        std::size_t numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+        auto n = static_cast<std::size_t>(_n) / std::max<std::size_t>(1, _minimumChunkSize);
+        return static_cast<TIndex>(std::max<std::size_t>(1, std::min(numberOfThreads, n)));
+    }
+
+    // calls _function(chunk, begin, end) for the chunks of [0, _n) in parallel
+    template<class TIndex, class TFunction>
+    void For(TIndex _n, std::size_t _minimumChunkSize, TFunction _function) {
+        const auto numberOfChunks = NumberOfChunks(_n, _minimumChunkSize);
+        const auto n = std::max<TIndex>(0, _n);
+        const auto chunkSize = (n + numberOfChunks - 1) / numberOfChunks;
+
+        std::vector<std::thread> threads;
+        for (TIndex t = 1; t < numberOfChunks; ++t) {
+            threads.emplace_back(_function, t, std::min(t * chunkSize, n), std::min((t + 1) * chunkSize, n));
+        }
+        _function(TIndex(0), TIndex(0), std::min(chunkSize, n));
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+}
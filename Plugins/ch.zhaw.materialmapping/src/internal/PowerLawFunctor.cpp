@@ -1,13 +1,27 @@
+#include <algorithm>
+
 #include "PowerLawFunctor.h"
 
+void PowerLawFunctor::operator()(const float *_in, float *_out, std::size_t _n) const {
+    for (std::size_t i = 0; i < _n; ++i) {
+        _out[i] = static_cast<float>((*this)(static_cast<double>(_in[i])));
+    }
+}
+
 void PowerLawFunctor::AddPowerLaw(PowerLawParameters _p, double _upperBound) {
-    m_ParamMap.insert(std::make_pair(_upperBound, _p));
+    auto it = std::lower_bound(m_UpperBounds.begin(), m_UpperBounds.end(), _upperBound);
+    if (it != m_UpperBounds.end() && *it == _upperBound) {
+        return; // the power law added first is kept
+    }
+    m_PowerLaws.insert(m_PowerLaws.begin() + (it - m_UpperBounds.begin()), _p);
+    m_UpperBounds.insert(it, _upperBound);
 }
 
 std::ostream &operator<<(std::ostream &_out, const PowerLawFunctor &_f) {
     _out << "Power laws: " << std::endl;
-    for (const auto &pair : _f.m_ParamMap) {
-        _out << "[" << pair.first << "] E = " << pair.second.factor << " * rho ^ " << pair.second.exponent << " + " << pair.second.offset << std::endl;
+    for (std::size_t i = 0; i < _f.GetPowerLaws().size(); ++i) {
+        const auto &p = _f.GetPowerLaws()[i];
+        _out << "[" << _f.GetUpperBounds()[i] << "] E = " << p.factor << " * rho ^ " << p.exponent << " + " << p.offset << std::endl;
     }
     return _out;
-}
\ No newline at end of file
+}
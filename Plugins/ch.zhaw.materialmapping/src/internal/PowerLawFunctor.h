@@ -1,35 +1,37 @@
 #pragma once
 
 #include <cmath>
-#include <map>
+#include <cstddef>
 #include <ostream>
+#include <vector>
 
 #include "PowerLawParameters.h"
 
 /**
- * Functor that maintains a map of power laws and their definition intervals.
+ * Piecewise power law: a list of power laws and the upper bounds of their definition intervals.
+ *
+ * The power laws are stored in flat arrays sorted by upper bound. Evaluating the functor does not modify it, so a
+ * functor can be shared by any number of threads once it is set up with AddPowerLaw().
  */
 class PowerLawFunctor {
 public:
     /**
-     * Selects the correct power law for the given rho and applies it.
+     * Selects the correct power law for the given rho and applies it. Without power laws, the result is 0.
      */
     template<class TPixel>
     inline double operator()(const TPixel &_rho) const {
-        auto it = m_ParamMap.upper_bound(_rho);
-
-        if (it != cached_it) {  // the PowerLawParameter comparator is rather slow, so we'll use the iterator
-            if (it == m_ParamMap.end()) { // value is out of bounds, fall back on the last defined one
-                cached_param = &(*m_ParamMap.rbegin()).second;
-            } else {
-                cached_param = &(*it).second;
-            }
-            cached_it = it;
+        if (m_PowerLaws.empty()) {
+            return 0;
         }
-
-        return cached_param->factor * std::pow(_rho, cached_param->exponent) + cached_param->offset;
+        const auto &p = m_PowerLaws[findInterval(_rho)];
+        return p.factor * std::pow(_rho, p.exponent) + p.offset;
     }
 
+    /**
+     * Evaluates _n values of _in to _out. _in and _out may be the same buffer.
+     */
+    void operator()(const float *_in, float *_out, std::size_t _n) const;
+
     /**
      * Add a power law with an upper bound (rho < upper bound). The lower bound to a power law is either the upper bound
      * of the previous power law or the minimal value.
@@ -39,21 +41,30 @@ public:
      */
     void AddPowerLaw(PowerLawParameters _p, double _upperBound);
 
-    std::map<double, PowerLawParameters> m_ParamMap;
+    const std::vector<double> &GetUpperBounds() const {
+        return m_UpperBounds;
+    }
 
-public:
+    const std::vector<PowerLawParameters> &GetPowerLaws() const {
+        return m_PowerLaws;
+    }
+
+private:
     /**
-     * Currently, the functor is applied in a way like this (pseudo code):
-     * for(auto &point; ugrid->GetPoints()) {
-     *   valCT = img[point];
-     *   valRho = boneDensityFunctor(valCT);
-     *   valEMorgan = powerLawFunctor(valRho);
-     * }
-     * Since the number of power laws is usually rather small and access order of points tends to be favorable, caching
-     * the power law parameters turns out to be a surprisingly big performance boost.
+     * Index of the power law of _rho: the first upper bound > _rho, the last power law if out of bounds. The number of
+     * power laws is small, so all bounds are compared instead of branching in a binary search.
      */
-    mutable std::map<double, PowerLawParameters>::const_iterator cached_it;
-    mutable PowerLawParameters const *cached_param;
+    template<class TPixel>
+    inline std::size_t findInterval(const TPixel &_rho) const {
+        std::size_t i = 0;
+        for (auto bound : m_UpperBounds) {
+            i += _rho >= bound;
+        }
+        return i < m_UpperBounds.size() ? i : m_UpperBounds.size() - 1;
+    }
+
+    std::vector<double> m_UpperBounds; // ascending
+    std::vector<PowerLawParameters> m_PowerLaws;
 };
 
-std::ostream &operator<<(std::ostream &_out, const PowerLawFunctor &_f);
\ No newline at end of file
+std::ostream &operator<<(std::ostream &_out, const PowerLawFunctor &_f);
@@ -0,0 +1,85 @@
+#include <algorithm>
+
+#include "TileGrid.h"
+
+namespace {
+    template<class T>
+    vtkSmartPointer<vtkImageData> createImage(const TileGrid &_grid, const double _origin[3], const double _spacing[3],
+                                              const T *_values, int _scalarType) {
+        auto img = vtkSmartPointer<vtkImageData>::New();
+        img->SetExtent(const_cast<int *>(_grid.GetExtent()));
+        img->SetOrigin(_origin[0], _origin[1], _origin[2]);
+        img->SetSpacing(_spacing[0], _spacing[1], _spacing[2]);
+        img->AllocateScalars(_scalarType, 1);
+        auto points = static_cast<T *>(img->GetScalarPointer());
+        std::fill(points, points + img->GetNumberOfPoints(), T(0));
+        for (std::size_t b = 0; b < _grid.GetNumberOfBlocks(); ++b) {
+            _grid.ForEachRow(b, [&](vtkIdType _id, int _xBegin, int _xEnd, int _y, int _z) {
+                std::copy(_values + _id, _values + _id + (_xEnd - _xBegin),
+                          static_cast<T *>(img->GetScalarPointer(_xBegin, _y, _z)));
+            });
+        }
+        return img;
+    }
+
+    template<class T>
+    void readImage(const TileGrid &_grid, vtkImageData *_img, T *_values) {
+        std::fill(_values, _values + _grid.GetStorageSize(), T(0));
+        for (std::size_t b = 0; b < _grid.GetNumberOfBlocks(); ++b) {
+            _grid.ForEachRow(b, [&](vtkIdType _id, int _xBegin, int _xEnd, int _y, int _z) {
+                auto row = static_cast<const T *>(_img->GetScalarPointer(_xBegin, _y, _z));
+                std::copy(row, row + (_xEnd - _xBegin), _values + _id);
+            });
+        }
+    }
+}
+
+TileGrid::TileGrid(const TileMask &_tiles, const int _extent[6]) {
+    std::size_t numberOfTiles = 1;
+    for (auto i = 0; i < 3; ++i) {
+        m_Extent[2 * i] = _extent[2 * i];
+        m_Extent[2 * i + 1] = _extent[2 * i + 1];
+        m_Origin[i] = _tiles.GetOrigin()[i];
+        m_Spacing[i] = _tiles.GetSpacing()[i];
+        m_TileOrigin[i] = _tiles.GetExtent()[2 * i];
+        m_FirstTile[i] = (_extent[2 * i] - m_TileOrigin[i]) / TileSize;
+        auto lastTile = (_extent[2 * i + 1] - m_TileOrigin[i]) / TileSize;
+        m_Tiles[i] = _extent[2 * i + 1] >= _extent[2 * i] ? lastTile - m_FirstTile[i] + 1 : 0;
+        numberOfTiles *= m_Tiles[i];
+    }
+
+    // the active tiles get consecutive blocks, the zero block id is only known once they are counted
+    m_Blocks.assign(numberOfTiles, -1);
+    for (auto tz = 0; tz < m_Tiles[2]; ++tz) {
+        for (auto ty = 0; ty < m_Tiles[1]; ++ty) {
+            for (auto tx = 0; tx < m_Tiles[0]; ++tx) {
+                std::array<int, 3> origin = {{m_TileOrigin[0] + (m_FirstTile[0] + tx) * TileSize,
+                                              m_TileOrigin[1] + (m_FirstTile[1] + ty) * TileSize,
+                                              m_TileOrigin[2] + (m_FirstTile[2] + tz) * TileSize}};
+                if (_tiles.IsActive(origin[0], origin[1], origin[2])) {
+                    m_Blocks[tx + m_Tiles[0] * (ty + m_Tiles[1] * tz)] =
+                            static_cast<vtkIdType>(m_BlockOrigins.size()) * TileVoxels;
+                    m_BlockOrigins.push_back(origin);
+                }
+            }
+        }
+    }
+    const auto zeroBlock = static_cast<vtkIdType>(m_BlockOrigins.size()) * TileVoxels;
+    std::replace(m_Blocks.begin(), m_Blocks.end(), static_cast<vtkIdType>(-1), zeroBlock);
+}
+
+vtkSmartPointer<vtkImageData> TileGrid::CreateImage(const float *_values) const {
+    return createImage(*this, m_Origin, m_Spacing, _values, VTK_FLOAT);
+}
+
+vtkSmartPointer<vtkImageData> TileGrid::CreateImage(const unsigned char *_values) const {
+    return createImage(*this, m_Origin, m_Spacing, _values, VTK_UNSIGNED_CHAR);
+}
+
+void TileGrid::ReadImage(vtkImageData *_img, float *_values) const {
+    readImage(*this, _img, _values);
+}
+
+void TileGrid::ReadImage(vtkImageData *_img, unsigned char *_values) const {
+    readImage(*this, _img, _values);
+}
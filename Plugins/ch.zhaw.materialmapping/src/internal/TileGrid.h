@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkType.h>
+
+#include "TileMask.h"
+
+/**
+ * Sparse voxel layout of the active tiles of a TileMask. Each active tile is a block of TileVoxels consecutive voxel
+ * ids, x fastest within the block, the blocks are ordered z, y, x by tile. All voxels of inactive tiles share the zero
+ * block after the last one. The voxel data itself are plain arrays of GetStorageSize() values indexed by the voxel ids,
+ * so their memory and the work of the stages visiting the blocks grow with the active tiles only.
+ *
+ * The grid covers an extent within the one of the tile mask, e.g. a z-slab of it, the tiles stay aligned to the mask.
+ * Voxel indices are absolute as in TileMask. The values of the zero block are read as 0 by neighborhood stencils, they
+ * must never be written.
+ */
+class TileGrid {
+public:
+    static const int TileSize = TileMask::TileSize;
+    static const vtkIdType TileVoxels = TileSize * TileSize * TileSize;
+    static const int NeighborhoodSize = TileSize + 2;
+    static_assert((TileSize & (TileSize - 1)) == 0, "the local voxel indices are masked, the tile size has to be a power of 2");
+
+    TileGrid(const TileMask &_tiles, const int _extent[6]);
+
+    const int *GetExtent() const {
+        return m_Extent;
+    }
+
+    const double *GetOrigin() const {
+        return m_Origin;
+    }
+
+    const double *GetSpacing() const {
+        return m_Spacing;
+    }
+
+    std::size_t GetNumberOfBlocks() const {
+        return m_BlockOrigins.size();
+    }
+
+    /**
+     * Number of values of a voxel data array: the blocks and the zero block.
+     */
+    std::size_t GetStorageSize() const {
+        return (m_BlockOrigins.size() + 1) * TileVoxels;
+    }
+
+    /**
+     * Memory of the layout in bytes, without the voxel data.
+     */
+    std::size_t GetMemorySize() const {
+        return m_Blocks.capacity() * sizeof(vtkIdType) + m_BlockOrigins.capacity() * sizeof(std::array<int, 3>);
+    }
+
+    /**
+     * Id of the voxel (_x, _y, _z) within the extent, an id in the zero block if its tile is inactive.
+     */
+    vtkIdType GetId(int _x, int _y, int _z) const {
+        auto x = static_cast<unsigned int>(_x - m_TileOrigin[0]);
+        auto y = static_cast<unsigned int>(_y - m_TileOrigin[1]);
+        auto z = static_cast<unsigned int>(_z - m_TileOrigin[2]);
+        auto tile = (x / TileSize - m_FirstTile[0]) +
+                    m_Tiles[0] * ((y / TileSize - m_FirstTile[1]) + m_Tiles[1] * (z / TileSize - m_FirstTile[2]));
+        return m_Blocks[tile] + (x & (TileSize - 1)) + TileSize * ((y & (TileSize - 1)) + TileSize * (z & (TileSize - 1)));
+    }
+
+    /**
+     * Id of the neighbor (_x + _dx, _y + _dy, _z + _dz) of the voxel _id at (_x, _y, _z), with _d in [-1, 1]. The
+     * neighbor has to lie within the extent.
+     */
+    vtkIdType GetNeighborId(vtkIdType _id, int _x, int _y, int _z, int _dx, int _dy, int _dz) const {
+        auto local = static_cast<unsigned int>(_id & (TileVoxels - 1));
+        auto x = (local & (TileSize - 1)) + _dx;
+        auto y = ((local / TileSize) & (TileSize - 1)) + _dy;
+        auto z = local / (TileSize * TileSize) + _dz;
+        if (x < TileSize && y < TileSize && z < TileSize) { // wraps around below 0
+            return _id + _dx + TileSize * (_dy + TileSize * _dz);
+        }
+        return GetId(_x + _dx, _y + _dy, _z + _dz);
+    }
+
+    /**
+     * Index of the stored voxel _id.
+     */
+    void GetIndex(vtkIdType _id, int &_x, int &_y, int &_z) const {
+        const auto &origin = m_BlockOrigins[static_cast<std::size_t>(_id) / TileVoxels];
+        auto local = static_cast<int>(_id & (TileVoxels - 1));
+        _x = origin[0] + (local & (TileSize - 1));
+        _y = origin[1] + ((local / TileSize) & (TileSize - 1));
+        _z = origin[2] + local / (TileSize * TileSize);
+    }
+
+    /**
+     * False for the ids of the zero block.
+     */
+    bool IsStored(vtkIdType _id) const {
+        return _id < static_cast<vtkIdType>(m_BlockOrigins.size()) * TileVoxels;
+    }
+
+    /**
+     * Calls _function(id, xBegin, xEnd, y, z) for each row of the block _block within the extent. The voxels
+     * [xBegin, xEnd) of the row have the consecutive ids starting at id.
+     */
+    template<class TFunction>
+    void ForEachRow(std::size_t _block, TFunction _function) const {
+        const auto &origin = m_BlockOrigins[_block];
+        auto xBegin = std::max(origin[0], m_Extent[0]);
+        auto xEnd = std::min(origin[0] + TileSize, m_Extent[1] + 1);
+        auto zBegin = std::max(origin[2], m_Extent[4]);
+        auto zEnd = std::min(origin[2] + TileSize, m_Extent[5] + 1);
+        auto yBegin = std::max(origin[1], m_Extent[2]);
+        auto yEnd = std::min(origin[1] + TileSize, m_Extent[3] + 1);
+        for (auto z = zBegin; z < zEnd; ++z) {
+            for (auto y = yBegin; y < yEnd; ++y) {
+                auto id = _block * TileVoxels + (xBegin - origin[0]) +
+                          TileSize * ((y - origin[1]) + TileSize * (z - origin[2]));
+                _function(static_cast<vtkIdType>(id), xBegin, xEnd, y, z);
+            }
+        }
+    }
+
+    /**
+     * Calls _function(id, x, y, z) for each voxel of the block _block within the extent.
+     */
+    template<class TFunction>
+    void ForEachVoxel(std::size_t _block, TFunction _function) const {
+        ForEachRow(_block, [&](vtkIdType _id, int _xBegin, int _xEnd, int _y, int _z) {
+            for (auto x = _xBegin; x < _xEnd; ++x) {
+                _function(_id + (x - _xBegin), x, _y, _z);
+            }
+        });
+    }
+
+    /**
+     * Copies the values of the block _block and of its neighbors up to one voxel away to _neighborhood, which holds
+     * NeighborhoodSize^3 values with x fastest. Neighbors outside of the extent get the value _outside. Stencils can
+     * then use fixed offsets for the voxels of a block.
+     */
+    template<class T>
+    void GetNeighborhood(std::size_t _block, const T *_values, T _outside, T *_neighborhood) const {
+        const auto &origin = m_BlockOrigins[_block];
+        for (auto z = origin[2] - 1; z <= origin[2] + TileSize; ++z) {
+            for (auto y = origin[1] - 1; y <= origin[1] + TileSize; ++y) {
+                auto inside = y >= m_Extent[2] && y <= m_Extent[3] && z >= m_Extent[4] && z <= m_Extent[5];
+                for (auto x = origin[0] - 1; x <= origin[0] + TileSize; ++x) {
+                    *_neighborhood++ = inside && x >= m_Extent[0] && x <= m_Extent[1] ? _values[GetId(x, y, z)] : _outside;
+                }
+            }
+        }
+    }
+
+    /**
+     * Dense image of the extent with the voxel data _values, 0 in inactive tiles. E.g. for the intermediate results.
+     */
+    vtkSmartPointer<vtkImageData> CreateImage(const float *_values) const;
+    vtkSmartPointer<vtkImageData> CreateImage(const unsigned char *_values) const;
+
+    /**
+     * Copies the voxels of the active tiles from the image _img, which has to cover the extent, to _values. The other
+     * values of the storage are set to 0.
+     */
+    void ReadImage(vtkImageData *_img, float *_values) const;
+    void ReadImage(vtkImageData *_img, unsigned char *_values) const;
+
+private:
+    int m_Extent[6];
+    double m_Origin[3];
+    double m_Spacing[3];
+    int m_TileOrigin[3];                            // first voxel of the tile mask
+    int m_FirstTile[3];                             // tile of the first voxel of the extent
+    int m_Tiles[3];                                 // tiles overlapping the extent
+    std::vector<vtkIdType> m_Blocks;                // first voxel id per tile, the zero block for inactive ones
+    std::vector<std::array<int, 3>> m_BlockOrigins; // first voxel per block
+};
@@ -0,0 +1,58 @@
+#include <cmath>
+
+#include "TileMask.h"
+
+TileMask::TileMask(const int _extent[6], const double _origin[3], const double _spacing[3]) {
+    std::size_t numberOfTiles = 1;
+    for (auto i = 0; i < 3; ++i) {
+        m_Extent[2 * i] = _extent[2 * i];
+        m_Extent[2 * i + 1] = _extent[2 * i + 1];
+        m_Origin[i] = _origin[i];
+        m_Spacing[i] = _spacing[i];
+        auto size = _extent[2 * i + 1] - _extent[2 * i] + 1;
+        m_Tiles[i] = size > 0 ? (size + TileSize - 1) / TileSize : 0;
+        numberOfTiles *= m_Tiles[i];
+    }
+    m_Active.assign(numberOfTiles, 0);
+}
+
+void TileMask::Activate(const double _bounds[6], int _border) {
+    int first[3], last[3];
+    for (auto i = 0; i < 3; ++i) {
+        auto lower = std::floor((_bounds[2 * i] - m_Origin[i]) / m_Spacing[i]) - _border;
+        auto upper = std::ceil((_bounds[2 * i + 1] - m_Origin[i]) / m_Spacing[i]) + _border;
+        lower = std::max<double>(lower, m_Extent[2 * i]);
+        upper = std::min<double>(upper, m_Extent[2 * i + 1]);
+        if (lower > upper) {
+            return;
+        }
+        first[i] = (static_cast<int>(lower) - m_Extent[2 * i]) / TileSize;
+        last[i] = (static_cast<int>(upper) - m_Extent[2 * i]) / TileSize;
+    }
+
+    for (auto z = first[2]; z <= last[2]; ++z) {
+        for (auto y = first[1]; y <= last[1]; ++y) {
+            auto row = m_Active.data() + m_Tiles[0] * (y + m_Tiles[1] * z);
+            std::fill(row + first[0], row + last[0] + 1, 1);
+        }
+    }
+}
+
+void TileMask::ActivateAll() {
+    std::fill(m_Active.begin(), m_Active.end(), 1);
+}
+
+bool TileMask::IsActive(int _x, int _y, int _z) const {
+    if (_x < m_Extent[0] || _x > m_Extent[1] || _y < m_Extent[2] || _y > m_Extent[3] || _z < m_Extent[4] ||
+        _z > m_Extent[5]) {
+        return false;
+    }
+    auto tx = (_x - m_Extent[0]) / TileSize;
+    auto ty = (_y - m_Extent[2]) / TileSize;
+    auto tz = (_z - m_Extent[4]) / TileSize;
+    return m_Active[tx + m_Tiles[0] * (ty + m_Tiles[1] * tz)] != 0;
+}
+
+std::size_t TileMask::GetNumberOfActiveTiles() const {
+    return static_cast<std::size_t>(std::count(m_Active.begin(), m_Active.end(), 1));
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Coarse mask of TileSize^3 voxel tiles over an image extent, one byte per tile. Tiles are activated by world space
+ * boxes. The mask does not hold voxel data, the voxels of the active tiles are stored by a TileGrid.
+ *
+ * Voxel indices are absolute (as in the image extent), voxels outside of the extent are never active.
+ */
+class TileMask {
+public:
+    static const int TileSize = 8;
+
+    TileMask(const int _extent[6], const double _origin[3], const double _spacing[3]);
+
+    /**
+     * Activates all tiles overlapping the box _bounds {xmin, xmax, ymin, ymax, zmin, zmax} dilated by _border voxels.
+     */
+    void Activate(const double _bounds[6], int _border);
+
+    void ActivateAll();
+
+    bool IsActive(int _x, int _y, int _z) const;
+
+    std::size_t GetNumberOfActiveTiles() const;
+
+    const int *GetExtent() const {
+        return m_Extent;
+    }
+
+    const double *GetOrigin() const {
+        return m_Origin;
+    }
+
+    const double *GetSpacing() const {
+        return m_Spacing;
+    }
+
+    std::size_t GetNumberOfTiles() const {
+        return m_Active.size();
+    }
+
+    /**
+     * Memory of the mask in bytes.
+     */
+    std::size_t GetMemorySize() const {
+        return m_Active.size() * sizeof(unsigned char);
+    }
+
+    /**
+     * Calls _function(xBegin, xEnd) for each run of active voxels [xBegin, xEnd) in the row (_y, _z).
+     */
+    template<class TFunction>
+    void ForEachActiveSpan(int _y, int _z, TFunction _function) const {
+        if (_y < m_Extent[2] || _y > m_Extent[3] || _z < m_Extent[4] || _z > m_Extent[5]) {
+            return;
+        }
+        auto row = m_Active.data() + m_Tiles[0] * ((_y - m_Extent[2]) / TileSize +
+                                                   m_Tiles[1] * ((_z - m_Extent[4]) / TileSize));
+        for (auto tx = 0; tx < m_Tiles[0];) {
+            if (!row[tx]) {
+                ++tx;
+                continue;
+            }
+            auto begin = tx;
+            while (tx < m_Tiles[0] && row[tx]) {
+                ++tx;
+            }
+            _function(m_Extent[0] + begin * TileSize, std::min(m_Extent[0] + tx * TileSize, m_Extent[1] + 1));
+        }
+    }
+
+private:
+    int m_Extent[6];
+    double m_Origin[3];
+    double m_Spacing[3];
+    int m_Tiles[3];
+    std::vector<unsigned char> m_Active;
+};
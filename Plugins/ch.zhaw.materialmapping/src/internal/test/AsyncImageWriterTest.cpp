@@ -0,0 +1,81 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <vtkImageData.h>
+#include <vtkMetaImageReader.h>
+#include <vtkSmartPointer.h>
+
+#include "../AsyncImageWriter.h"
+
+namespace
+{
+    vtkSmartPointer<vtkImageData> createImage()
+    {
+        auto img = vtkSmartPointer<vtkImageData>::New();
+        img->SetExtent(2, 12, -3, 5, 0, 6);
+        img->SetSpacing(0.5, 0.7, 1.1);
+        img->SetOrigin(-1, 2, 3);
+        img->AllocateScalars(VTK_FLOAT, 1);
+        auto points = static_cast<float *>(img->GetScalarPointer());
+        for (auto i = 0; i < img->GetNumberOfPoints(); ++i)
+        {
+            points[i] = static_cast<float>(i) * 0.25f;
+        }
+        return img;
+    }
+
+    std::vector<float> readImage(const std::string& _filename)
+    {
+        auto reader = vtkSmartPointer<vtkMetaImageReader>::New();
+        reader->SetFileName(_filename.c_str());
+        reader->Update();
+        auto img = reader->GetOutput();
+        REQUIRE(img->GetScalarType() == VTK_FLOAT);
+        auto points = static_cast<float *>(img->GetScalarPointer());
+        return std::vector<float>(points, points + img->GetNumberOfPoints());
+    }
+}
+
+TEST_CASE("AsyncImageWriter"){
+    auto img = createImage();
+    auto points = static_cast<float *>(img->GetScalarPointer());
+    std::vector<std::vector<float>> expected;
+    std::vector<std::string> filenames;
+
+    {
+        // more images than the queue holds, the image is modified after each write
+        AsyncImageWriter writer(2);
+        for (auto i = 0; i < 6; ++i)
+        {
+            expected.emplace_back(points, points + img->GetNumberOfPoints());
+            filenames.push_back("AsyncImageWriterTest_" + std::to_string(i) + ".mhd");
+            writer.Write(filenames.back(), img);
+            for (auto j = 0; j < img->GetNumberOfPoints(); ++j)
+            {
+                points[j] += 1.0f;
+            }
+        }
+        writer.Flush();
+
+        for (std::size_t i = 0; i < filenames.size(); ++i)
+        {
+            REQUIRE(readImage(filenames[i]) == expected[i]);
+        }
+
+        // queued without snapshot, the destructor waits for it
+        filenames.push_back("AsyncImageWriterTest_shared.mhd");
+        expected.emplace_back(points, points + img->GetNumberOfPoints());
+        writer.Write(filenames.back(), img, false);
+    }
+    REQUIRE(readImage(filenames.back()) == expected.back());
+
+    for (const auto& filename : filenames)
+    {
+        std::remove(filename.c_str());
+        std::remove((filename.substr(0, filename.size() - 4) + ".zraw").c_str());
+        std::remove((filename.substr(0, filename.size() - 4) + ".raw").c_str());
+    }
+}
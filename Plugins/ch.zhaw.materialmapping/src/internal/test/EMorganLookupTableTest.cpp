@@ -0,0 +1,89 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+#include "../BoneDensityFunctor.h"
+#include "../PowerLawFunctor.h"
+#include "../EMorganLookupTable.h"
+
+TEST_CASE("EMorganLookupTable"){
+    BoneDensityFunctor densityFunctor;
+    densityFunctor.SetRhoCt(BoneDensityParameters::RhoCt(0.0087, -0.00159));
+    densityFunctor.SetRhoAsh(BoneDensityParameters::RhoAsh(0.09, 1.14));
+    densityFunctor.SetRhoApp(BoneDensityParameters::RhoApp(0.6));
+
+    PowerLawFunctor powerLawFunctor;
+    powerLawFunctor.AddPowerLaw(PowerLawParameters(6850, 1.49, 0), 1);
+    powerLawFunctor.AddPowerLaw(PowerLawParameters(6000, 1.2, 3), 5);
+    powerLawFunctor.AddPowerLaw(PowerLawParameters(100, 2, 1), 10);
+
+    // the functor chain as evaluated by the material mapping
+    auto expected = [&](double _ct) {
+        return powerLawFunctor(std::max(densityFunctor(_ct), 0.0));
+    };
+
+    EMorganLookupTable lookupTable(densityFunctor, powerLawFunctor, -1024, 3071);
+
+    SECTION("integer values"){
+        for (auto ct = -2000; ct <= 5000; ++ct) {
+            REQUIRE(lookupTable(ct) == expected(ct));
+            REQUIRE(lookupTable(static_cast<short>(ct)) == expected(ct));
+        }
+    }
+
+    SECTION("floating point values"){
+        std::vector<double> numbers {-99999, -1024.5, -0.25, 0, 0.0001, 99.5, 150.75, 3071, 3071.5, 99999};
+        for (const auto &nr : numbers) {
+            REQUIRE(lookupTable(nr) == expected(nr));
+            REQUIRE(lookupTable(static_cast<float>(nr)) == expected(static_cast<float>(nr)));
+        }
+    }
+
+    SECTION("without density clamping"){
+        EMorganLookupTable unclampedTable(densityFunctor, powerLawFunctor, -1024, 3071, false);
+        for (auto ct = 0; ct <= 3071; ++ct) {
+            REQUIRE(unclampedTable(ct) == powerLawFunctor(densityFunctor(ct)));
+        }
+    }
+
+    SECTION("parallel buffer evaluation"){
+        std::vector<short> ct(1 << 20);
+        for (auto i = 0u; i < ct.size(); ++i) {
+            ct[i] = static_cast<short>(i % 6000) - 2000;
+        }
+
+        std::vector<float> e(ct.size());
+        lookupTable.Apply(ct.data(), e.data(), ct.size());
+        std::vector<float> eInPlace(ct.begin(), ct.end());
+        lookupTable.Apply(eInPlace.data(), eInPlace.data(), eInPlace.size());
+
+        for (auto i = 0u; i < ct.size(); ++i) {
+            REQUIRE(e[i] == static_cast<float>(expected(ct[i])));
+            REQUIRE(eInPlace[i] == e[i]);
+        }
+    }
+
+    SECTION("image evaluation"){
+        auto image = vtkSmartPointer<vtkImageData>::New();
+        image->SetDimensions(16, 16, 16);
+        image->SetOrigin(1, 2, 3);
+        image->AllocateScalars(VTK_SHORT, 1);
+        auto ct = static_cast<short *>(image->GetScalarPointer());
+        for (auto i = 0; i < image->GetNumberOfPoints(); ++i) {
+            ct[i] = static_cast<short>(i - 1000);
+        }
+
+        auto eImage = lookupTable.CreateEImage(image);
+        REQUIRE(eImage->GetScalarType() == VTK_FLOAT);
+        REQUIRE(eImage->GetNumberOfPoints() == image->GetNumberOfPoints());
+        REQUIRE(eImage->GetOrigin()[2] == 3);
+        auto e = static_cast<float *>(eImage->GetScalarPointer());
+        for (auto i = 0; i < image->GetNumberOfPoints(); ++i) {
+            REQUIRE(e[i] == static_cast<float>(expected(ct[i])));
+        }
+    }
+}
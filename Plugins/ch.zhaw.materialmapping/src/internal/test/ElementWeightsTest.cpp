@@ -0,0 +1,80 @@
+#include "catch.hpp"
+
+#include <vector>
+
+#include <mitkUnstructuredGrid.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnstructuredGrid.h>
+
+#include "../ElementWeights.h"
+
+namespace {
+    // a regular and an irregular tetrahedron sharing the face 1, 2, 3
+    vtkSmartPointer<vtkUnstructuredGrid> createGrid() {
+        auto points = vtkSmartPointer<vtkPoints>::New();
+        points->InsertNextPoint(0, 0, 0);
+        points->InsertNextPoint(1, 0, 0);
+        points->InsertNextPoint(0, 1, 0);
+        points->InsertNextPoint(0, 0, 1);
+        points->InsertNextPoint(2.5, 3.0, 1.5);
+
+        auto grid = vtkSmartPointer<vtkUnstructuredGrid>::New();
+        grid->Allocate(2);
+        grid->SetPoints(points);
+        vtkIdType tets[2][4] = {{0, 1, 2, 3}, {1, 2, 3, 4}};
+        grid->InsertNextCell(VTK_TETRA, 4, tets[0]);
+        grid->InsertNextCell(VTK_TETRA, 4, tets[1]);
+        return grid;
+    }
+}
+
+TEST_CASE("ElementWeights"){
+    auto grid = createGrid();
+    auto weights = ElementWeights::New();
+    weights->Compute(grid);
+    REQUIRE(weights->GetNumberOfElements() == 2);
+    REQUIRE(weights->IsValidFor(grid));
+
+    SECTION("constant node values are reproduced"){
+        std::vector<double> nodes(5, 42.0), elements(2);
+        weights->Apply(nodes.data(), elements.data());
+        REQUIRE(elements[0] == Approx(42.0));
+        REQUIRE(elements[1] == Approx(42.0));
+    }
+
+    SECTION("nodes closer to the centroid have a higher weight"){
+        // the three nodes of the regular tetrahedron off the origin are equidistant to the centroid, the origin is closer
+        std::vector<double> nodes = {1.0, 0.0, 0.0, 0.0, 0.0}, elements(2);
+        weights->Apply(nodes.data(), elements.data());
+        REQUIRE(elements[0] > 0.25);
+        REQUIRE(elements[1] == 0.0);
+    }
+
+    SECTION("a modified mesh invalidates the weights"){
+        grid->GetPoints()->SetPoint(4, 2.0, 3.0, 1.5);
+        grid->GetPoints()->Modified();
+        REQUIRE_FALSE(weights->IsValidFor(grid));
+    }
+}
+
+TEST_CASE("ElementWeights attached to the mesh"){
+    auto mesh = mitk::UnstructuredGrid::New();
+    mesh->SetVtkUnstructuredGrid(createGrid());
+
+    auto weights = ElementWeights::GetOrCreate(mesh);
+    REQUIRE(weights.IsNotNull());
+    REQUIRE(ElementWeights::GetOrCreate(mesh).GetPointer() == weights.GetPointer());
+
+    mesh->GetVtkUnstructuredGrid()->GetPoints()->SetPoint(4, 2.0, 3.0, 1.5);
+    mesh->GetVtkUnstructuredGrid()->GetPoints()->Modified();
+    auto recomputed = ElementWeights::GetOrCreate(mesh);
+    REQUIRE(recomputed.GetPointer() != weights.GetPointer());
+    REQUIRE(recomputed->IsValidFor(mesh->GetVtkUnstructuredGrid()));
+
+    ElementWeights::Detach(mesh);
+    bool created;
+    auto detached = ElementWeights::GetOrCreate(mesh, &created);
+    REQUIRE(created);
+    REQUIRE(detached.GetPointer() != recomputed.GetPointer());
+}
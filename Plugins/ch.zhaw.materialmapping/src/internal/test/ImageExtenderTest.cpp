@@ -0,0 +1,294 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <vtkImageConvolve.h>
+#include <vtkImageData.h>
+#include <vtkImageMathematics.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+#include "../ImageExtender.h"
+#include "../TileGrid.h"
+#include "../TileMask.h"
+
+namespace
+{
+    typedef vtkSmartPointer<vtkImageData> VtkImage;
+
+    // FNV-1a hashes of the image and the mask buffer after a step of the former extendsurface C kernel, the reference
+    // of the Old method
+    struct RecordedStep
+    {
+        std::uint64_t imageHash;
+        std::uint64_t maskHash;
+    };
+
+    // createImage() extended from createMask(11, 9, 8) with maxVal, from the same mask without maxVal and from
+    // createMask(4, 3, 2) with maxVal
+    const RecordedStep recordedInnerMaxVal[5] = {
+        {0xa76021021f47fb23ull, 0xe1b45550184a23f8ull}, {0x5baec7c45e7e7434ull, 0x02318b09830cba6cull},
+        {0xa20e8f39c182e133ull, 0xaa31c75d74054964ull}, {0xdb42f8633c0ba5cdull, 0x31c5e32cd8184040ull},
+        {0xe9741eafeea90d51ull, 0xc2b2d9d021a4ef18ull}};
+    const RecordedStep recordedInner[5] = {
+        {0xa5247fc1bc586ac0ull, 0xe1b45550184a23f8ull}, {0x68203d9131ec7a40ull, 0x02318b09830cba6cull},
+        {0x74f9542558e4c752ull, 0xaa31c75d74054964ull}, {0x78edca44e14a97d4ull, 0x31c5e32cd8184040ull},
+        {0x49bcee0d6a29570full, 0xc2b2d9d021a4ef18ull}};
+    const RecordedStep recordedTouchingBorderMaxVal[5] = {
+        {0xa1b25d37c56489b4ull, 0xdb4e7c1651c975f9ull}, {0xd4b9bd350357a4d6ull, 0x6464221319be031eull},
+        {0x6da3420f92870dd6ull, 0x546c34e98b094da0ull}, {0xc71baae4e781b084ull, 0x91cf3006162a4518ull},
+        {0xbae0401289935b45ull, 0x9dae93c0e1fdad2cull}};
+
+    // reference: the former MaterialMappingFilter::inplaceExtendImage
+    void referenceExtendNew(VtkImage _img, VtkImage _mask, bool _maxval)
+    {
+        static const double kernel[27] = {
+            1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
+            1 / sqrt(2), 1, 1 / sqrt(2),
+            1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
+            1 / sqrt(2), 1, 1 / sqrt(2),
+            1, 0, 1,
+            1 / sqrt(2), 1, 1 / sqrt(2),
+            1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3),
+            1 / sqrt(2), 1, 1 / sqrt(2),
+            1 / sqrt(3), 1 / sqrt(2), 1 / sqrt(3)
+        };
+
+        auto math = vtkSmartPointer<vtkImageMathematics>::New();
+        auto imageconv = vtkSmartPointer<vtkImageConvolve>::New();
+        auto maskconv = vtkSmartPointer<vtkImageConvolve>::New();
+
+        auto mask_float = vtkSmartPointer<vtkImageData>::New();
+        mask_float->CopyStructure(_mask);
+        mask_float->AllocateScalars(VTK_FLOAT, 1);
+        for (auto i = 0; i < mask_float->GetNumberOfPoints(); i++)
+        {
+            mask_float->GetPointData()->GetScalars()->SetTuple1(i, _mask->GetPointData()->GetScalars()->GetTuple1(i));
+        }
+
+        math->SetOperationToMultiply();
+        math->SetInput1Data(_img);
+        math->SetInput2Data(mask_float);
+        imageconv->SetKernel3x3x3(kernel);
+        imageconv->SetInputConnection(math->GetOutputPort());
+        imageconv->Update();
+        maskconv->SetKernel3x3x3(kernel);
+        maskconv->SetInputData(mask_float);
+        maskconv->Update();
+        auto maskPoints = (unsigned char *) (_mask->GetScalarPointer());
+        auto convMaskPoints = (float *) (maskconv->GetOutput()->GetScalarPointer());
+        auto convImgPoints = (float *) (imageconv->GetOutput()->GetScalarPointer());
+        auto imagePoints = (float *) (_img->GetScalarPointer());
+
+        for (auto i = 0; i < _img->GetNumberOfPoints(); i++)
+        {
+            if (convMaskPoints[i] && !maskPoints[i])
+            {
+                auto val = convImgPoints[i] / convMaskPoints[i];
+                if (_maxval)
+                {
+                    if (imagePoints[i] < val)
+                    {
+                        imagePoints[i] = val;
+                    }
+                }
+                else
+                {
+                    imagePoints[i] = val;
+                }
+                maskPoints[i] = 1;
+            }
+        }
+    }
+
+    // 23x19x17 image with pseudo random values
+    VtkImage createImage()
+    {
+        auto img = VtkImage::New();
+        img->SetDimensions(23, 19, 17);
+        img->AllocateScalars(VTK_FLOAT, 1);
+        auto p = static_cast<float *>(img->GetScalarPointer());
+        unsigned int state = 12345;
+        for (auto i = 0; i < img->GetNumberOfPoints(); ++i)
+        {
+            state = state * 1103515245u + 12345u;
+            p[i] = static_cast<float>((state >> 8) % 200000) / 7.0f - 1000.0f;
+        }
+        return img;
+    }
+
+    // ellipsoid around _center. If it reaches the image border, the Old method removes the border voxels from the mask
+    VtkImage createMask(double _cx, double _cy, double _cz)
+    {
+        auto mask = VtkImage::New();
+        mask->SetDimensions(23, 19, 17);
+        mask->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+        auto p = static_cast<unsigned char *>(mask->GetScalarPointer());
+        for (auto z = 0; z < 17; ++z)
+        {
+            for (auto y = 0; y < 19; ++y)
+            {
+                for (auto x = 0; x < 23; ++x)
+                {
+                    auto dx = (x - _cx) / 6.5, dy = (y - _cy) / 4.5, dz = (z - _cz) / 3.5;
+                    *p++ = dx * dx + dy * dy + dz * dz <= 1 ? 1 : 0;
+                }
+            }
+        }
+        return mask;
+    }
+
+    VtkImage copy(VtkImage _img)
+    {
+        auto result = VtkImage::New();
+        result->DeepCopy(_img);
+        return result;
+    }
+
+    void requireBitIdentical(VtkImage _expected, VtkImage _actual)
+    {
+        auto size = _expected->GetNumberOfPoints() * _expected->GetScalarSize();
+        REQUIRE(_actual->GetNumberOfPoints() * _actual->GetScalarSize() == size);
+        REQUIRE(std::memcmp(_expected->GetScalarPointer(), _actual->GetScalarPointer(), size) == 0);
+    }
+
+    void compareToReference(VtkImage _mask, bool _maxVal)
+    {
+        auto expectedImage = createImage();
+        auto expectedMask = copy(_mask);
+        auto actualImage = createImage();
+        auto actualMask = copy(_mask);
+
+        ImageExtender extender(actualImage, actualMask, ImageExtender::Method::New);
+        for (auto step = 0; step < 5; ++step)
+        {
+            referenceExtendNew(expectedImage, expectedMask, _maxVal);
+            extender.Step(_maxVal);
+
+            requireBitIdentical(expectedImage, actualImage);
+            requireBitIdentical(expectedMask, actualMask);
+        }
+    }
+
+    std::uint64_t hashScalars(VtkImage _img)
+    {
+        auto p = static_cast<const unsigned char *>(_img->GetScalarPointer());
+        std::uint64_t hash = 14695981039346656037ull;
+        for (vtkIdType i = 0; i < _img->GetNumberOfPoints() * _img->GetScalarSize(); ++i)
+        {
+            hash = (hash ^ p[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    void compareToRecorded(VtkImage _mask, bool _maxVal, const RecordedStep (&_recorded)[5])
+    {
+        auto image = createImage();
+        auto mask = copy(_mask);
+
+        ImageExtender extender(image, mask, ImageExtender::Method::Old);
+        for (auto step = 0; step < 5; ++step)
+        {
+            extender.Step(_maxVal);
+
+            REQUIRE(hashScalars(image) == _recorded[step].imageHash);
+            REQUIRE(hashScalars(mask) == _recorded[step].maskHash);
+        }
+    }
+
+    // the steps on the voxel data of a TileGrid against the dense image. Only the tiles within _border voxels of the
+    // mask are active (all if _border is negative), the voxels extended by _steps steps have to lie within them.
+    void compareToTiled(VtkImage _mask, ImageExtender::Method _method, int _border, int _steps)
+    {
+        auto expectedImage = createImage();
+        auto expectedMask = copy(_mask);
+
+        TileMask tiles(_mask->GetExtent(), _mask->GetOrigin(), _mask->GetSpacing());
+        if (_border < 0)
+        {
+            tiles.ActivateAll();
+        }
+        auto maskPoints = static_cast<const unsigned char *>(_mask->GetScalarPointer());
+        for (auto i = 0; i < _mask->GetNumberOfPoints() && _border >= 0; ++i)
+        {
+            if (maskPoints[i])
+            {
+                double p[3];
+                _mask->GetPoint(i, p);
+                const double bounds[6] = {p[0], p[0], p[1], p[1], p[2], p[2]};
+                tiles.Activate(bounds, _border);
+            }
+        }
+        TileGrid grid(tiles, _mask->GetExtent());
+        REQUIRE(grid.GetNumberOfBlocks() == (_border < 0 ? tiles.GetNumberOfTiles() : tiles.GetNumberOfActiveTiles()));
+
+        std::vector<float> image(grid.GetStorageSize()), expectedTiledImage(grid.GetStorageSize());
+        std::vector<unsigned char> mask(grid.GetStorageSize()), expectedTiledMask(grid.GetStorageSize());
+        grid.ReadImage(createImage(), image.data());
+        grid.ReadImage(_mask, mask.data());
+
+        ImageExtender expected(expectedImage, expectedMask, _method);
+        ImageExtender actual(image.data(), mask.data(), grid, _method);
+        REQUIRE(actual.GetFrontierSize() == expected.GetFrontierSize());
+        for (auto step = 0; step < _steps; ++step)
+        {
+            expected.Step(true);
+            actual.Step(true);
+
+            grid.ReadImage(expectedImage, expectedTiledImage.data());
+            grid.ReadImage(expectedMask, expectedTiledMask.data());
+            REQUIRE(std::memcmp(expectedTiledImage.data(), image.data(), image.size() * sizeof(float)) == 0);
+            REQUIRE(expectedTiledMask == mask);
+        }
+    }
+}
+
+TEST_CASE("ImageExtender"){
+    auto inner = createMask(11, 9, 8);
+    auto touchingBorder = createMask(4, 3, 2);
+
+    SECTION("Old"){
+        compareToRecorded(inner, true, recordedInnerMaxVal);
+        compareToRecorded(inner, false, recordedInner);
+        compareToRecorded(touchingBorder, true, recordedTouchingBorderMaxVal);
+    }
+
+    SECTION("New"){
+        compareToReference(inner, true);
+        compareToReference(inner, false);
+        compareToReference(touchingBorder, true);
+    }
+
+    SECTION("tiles"){
+        for (auto method : {ImageExtender::Method::Old, ImageExtender::Method::New})
+        {
+            compareToTiled(inner, method, -1, 5);
+            compareToTiled(touchingBorder, method, -1, 5);
+            compareToTiled(touchingBorder, method, 4, 3); // 8 of 27 tiles
+        }
+    }
+
+    SECTION("frontier"){
+        auto image = createImage();
+        auto mask = createMask(11, 9, 8);
+        ImageExtender extender(image, mask, ImageExtender::Method::New);
+        auto frontierSize = extender.GetFrontierSize();
+        REQUIRE(frontierSize > 0);
+        REQUIRE(frontierSize < static_cast<std::size_t>(image->GetNumberOfPoints()) / 4);
+
+        // the whole image is eventually masked
+        for (auto step = 0; step < 23; ++step)
+        {
+            extender.Step(true);
+        }
+        REQUIRE(extender.GetFrontierSize() == 0);
+        auto p = static_cast<unsigned char *>(mask->GetScalarPointer());
+        for (auto i = 0; i < mask->GetNumberOfPoints(); ++i)
+        {
+            REQUIRE(p[i] == 1);
+        }
+    }
+}
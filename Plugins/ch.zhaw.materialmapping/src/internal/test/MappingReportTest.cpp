@@ -0,0 +1,62 @@
+#include "catch.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../MappingReport.h"
+
+TEST_CASE("MappingReport"){
+    MappingReport report;
+    report.Begin("voi (read, functors, pad)");
+    report.End(1024);
+    report.Begin("branch 0: \"peel\"");
+    report.End();
+
+    const auto& stages = report.GetStages();
+    REQUIRE(stages.size() == 2);
+    REQUIRE(stages[0].name == "voi (read, functors, pad)");
+    REQUIRE(stages[0].estimatedDataKiB == 1024);
+    REQUIRE(stages[0].seconds >= 0);
+    REQUIRE(stages[1].estimatedDataKiB == 0);
+    REQUIRE(report.GetTotalSeconds() == Approx(stages[0].seconds + stages[1].seconds));
+
+    SECTION("json"){
+        auto json = report.ToJson();
+        REQUIRE(json.find("\"name\": \"voi (read, functors, pad)\", ") != std::string::npos);
+        REQUIRE(json.find("\"estimatedDataKiB\": 1024") != std::string::npos);
+        REQUIRE(json.find("\"name\": \"branch 0: \\\"peel\\\"\"") != std::string::npos);
+    }
+
+    SECTION("log"){
+        std::ostringstream log;
+        log << report << " " << 0.5;
+        REQUIRE(log.str().find("voi (read, functors, pad)") != std::string::npos);
+        REQUIRE(log.str().find("total") != std::string::npos);
+        REQUIRE(log.str().substr(log.str().size() - 4) == " 0.5"); // the stream format is restored
+    }
+
+    SECTION("measured memory"){
+        // 64 MiB are touched and released within the stage: the peak grows, the resident memory returns
+        report.Clear();
+        report.Begin("temporary");
+        {
+            std::vector<char> temporary(64 << 20);
+            std::memset(temporary.data(), 1, temporary.size());
+        }
+        report.End();
+        const auto& stage = report.GetStages()[0];
+        if (stage.peakGrowthKiB != -1)
+        {
+            REQUIRE(stage.peakGrowthKiB >= 60 * 1024);
+            REQUIRE(stage.residentDeltaKiB < stage.peakGrowthKiB);
+        }
+    }
+
+    SECTION("clear"){
+        report.Clear();
+        REQUIRE(report.GetStages().empty());
+        REQUIRE(report.GetTotalSeconds() == 0);
+    }
+}
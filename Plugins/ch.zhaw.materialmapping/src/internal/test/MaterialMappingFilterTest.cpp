@@ -0,0 +1,655 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageContinuousErode3D.h>
+#include <vtkImageData.h>
+#include <vtkImageInterpolator.h>
+#include <vtkIntArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkTetra.h>
+#include <vtkUnstructuredGrid.h>
+
+#include <mitkImage.h>
+#include <mitkUnstructuredGrid.h>
+
+#include "../MaterialMappingFilter.h"
+
+namespace
+{
+    // _size^3 CT with a smooth gradient, between 0 and ~1500 HU for the default size
+    mitk::Image::Pointer createImage(int _scalarType = VTK_SHORT, int _size = 24)
+    {
+        auto vtkImage = vtkSmartPointer<vtkImageData>::New();
+        vtkImage->SetDimensions(_size, _size, _size);
+        vtkImage->SetSpacing(1, 1, 1);
+        vtkImage->SetOrigin(0, 0, 0);
+        vtkImage->AllocateScalars(_scalarType, 1);
+        for (auto z = 0; z < _size; ++z)
+        {
+            for (auto y = 0; y < _size; ++y)
+            {
+                for (auto x = 0; x < _size; ++x)
+                {
+                    vtkImage->SetScalarComponentFromDouble(x, y, z, 0, 30 * x + 20 * y + 10 * z);
+                }
+            }
+        }
+
+        auto image = mitk::Image::New();
+        image->Initialize(vtkImage);
+        image->SetVolume(vtkImage->GetScalarPointer());
+        return image;
+    }
+
+    // cube [6, 17]^3 split into 5 tetrahedra
+    mitk::UnstructuredGrid::Pointer createMesh()
+    {
+        auto points = vtkSmartPointer<vtkPoints>::New();
+        for (auto i = 0; i < 8; ++i)
+        {
+            points->InsertNextPoint(i & 1 ? 17.0 : 6.0, i & 2 ? 17.0 : 6.0, i & 4 ? 17.0 : 6.0);
+        }
+
+        auto ugrid = vtkSmartPointer<vtkUnstructuredGrid>::New();
+        ugrid->Allocate(5);
+        ugrid->SetPoints(points);
+        const vtkIdType tets[5][4] = {{0, 1, 2, 4}, {1, 2, 3, 7}, {1, 4, 5, 7}, {2, 4, 6, 7}, {1, 2, 4, 7}};
+        for (auto i = 0; i < 5; ++i)
+        {
+            auto tetra = vtkSmartPointer<vtkTetra>::New();
+            for (auto j = 0; j < 4; ++j)
+            {
+                tetra->GetPointIds()->SetId(j, tets[i][j]);
+            }
+            ugrid->InsertNextCell(tetra->GetCellType(), tetra->GetPointIds());
+        }
+
+        auto mesh = mitk::UnstructuredGrid::New();
+        mesh->SetVtkUnstructuredGrid(ugrid);
+        return mesh;
+    }
+
+    // chain of 6 tetrahedra along the diagonal of [4, 44]^3, plus a node not belonging to any cell
+    mitk::UnstructuredGrid::Pointer createDiagonalMesh()
+    {
+        auto ugrid = vtkSmartPointer<vtkUnstructuredGrid>::New();
+        ugrid->Allocate(6);
+        auto points = vtkSmartPointer<vtkPoints>::New();
+        for (auto i = 0; i < 6; ++i)
+        {
+            auto c = 4.3 + 6.5 * i;
+            vtkIdType ids[4] = {points->InsertNextPoint(c, c, c), points->InsertNextPoint(c + 6.5, c + 0.5, c + 0.5),
+                                points->InsertNextPoint(c + 0.5, c + 6.5, c + 0.5),
+                                points->InsertNextPoint(c + 0.5, c + 0.5, c + 6.5)};
+            ugrid->InsertNextCell(VTK_TETRA, 4, ids);
+        }
+        points->InsertNextPoint(40.2, 8.7, 11.1);
+        ugrid->SetPoints(points);
+
+        auto mesh = mitk::UnstructuredGrid::New();
+        mesh->SetVtkUnstructuredGrid(ugrid);
+        return mesh;
+    }
+
+    BoneDensityFunctor createDensityFunctor()
+    {
+        BoneDensityFunctor functor;
+        functor.SetRhoCt(BoneDensityParameters::RhoCt(0.0087, -0.00159));
+        functor.SetRhoAsh(BoneDensityParameters::RhoAsh(0.09, 1.14));
+        functor.SetRhoApp(BoneDensityParameters::RhoApp(0.6));
+        return functor;
+    }
+
+    PowerLawFunctor createPowerLawFunctor()
+    {
+        PowerLawFunctor functor;
+        functor.AddPowerLaw(PowerLawParameters(6850, 1.49, 0), 1);
+        functor.AddPowerLaw(PowerLawParameters(6000, 1.2, 0), 100);
+        return functor;
+    }
+
+    MaterialMappingFilter::Pointer createFilter(mitk::UnstructuredGrid::Pointer _mesh, mitk::Image::Pointer _image,
+                                                MaterialMappingFilter::Method _method)
+    {
+        auto filter = MaterialMappingFilter::New();
+        filter->SetInput(_mesh);
+        filter->SetIntensityImage(_image);
+        filter->SetMethod(_method);
+        filter->SetDensityFunctor(createDensityFunctor());
+        filter->SetPowerLawFunctor(createPowerLawFunctor());
+        filter->SetNumberOfExtendImageSteps(3);
+        filter->SetMinElementValue(1.0);
+        return filter;
+    }
+
+    // exposes the individual steps
+    class ExposedFilter : public MaterialMappingFilter
+    {
+    public:
+        mitkClassMacro(ExposedFilter, MaterialMappingFilter)
+
+        itkFactorylessNewMacro(Self)
+
+        using MaterialMappingFilter::VtkImage;
+        using MaterialMappingFilter::erodeMask;
+        using MaterialMappingFilter::nodesToElements;
+        using MaterialMappingFilter::interpolateToNodes;
+    };
+
+    // reference: the erosion of the former createPeeledMask. Its peel decision never put a voxel back (the extended
+    // image was the maximum of the image and its extension), so the peeled mask is the eroded mask.
+    vtkSmartPointer<vtkImageData> referencePeeledMask(vtkSmartPointer<vtkImageData> _mask,
+                                                      MaterialMappingFilter::Method _method)
+    {
+        auto erodeFilter = vtkSmartPointer<vtkImageContinuousErode3D>::New();
+        erodeFilter->SetKernelSize(3, 3, _method == MaterialMappingFilter::Method::Old ? 1 : 3);
+        erodeFilter->SetInputData(_mask);
+        erodeFilter->Update();
+        return erodeFilter->GetOutput();
+    }
+
+    // reference: the former MaterialMappingFilter::nodesToElements
+    vtkSmartPointer<vtkDoubleArray> referenceNodesToElements(vtkUnstructuredGrid *_mesh, vtkDoubleArray *_nodeData)
+    {
+        auto data = vtkSmartPointer<vtkDoubleArray>::New();
+        data->SetNumberOfComponents(1);
+
+        for (auto i = 0; i < _mesh->GetNumberOfCells(); ++i)
+        {
+            auto cellpoints = _mesh->GetCell(i)->GetPoints();
+            auto numberOfNodes = cellpoints->GetNumberOfPoints();
+
+            double centroid[3] = {0, 0, 0};
+            for (auto j = 0; j < numberOfNodes; ++j)
+            {
+                auto cellpoint = cellpoints->GetPoint(j);
+                for (auto k = 0; k < 3; ++k)
+                {
+                    centroid[k] = (centroid[k] * j + cellpoint[k]) / (j + 1);
+                }
+            }
+
+            double minDistance = std::numeric_limits<double>::max();
+            std::vector<double> squaredDistances(numberOfNodes);
+            for (auto j = 0; j < numberOfNodes; ++j)
+            {
+                auto cellpoint = cellpoints->GetPoint(j);
+                double squaredDistance = 0;
+                for (auto k = 0; k < 3; ++k)
+                {
+                    squaredDistance += pow(cellpoint[k] - centroid[k], 2);
+                }
+                squaredDistance = sqrt(squaredDistance);
+                squaredDistances.at(j) = squaredDistance;
+                if (squaredDistance == 0)
+                    squaredDistance = 1;
+                if (squaredDistance < minDistance)
+                    minDistance = squaredDistance;
+            }
+
+            double value = 0, denom = 0;
+            for (auto j = 0; j < numberOfNodes; ++j)
+            {
+                auto normalizedWeight = minDistance / squaredDistances.at(j);
+                denom += normalizedWeight;
+                value += normalizedWeight * _nodeData->GetTuple1(_mesh->GetCell(i)->GetPointId(j));
+            }
+            data->InsertTuple1(i, value / denom);
+        }
+        return data;
+    }
+
+    void requireEqualArrays(vtkDataArray *_expected, vtkDataArray *_actual)
+    {
+        REQUIRE(_expected != nullptr);
+        REQUIRE(_actual != nullptr);
+        REQUIRE(_expected->GetNumberOfTuples() == _actual->GetNumberOfTuples());
+        for (auto i = 0; i < _expected->GetNumberOfTuples(); ++i)
+        {
+            REQUIRE(_expected->GetTuple1(i) == _actual->GetTuple1(i));
+        }
+    }
+}
+
+TEST_CASE("MaterialMappingFilter branches"){
+    auto image = createImage();
+    auto mesh = createMesh();
+
+    for (auto method : {MaterialMappingFilter::Method::Old, MaterialMappingFilter::Method::New})
+    {
+        // reference: one run per peel setting
+        auto peeledFilter = createFilter(mesh, image, method);
+        peeledFilter->SetDoPeelStep(true);
+        peeledFilter->SetPointArrayName("C");
+        peeledFilter->SetCellArrayName("B");
+        peeledFilter->Update();
+        auto peeled = peeledFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+        auto unpeeledFilter = createFilter(mesh, image, method);
+        unpeeledFilter->SetDoPeelStep(false);
+        unpeeledFilter->SetPointArrayName("");
+        unpeeledFilter->SetCellArrayName("A");
+        unpeeledFilter->Update();
+        auto unpeeled = unpeeledFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+        // single run with both branches
+        auto branchFilter = createFilter(mesh, image, method);
+        branchFilter->AddBranch(true, "C", "B");
+        branchFilter->AddBranch(false, "", "A");
+        branchFilter->Update();
+        auto branched = branchFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+        // all arrays in one run, identical to the separate runs
+        REQUIRE(branched->GetPointData()->GetNumberOfArrays() == 1);
+        REQUIRE(branched->GetCellData()->GetNumberOfArrays() == 2);
+        requireEqualArrays(peeled->GetPointData()->GetArray("C"), branched->GetPointData()->GetArray("C"));
+        requireEqualArrays(peeled->GetCellData()->GetArray("B"), branched->GetCellData()->GetArray("B"));
+        requireEqualArrays(unpeeled->GetCellData()->GetArray("A"), branched->GetCellData()->GetArray("A"));
+    }
+}
+
+TEST_CASE("MaterialMappingFilter geometry cache"){
+    auto image = createImage();
+    auto mesh = createMesh();
+
+    auto requireSameResult = [&](MaterialMappingFilter::Pointer _filter, PowerLawFunctor _powerLaw)
+        {
+            auto reference = createFilter(mesh, image, MaterialMappingFilter::Method::New);
+            reference->AddBranch(true, "C", "B");
+            reference->AddBranch(false, "", "A");
+            reference->SetPowerLawFunctor(PowerLawFunctor(_powerLaw));
+            reference->Update();
+            auto expected = reference->GetOutput()->GetVtkUnstructuredGrid();
+
+            _filter->SetPowerLawFunctor(std::move(_powerLaw));
+            _filter->Modified();
+            _filter->Update();
+            auto actual = _filter->GetOutput()->GetVtkUnstructuredGrid();
+            requireEqualArrays(expected->GetPointData()->GetArray("C"), actual->GetPointData()->GetArray("C"));
+            requireEqualArrays(expected->GetCellData()->GetArray("B"), actual->GetCellData()->GetArray("B"));
+            requireEqualArrays(expected->GetCellData()->GetArray("A"), actual->GetCellData()->GetArray("A"));
+        };
+
+    auto filter = createFilter(mesh, image, MaterialMappingFilter::Method::New);
+    filter->AddBranch(true, "C", "B");
+    filter->AddBranch(false, "", "A");
+    requireSameResult(filter, createPowerLawFunctor());
+
+    // only the functor changed: the cached geometry is used
+    PowerLawFunctor powerLaw;
+    powerLaw.AddPowerLaw(PowerLawParameters(5000, 1.8, 10), 1);
+    requireSameResult(filter, powerLaw);
+
+    // a modified mesh invalidates the cache
+    auto points = mesh->GetVtkUnstructuredGrid()->GetPoints();
+    points->SetPoint(7, 18.5, 16.0, 17.5);
+    points->Modified();
+    requireSameResult(filter, powerLaw);
+}
+
+TEST_CASE("MaterialMappingFilter output structure"){
+    auto image = createImage();
+    auto mesh = createMesh();
+    auto input = mesh->GetVtkUnstructuredGrid();
+
+    auto filter = createFilter(mesh, image, MaterialMappingFilter::Method::New);
+    filter->Update();
+    auto output = filter->GetOutput()->GetVtkUnstructuredGrid();
+
+    // points and cells are shared, the arrays are only added to the output
+    REQUIRE(output->GetPoints() == input->GetPoints());
+    REQUIRE(output->GetCells() == input->GetCells());
+    REQUIRE(output->GetPointData()->GetArray("E") != nullptr);
+    REQUIRE(output->GetCellData()->GetArray("E") != nullptr);
+    REQUIRE(input->GetPointData()->GetNumberOfArrays() == 0);
+    REQUIRE(input->GetCellData()->GetNumberOfArrays() == 0);
+
+    // all stages are reported
+    std::vector<std::string> stages;
+    for (const auto& stage : filter->GetReport().GetStages())
+    {
+        stages.push_back(stage.name);
+    }
+    REQUIRE(stages == (std::vector<std::string>{"ct import", "tetrahedra", "voi tiles", "functor lookup table", "output",
+                                                "element weights", "voi (read, functors, pad)", "stencil and node samples",
+                                                "peel", "extend frontier", "extend step 0", "extend step 1",
+                                                "extend step 2", "node interpolation", "element averaging"}));
+
+    // a second update reuses the geometry intermediates and the element weights, their stages create no data
+    filter->Modified();
+    filter->Update();
+    for (const auto& stage : filter->GetReport().GetStages())
+    {
+        if (stage.name == "tetrahedra" || stage.name == "voi tiles" || stage.name == "stencil and node samples" ||
+            stage.name == "element weights")
+        {
+            REQUIRE(stage.estimatedDataKiB == 0);
+        }
+    }
+}
+
+TEST_CASE("MaterialMappingFilter material bins"){
+    auto image = createImage();
+    auto mesh = createMesh();
+
+    auto filter = createFilter(mesh, image, MaterialMappingFilter::Method::New);
+    filter->AddBranch(true, "", "B");
+    filter->AddBranch(false, "", "A");
+    filter->SetMaterialBins(3);
+    filter->Update();
+    auto output = filter->GetOutput()->GetVtkUnstructuredGrid();
+
+    for (std::string name : {"A", "B"})
+    {
+        auto elementValues = output->GetCellData()->GetArray(name.c_str());
+        auto ids = vtkIntArray::SafeDownCast(output->GetCellData()->GetArray((name + "_MATERIAL_ID").c_str()));
+        auto materialValues = output->GetFieldData()->GetArray((name + "_MATERIAL_VALUES").c_str());
+        REQUIRE(elementValues != nullptr);
+        REQUIRE(ids != nullptr);
+        REQUIRE(materialValues != nullptr);
+        REQUIRE(ids->GetNumberOfTuples() == elementValues->GetNumberOfTuples());
+        REQUIRE(materialValues->GetNumberOfTuples() >= 1);
+        REQUIRE(materialValues->GetNumberOfTuples() <= 3);
+
+        // each material value is the mean of its elements
+        std::vector<double> sums(materialValues->GetNumberOfTuples(), 0.0);
+        std::vector<int> counts(materialValues->GetNumberOfTuples(), 0);
+        for (auto i = 0; i < ids->GetNumberOfTuples(); ++i)
+        {
+            auto id = ids->GetValue(i);
+            REQUIRE(id >= 1);
+            REQUIRE(id <= materialValues->GetNumberOfTuples());
+            sums[id - 1] += elementValues->GetTuple1(i);
+            ++counts[id - 1];
+        }
+        for (std::size_t m = 0; m < sums.size(); ++m)
+        {
+            REQUIRE(counts[m] > 0);
+            REQUIRE(materialValues->GetTuple1(m) == Approx(sums[m] / counts[m]));
+        }
+    }
+
+    // the field data of the input is not modified
+    REQUIRE(mesh->GetVtkUnstructuredGrid()->GetFieldData()->GetNumberOfArrays() == 0);
+}
+
+TEST_CASE("MaterialMappingFilter memory mapped CT"){
+    auto image = createImage();
+    auto mesh = createMesh();
+
+    // the CT as MetaImage with a separate raw file
+    auto vtkImage = image->GetVtkImageData();
+    auto dimensions = vtkImage->GetDimensions();
+    {
+        std::ofstream header("MaterialMappingFilterTest_ct.mhd");
+        header << "ObjectType = Image\nNDims = 3\nDimSize = " << dimensions[0] << " " << dimensions[1] << " "
+               << dimensions[2] << "\nElementSpacing = 1 1 1\nOffset = 0 0 0\nElementType = MET_SHORT\n"
+               << "ElementDataFile = MaterialMappingFilterTest_ct.raw\n";
+        std::ofstream raw("MaterialMappingFilterTest_ct.raw", std::ios::binary);
+        raw.write(static_cast<const char *>(vtkImage->GetScalarPointer()),
+                  vtkImage->GetNumberOfPoints() * vtkImage->GetScalarSize());
+    }
+
+    for (auto method : {MaterialMappingFilter::Method::Old, MaterialMappingFilter::Method::New})
+    {
+        auto loadedFilter = createFilter(mesh, image, method);
+        loadedFilter->AddBranch(true, "C", "B");
+        loadedFilter->AddBranch(false, "", "A");
+        loadedFilter->Update();
+        auto expected = loadedFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+        auto mappedFilter = createFilter(mesh, nullptr, method);
+        mappedFilter->SetIntensityImageFile("MaterialMappingFilterTest_ct.mhd");
+        mappedFilter->AddBranch(true, "C", "B");
+        mappedFilter->AddBranch(false, "", "A");
+        mappedFilter->Update();
+        auto actual = mappedFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+        requireEqualArrays(expected->GetPointData()->GetArray("C"), actual->GetPointData()->GetArray("C"));
+        requireEqualArrays(expected->GetCellData()->GetArray("B"), actual->GetCellData()->GetArray("B"));
+        requireEqualArrays(expected->GetCellData()->GetArray("A"), actual->GetCellData()->GetArray("A"));
+    }
+
+    std::remove("MaterialMappingFilterTest_ct.mhd");
+    std::remove("MaterialMappingFilterTest_ct.raw");
+}
+
+TEST_CASE("MaterialMappingFilter skips inactive tiles"){
+    // most of the VOI around the diagonal chain lies outside of the mesh
+    auto image = createImage(VTK_SHORT, 52);
+    auto mesh = createDiagonalMesh();
+
+    for (auto method : {MaterialMappingFilter::Method::Old, MaterialMappingFilter::Method::New})
+    {
+        auto allTilesFilter = createFilter(mesh, image, method);
+        allTilesFilter->SetSkipInactiveTiles(false);
+        allTilesFilter->AddBranch(true, "C", "B");
+        allTilesFilter->AddBranch(false, "A", "A");
+        allTilesFilter->Update();
+        auto expected = allTilesFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+        auto activeTilesFilter = createFilter(mesh, image, method);
+        activeTilesFilter->AddBranch(true, "C", "B");
+        activeTilesFilter->AddBranch(false, "A", "A");
+        activeTilesFilter->Update();
+        auto actual = activeTilesFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+        requireEqualArrays(expected->GetPointData()->GetArray("C"), actual->GetPointData()->GetArray("C"));
+        requireEqualArrays(expected->GetPointData()->GetArray("A"), actual->GetPointData()->GetArray("A"));
+        requireEqualArrays(expected->GetCellData()->GetArray("B"), actual->GetCellData()->GetArray("B"));
+        requireEqualArrays(expected->GetCellData()->GetArray("A"), actual->GetCellData()->GetArray("A"));
+    }
+}
+
+TEST_CASE("MaterialMappingFilter slabs"){
+    auto image = createImage(VTK_SHORT, 52);
+    auto mesh = createDiagonalMesh();
+
+    for (auto method : {MaterialMappingFilter::Method::Old, MaterialMappingFilter::Method::New})
+    {
+        for (auto skipInactiveTiles : {true, false})
+        {
+            auto wholeFilter = createFilter(mesh, image, method);
+            wholeFilter->SetSkipInactiveTiles(skipInactiveTiles);
+            wholeFilter->AddBranch(true, "C", "B");
+            wholeFilter->AddBranch(false, "A", "A");
+            wholeFilter->Update();
+            auto expected = wholeFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+            // the slabs are thinner than their halo, cut the tetrahedra and put nodes on the core borders
+            for (auto slabSlices : {1u, 3u, 8u, 20u})
+            {
+                auto slabFilter = createFilter(mesh, image, method);
+                slabFilter->SetSkipInactiveTiles(skipInactiveTiles);
+                slabFilter->SetSlabSlices(slabSlices);
+                slabFilter->AddBranch(true, "C", "B");
+                slabFilter->AddBranch(false, "A", "A");
+                slabFilter->Update();
+                auto actual = slabFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+                requireEqualArrays(expected->GetPointData()->GetArray("C"), actual->GetPointData()->GetArray("C"));
+                requireEqualArrays(expected->GetPointData()->GetArray("A"), actual->GetPointData()->GetArray("A"));
+                requireEqualArrays(expected->GetCellData()->GetArray("B"), actual->GetCellData()->GetArray("B"));
+                requireEqualArrays(expected->GetCellData()->GetArray("A"), actual->GetCellData()->GetArray("A"));
+
+                // a second update with cached node samples
+                slabFilter->Modified();
+                slabFilter->Update();
+                actual = slabFilter->GetOutput()->GetVtkUnstructuredGrid();
+                requireEqualArrays(expected->GetCellData()->GetArray("B"), actual->GetCellData()->GetArray("B"));
+            }
+        }
+    }
+}
+
+TEST_CASE("MaterialMappingFilter shared lookup table"){
+    auto image = createImage();
+    std::vector<mitk::UnstructuredGrid::Pointer> meshes = {createMesh(), createDiagonalMesh()};
+    auto lookupTable = std::make_shared<const EMorganLookupTable>(createDensityFunctor(), createPowerLawFunctor());
+
+    // the filters share the table and the CT and run concurrently
+    std::vector<MaterialMappingFilter::Pointer> filters;
+    for (const auto& mesh : meshes)
+    {
+        filters.push_back(createFilter(mesh, image, MaterialMappingFilter::Method::New));
+        filters.back()->SetLookupTable(lookupTable);
+    }
+    image->GetVtkImageData();
+    std::vector<std::thread> threads;
+    for (auto filter : filters)
+    {
+        threads.emplace_back([filter]() { filter->Update(); });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        auto reference = createFilter(meshes[i], image, MaterialMappingFilter::Method::New);
+        reference->Update();
+        auto expected = reference->GetOutput()->GetVtkUnstructuredGrid();
+        auto actual = filters[i]->GetOutput()->GetVtkUnstructuredGrid();
+        requireEqualArrays(expected->GetPointData()->GetArray("E"), actual->GetPointData()->GetArray("E"));
+        requireEqualArrays(expected->GetCellData()->GetArray("E"), actual->GetCellData()->GetArray("E"));
+    }
+}
+
+TEST_CASE("MaterialMappingFilter CT scalar types"){
+    auto mesh = createMesh();
+
+    // the VOI is read in the CT's own scalar type, the result has to match a float CT with the same values
+    auto floatFilter = createFilter(mesh, createImage(VTK_FLOAT), MaterialMappingFilter::Method::New);
+    floatFilter->Update();
+    auto expected = floatFilter->GetOutput()->GetVtkUnstructuredGrid();
+
+    for (auto scalarType : {VTK_SHORT, VTK_UNSIGNED_SHORT, VTK_INT, VTK_DOUBLE})
+    {
+        auto filter = createFilter(mesh, createImage(scalarType), MaterialMappingFilter::Method::New);
+        filter->Update();
+        auto actual = filter->GetOutput()->GetVtkUnstructuredGrid();
+        requireEqualArrays(expected->GetPointData()->GetArray("E"), actual->GetPointData()->GetArray("E"));
+        requireEqualArrays(expected->GetCellData()->GetArray("E"), actual->GetCellData()->GetArray("E"));
+    }
+}
+
+TEST_CASE("MaterialMappingFilter peel step"){
+    // 21x18x15 ball mask touching the image border
+    auto mask = vtkSmartPointer<vtkImageData>::New();
+    mask->SetDimensions(21, 18, 15);
+    mask->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    auto maskPoints = static_cast<unsigned char *>(mask->GetScalarPointer());
+    for (auto i = 0; i < mask->GetNumberOfPoints(); ++i)
+    {
+        auto x = i % 21, y = (i / 21) % 18, z = i / (21 * 18);
+        maskPoints[i] = (x - 12) * (x - 12) + (y - 10) * (y - 10) + 2 * (z - 4) * (z - 4) <= 50 ? 1 : 0;
+    }
+
+    auto filter = ExposedFilter::New();
+    for (auto method : {MaterialMappingFilter::Method::Old, MaterialMappingFilter::Method::New})
+    {
+        filter->SetMethod(method);
+        auto expected = referencePeeledMask(mask, method);
+        auto actual = filter->erodeMask(mask);
+        REQUIRE(actual->GetNumberOfPoints() == expected->GetNumberOfPoints());
+        REQUIRE(std::memcmp(expected->GetScalarPointer(), actual->GetScalarPointer(), expected->GetNumberOfPoints()) == 0);
+    }
+}
+
+TEST_CASE("MaterialMappingFilter element values"){
+    auto mitkMesh = createMesh();
+    auto mesh = mitkMesh->GetVtkUnstructuredGrid();
+
+    // an irregular cell on top of the cube
+    double p[3] = {9.3, 11.7, 21.1};
+    vtkIdType ids[4] = {4, 5, 6, mesh->GetPoints()->InsertNextPoint(p)};
+    mesh->InsertNextCell(VTK_TETRA, 4, ids);
+
+    auto nodeData = vtkSmartPointer<vtkDoubleArray>::New();
+    nodeData->SetNumberOfComponents(1);
+    for (auto i = 0; i < mesh->GetNumberOfPoints(); ++i)
+    {
+        nodeData->InsertTuple1(i, 1000.0 + 37.0 * i * i);
+    }
+
+    auto filter = ExposedFilter::New();
+    auto actual = filter->nodesToElements(mesh, nodeData, "E");
+    REQUIRE(std::string(actual->GetName()) == "E");
+    requireEqualArrays(referenceNodesToElements(mesh, nodeData), actual);
+}
+
+TEST_CASE("MaterialMappingFilter node values"){
+    // 17x13x11 float VOI with an extent not starting at 0
+    auto img = vtkSmartPointer<vtkImageData>::New();
+    img->SetExtent(3, 19, -2, 10, 5, 15);
+    img->SetOrigin(-1.25, 2.5, 0.75);
+    img->SetSpacing(0.7, 0.9, 1.3);
+    img->AllocateScalars(VTK_FLOAT, 1);
+    auto imgPoints = static_cast<float *>(img->GetScalarPointer());
+    for (auto i = 0; i < img->GetNumberOfPoints(); ++i)
+    {
+        imgPoints[i] = static_cast<float>((i * 7919) % 3001) * 0.37f;
+    }
+
+    // points inside, on voxel centers, on the borders and outside of the image
+    auto points = vtkSmartPointer<vtkPoints>::New();
+    unsigned int state = 4711;
+    for (auto i = 0; i < 2000; ++i)
+    {
+        double p[3];
+        for (auto k = 0; k < 3; ++k)
+        {
+            state = state * 1103515245u + 12345u;
+            auto index = img->GetExtent()[2 * k] - 1.5 + ((state >> 8) % 10000) / 10000.0 * 20;
+            if (i % 4 == 0)
+            {
+                index = std::floor(index);
+            }
+            p[k] = img->GetOrigin()[k] + index * img->GetSpacing()[k];
+        }
+        points->InsertNextPoint(p);
+    }
+    for (auto k = 0; k < 8; ++k)
+    {
+        points->InsertNextPoint(img->GetOrigin()[0] + img->GetExtent()[k & 1 ? 1 : 0] * img->GetSpacing()[0],
+                                img->GetOrigin()[1] + img->GetExtent()[k & 2 ? 3 : 2] * img->GetSpacing()[1],
+                                img->GetOrigin()[2] + img->GetExtent()[k & 4 ? 5 : 4] * img->GetSpacing()[2]);
+    }
+    auto mesh = vtkSmartPointer<vtkUnstructuredGrid>::New();
+    mesh->SetPoints(points);
+
+    // reference: the former implementation
+    auto interpolator = vtkSmartPointer<vtkImageInterpolator>::New();
+    interpolator->Initialize(img);
+    interpolator->SetInterpolationModeToLinear();
+    interpolator->Update();
+    auto minElem = 20.0;
+    auto expected = vtkSmartPointer<vtkDoubleArray>::New();
+    for (auto i = 0; i < mesh->GetNumberOfPoints(); ++i)
+    {
+        auto p = mesh->GetPoint(i);
+        auto val = interpolator->Interpolate(p[0], p[1], p[2], 0);
+        expected->InsertTuple1(i, val > minElem ? val : minElem);
+    }
+
+    auto filter = ExposedFilter::New();
+    auto actual = filter->interpolateToNodes(mesh, img, "E", minElem);
+    REQUIRE(std::string(actual->GetName()) == "E");
+    requireEqualArrays(expected, actual);
+}
@@ -0,0 +1,87 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <limits>
+
+#include <tinyxml.h>
+
+#include "../MaterialMappingParameters.h"
+
+namespace {
+    // as saved by the material mapping view
+    const char *parameterFile =
+            "<?xml version=\"1.0\" encoding=\"utf-8\" ?>"
+            "<MaterialMapping Version=\"1.0\">"
+            "  <Calibration unit=\"mgHA/cm\xC2\xB3\">"
+            "    <DataPoint HU=\"0\" rho=\"100\" />"
+            "    <DataPoint HU=\"1000\" rho=\"1100\" />"
+            "  </Calibration>"
+            "  <BoneDensityParameters>"
+            "    <RhoCT AutomaticFit=\"1\" slope=\"0\" offset=\"0\" />"
+            "    <RhoAsh enabled=\"1\" offset=\"0.09\" divisor=\"1.14\" />"
+            "    <RhoApp enabled=\"1\" divisor=\"0.6\" />"
+            "  </BoneDensityParameters>"
+            "  <PowerLaws>"
+            "    <PowerLawParameters factor=\"6850\" exponent=\"1.49\" offset=\"0\" rangeMin=\"-3.40282e+38\" rangeMax=\"1\" />"
+            "    <PowerLawParameters factor=\"6000\" exponent=\"1.2\" offset=\"0\" rangeMin=\"1\" rangeMax=\"-3.40282e+38\" />"
+            "  </PowerLaws>"
+            "  <Options doPeel=\"1\" numberOfExtends=\"3\" minValue=\"0\" />"
+            "</MaterialMapping>";
+}
+
+TEST_CASE("MaterialMappingParameters"){
+    TiXmlDocument doc;
+    doc.Parse(parameterFile);
+    auto root = doc.RootElement();
+    REQUIRE(root != nullptr);
+
+    MaterialMappingParameters::Calibration calibration;
+    REQUIRE(MaterialMappingParameters::ReadCalibration(root, calibration));
+    REQUIRE(calibration.unitFactor == 1000.0);
+    REQUIRE(calibration.dataPoints.size() == 2);
+    REQUIRE(calibration.dataPoints[1].first == 1000.0);
+    REQUIRE(calibration.dataPoints[1].second == 1100.0);
+
+    SECTION("fitted density functor"){
+        BoneDensityFunctor functor;
+        REQUIRE(MaterialMappingParameters::ReadDensityFunctor(root, calibration, functor));
+        REQUIRE(functor.m_RhoCt.slope == Approx(0.001));
+        REQUIRE(functor.m_RhoCt.offset == Approx(0.1));
+        REQUIRE(functor.m_RhoAsh.offset == 0.09);
+        REQUIRE(functor.m_RhoAsh.divisor == 1.14);
+        REQUIRE(functor.m_RhoApp.divisor == 0.6);
+    }
+
+    SECTION("power laws with an open upper bound"){
+        PowerLawFunctor functor;
+        REQUIRE(MaterialMappingParameters::ReadPowerLawFunctor(root, functor));
+        REQUIRE(functor.GetUpperBounds().size() == 2);
+        REQUIRE(functor.GetUpperBounds()[0] == 1.0);
+        REQUIRE(functor.GetUpperBounds()[1] == std::numeric_limits<float>::max());
+        REQUIRE(functor(0.5) == Approx(6850 * std::pow(0.5, 1.49)));
+        REQUIRE(functor(2.0) == Approx(6000 * std::pow(2.0, 1.2)));
+    }
+
+    SECTION("sections as root"){
+        MaterialMappingParameters::Calibration sectionCalibration;
+        REQUIRE(MaterialMappingParameters::ReadCalibration(root->FirstChildElement("Calibration"), sectionCalibration));
+        REQUIRE(sectionCalibration.dataPoints == calibration.dataPoints);
+
+        // without bone density parameters, rho_ct is fitted and rho_ash and rho_app are identities
+        BoneDensityFunctor functor;
+        REQUIRE(MaterialMappingParameters::ReadDensityFunctor(root->FirstChildElement("Calibration"), calibration,
+                                                              functor));
+        REQUIRE(functor.m_RhoCt.slope == Approx(0.001));
+        REQUIRE(functor.m_RhoAsh.divisor == 1.0);
+        REQUIRE(functor.m_RhoApp.divisor == 1.0);
+    }
+
+    SECTION("invalid files"){
+        TiXmlDocument invalid;
+        invalid.Parse("<Calibration unit=\"HU\"><DataPoint HU=\"0\" /></Calibration>");
+        REQUIRE_FALSE(MaterialMappingParameters::ReadCalibration(invalid.RootElement(), calibration));
+
+        PowerLawFunctor functor;
+        REQUIRE_FALSE(MaterialMappingParameters::ReadPowerLawFunctor(invalid.RootElement(), functor));
+    }
+}
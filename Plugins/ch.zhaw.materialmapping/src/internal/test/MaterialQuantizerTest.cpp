@@ -0,0 +1,72 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include "../MaterialQuantizer.h"
+
+TEST_CASE("MaterialQuantizer"){
+    auto requireConsistent = [](const std::vector<double>& _values, const MaterialQuantizer::Result& _result) {
+        REQUIRE(_result.ids.size() == _values.size());
+        REQUIRE(_result.values.size() == _result.counts.size());
+        auto maxError = 0.0;
+        for (std::size_t i = 0; i < _values.size(); ++i) {
+            REQUIRE(_result.ids[i] >= 0);
+            REQUIRE(_result.ids[i] < static_cast<int>(_result.values.size()));
+            maxError = std::max(maxError, std::abs(_result.values[_result.ids[i]] - _values[i]));
+        }
+        REQUIRE(_result.maxAbsoluteError == Approx(maxError));
+        for (std::size_t m = 1; m < _result.values.size(); ++m) {
+            REQUIRE(_result.values[m - 1] < _result.values[m]);
+        }
+    };
+
+    SECTION("uniform"){
+        std::vector<double> values {0, 1, 2, 8, 9, 10};
+        auto result = MaterialQuantizer(5, MaterialQuantizer::Binning::Uniform).Quantize(values.data(), values.size());
+        requireConsistent(values, result);
+        // bins of width 2, the maximum belongs to the last bin and the empty bins are dropped
+        REQUIRE(result.values == (std::vector<double>{0.5, 2, 9}));
+        REQUIRE(result.counts == (std::vector<std::size_t>{2, 1, 3}));
+        REQUIRE(result.ids == (std::vector<int>{0, 0, 1, 2, 2, 2}));
+        REQUIRE(result.maxAbsoluteError == Approx(1.0));
+        REQUIRE(result.maxRelativeError == Approx(0.5));
+        REQUIRE(result.rmsError == Approx(std::sqrt(2.5 / 6)));
+    }
+
+    SECTION("log uniform"){
+        std::vector<double> values {0, 1, 2, 10, 20, 100, 200};
+        auto result = MaterialQuantizer(2, MaterialQuantizer::Binning::LogUniform).Quantize(values.data(), values.size());
+        requireConsistent(values, result);
+        // bins [1, ~14) and [~14, 200], 0 is assigned to the first bin
+        REQUIRE(result.ids == (std::vector<int>{0, 0, 0, 0, 1, 1, 1}));
+        REQUIRE(result.values[0] == Approx(13.0 / 4));
+    }
+
+    SECTION("k-means"){
+        std::vector<double> values {1, 1.5, 2, 50, 51, 52, 400, 410, 420};
+        auto result = MaterialQuantizer(3, MaterialQuantizer::Binning::KMeans).Quantize(values.data(), values.size());
+        requireConsistent(values, result);
+        REQUIRE(result.values.size() == 3);
+        REQUIRE(result.ids == (std::vector<int>{0, 0, 0, 1, 1, 1, 2, 2, 2}));
+        REQUIRE(result.values[1] == Approx(51));
+
+        // as many materials as distinct values: no error
+        auto exact = MaterialQuantizer(20, MaterialQuantizer::Binning::KMeans).Quantize(values.data(), values.size());
+        requireConsistent(values, exact);
+        REQUIRE(exact.values == values);
+        REQUIRE(exact.maxAbsoluteError == 0.0);
+    }
+
+    SECTION("constant and empty input"){
+        std::vector<double> values(10, 3.5);
+        for (auto binning : {MaterialQuantizer::Binning::Uniform, MaterialQuantizer::Binning::LogUniform,
+                             MaterialQuantizer::Binning::KMeans}) {
+            auto result = MaterialQuantizer(4, binning).Quantize(values.data(), values.size());
+            requireConsistent(values, result);
+            REQUIRE(result.values == (std::vector<double>{3.5}));
+            REQUIRE(result.maxAbsoluteError == 0.0);
+            REQUIRE(MaterialQuantizer(4, binning).Quantize(nullptr, 0).ids.empty());
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <vtkImageData.h>
+
+#include "../MemoryMappedImage.h"
+
+TEST_CASE("MemoryMappedImage"){
+    std::vector<short> voxels(5 * 4 * 3);
+    for (std::size_t i = 0; i < voxels.size(); ++i) {
+        voxels[i] = static_cast<short>(7 * i - 100);
+    }
+    {
+        std::ofstream raw("MemoryMappedImageTest.raw", std::ios::binary);
+        raw.write(reinterpret_cast<const char *>(voxels.data()), voxels.size() * sizeof(short));
+    }
+
+    auto writeHeader = [](const char *_filename, const char *_header) {
+        std::ofstream file(_filename);
+        file << _header;
+    };
+
+    SECTION("separate data file"){
+        writeHeader("MemoryMappedImageTest.mhd", "ObjectType = Image\nNDims = 3\nDimSize = 5 4 3\n"
+                "ElementSpacing = 0.5 1 2\nOffset = 1 2 3\nTransformMatrix = 1 0 0 0 1 0 0 0 1\n"
+                "ElementType = MET_SHORT\nElementDataFile = MemoryMappedImageTest.raw\n");
+        auto mapped = MemoryMappedImage::OpenMetaImage("MemoryMappedImageTest.mhd");
+        REQUIRE(mapped != nullptr);
+
+        auto image = mapped->GetImage();
+        REQUIRE(image->GetScalarType() == VTK_SHORT);
+        REQUIRE(image->GetDimensions()[0] == 5);
+        REQUIRE(image->GetDimensions()[1] == 4);
+        REQUIRE(image->GetDimensions()[2] == 3);
+        REQUIRE(image->GetSpacing()[0] == 0.5);
+        REQUIRE(image->GetSpacing()[2] == 2.0);
+        REQUIRE(image->GetOrigin()[1] == 2.0);
+        for (auto z = 0; z < 3; ++z) {
+            for (auto y = 0; y < 4; ++y) {
+                for (auto x = 0; x < 5; ++x) {
+                    REQUIRE(image->GetScalarComponentAsDouble(x, y, z, 0) == voxels[(z * 4 + y) * 5 + x]);
+                }
+            }
+        }
+
+        // released slices are read again
+        mapped->ReleaseSlices(0, 3);
+        REQUIRE(image->GetScalarComponentAsDouble(4, 3, 2, 0) == voxels.back());
+        std::remove("MemoryMappedImageTest.mhd");
+    }
+
+    SECTION("local data"){
+        {
+            std::ofstream file("MemoryMappedImageTest.mha", std::ios::binary);
+            file << "NDims = 3\nDimSize = 5 4 3\nElementType = MET_SHORT\nElementDataFile = LOCAL\n";
+            file.write(reinterpret_cast<const char *>(voxels.data()), voxels.size() * sizeof(short));
+        }
+        auto mapped = MemoryMappedImage::OpenMetaImage("MemoryMappedImageTest.mha");
+        REQUIRE(mapped != nullptr);
+        REQUIRE(mapped->GetImage()->GetScalarComponentAsDouble(1, 2, 1, 0) == voxels[(1 * 4 + 2) * 5 + 1]);
+        std::remove("MemoryMappedImageTest.mha");
+    }
+
+    SECTION("raw"){
+        const int dimensions[3] = {5, 4, 2};
+        const double spacing[3] = {1, 1, 1};
+        const double origin[3] = {0, 0, 0};
+        auto mapped = MemoryMappedImage::OpenRaw("MemoryMappedImageTest.raw", dimensions, spacing, origin, VTK_SHORT,
+                                                 20 * sizeof(short));
+        REQUIRE(mapped != nullptr);
+        REQUIRE(mapped->GetImage()->GetScalarComponentAsDouble(0, 0, 0, 0) == voxels[20]);
+    }
+
+    SECTION("unsupported files"){
+        writeHeader("MemoryMappedImageTest.mhd", "NDims = 3\nDimSize = 5 4 3\nElementType = MET_SHORT\n"
+                "CompressedData = True\nElementDataFile = MemoryMappedImageTest.raw\n");
+        REQUIRE(MemoryMappedImage::OpenMetaImage("MemoryMappedImageTest.mhd") == nullptr);
+
+        writeHeader("MemoryMappedImageTest.mhd", "NDims = 3\nDimSize = 5 4 4\nElementType = MET_SHORT\n"
+                "ElementDataFile = MemoryMappedImageTest.raw\n");
+        REQUIRE(MemoryMappedImage::OpenMetaImage("MemoryMappedImageTest.mhd") == nullptr); // too small
+
+        REQUIRE(MemoryMappedImage::OpenMetaImage("MemoryMappedImageTest_missing.mhd") == nullptr);
+        std::remove("MemoryMappedImageTest.mhd");
+
+        // the header has an odd length, the shorts would not be aligned
+        {
+            std::ofstream file("MemoryMappedImageTest.mha", std::ios::binary);
+            file << "NDims = 3\nDimSize = 5 4 3\nElementType = MET_SHORT\nElementDataFile = LOCAL \n";
+            file.write(reinterpret_cast<const char *>(voxels.data()), voxels.size() * sizeof(short));
+        }
+        REQUIRE(MemoryMappedImage::OpenMetaImage("MemoryMappedImageTest.mha") == nullptr);
+        std::remove("MemoryMappedImageTest.mha");
+    }
+
+    std::remove("MemoryMappedImageTest.raw");
+}
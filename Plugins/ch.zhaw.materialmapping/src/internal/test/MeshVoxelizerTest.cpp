@@ -0,0 +1,167 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <utility>
+
+#include <vtkDataSetSurfaceFilter.h>
+#include <vtkIdList.h>
+#include <vtkImageData.h>
+#include <vtkImageStencil.h>
+#include <vtkPoints.h>
+#include <vtkPolyDataToImageStencil.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnstructuredGrid.h>
+#include <vtkUnstructuredGridGeometryFilter.h>
+
+#include "../MeshVoxelizer.h"
+
+namespace
+{
+    const double origin[3] = {-2.3, 1.7, 0.4};
+    const double spacing[3] = {0.8, 1.1, 0.9};
+    const int tets[5][4] = {{0, 1, 2, 4}, {1, 2, 3, 7}, {1, 4, 5, 7}, {2, 4, 6, 7}, {1, 2, 4, 7}};
+
+    // sheared box split into 5 tetrahedra. In index space the corners lie on half voxels and the slanted faces have a
+    // normal of (10, 0, -1), so all voxel centers are at least 0.05 voxels away from the surface: the rasterisation
+    // has no ties.
+    vtkSmartPointer<vtkPoints> createCorners()
+    {
+        auto points = vtkSmartPointer<vtkPoints>::New();
+        for (auto i = 0; i < 8; ++i)
+        {
+            double index[3] = {(i & 1 ? 15.5 : 3.5) + (i & 4 ? 1 : 0), i & 2 ? 14.5 : 4.5, i & 4 ? 12.5 : 2.5};
+            points->InsertNextPoint(origin[0] + index[0] * spacing[0], origin[1] + index[1] * spacing[1],
+                                    origin[2] + index[2] * spacing[2]);
+        }
+        return points;
+    }
+
+    vtkSmartPointer<vtkUnstructuredGrid> createLinearMesh()
+    {
+        auto ugrid = vtkSmartPointer<vtkUnstructuredGrid>::New();
+        ugrid->Allocate(5);
+        ugrid->SetPoints(createCorners());
+        for (const auto& tet : tets)
+        {
+            vtkIdType ids[4] = {tet[0], tet[1], tet[2], tet[3]};
+            ugrid->InsertNextCell(VTK_TETRA, 4, ids);
+        }
+        return ugrid;
+    }
+
+    // same geometry with shared midside nodes on the edge midpoints
+    vtkSmartPointer<vtkUnstructuredGrid> createQuadraticMesh()
+    {
+        auto points = createCorners();
+        std::map<std::pair<int, int>, vtkIdType> midsideNodes;
+        auto midsideNode = [&](int _a, int _b)
+            {
+                auto key = std::make_pair(std::min(_a, _b), std::max(_a, _b));
+                if (midsideNodes.find(key) == midsideNodes.end())
+                {
+                    double a[3], b[3];
+                    points->GetPoint(_a, a);
+                    points->GetPoint(_b, b);
+                    midsideNodes[key] = points->InsertNextPoint((a[0] + b[0]) / 2, (a[1] + b[1]) / 2, (a[2] + b[2]) / 2);
+                }
+                return midsideNodes[key];
+            };
+
+        auto ugrid = vtkSmartPointer<vtkUnstructuredGrid>::New();
+        ugrid->Allocate(5);
+        ugrid->SetPoints(points);
+        for (const auto& t : tets)
+        {
+            vtkIdType ids[10] = {t[0], t[1], t[2], t[3], midsideNode(t[0], t[1]), midsideNode(t[1], t[2]),
+                                 midsideNode(t[0], t[2]), midsideNode(t[0], t[3]), midsideNode(t[1], t[3]),
+                                 midsideNode(t[2], t[3])};
+            ugrid->InsertNextCell(VTK_QUADRATIC_TETRA, 10, ids);
+        }
+        return ugrid;
+    }
+
+    vtkSmartPointer<vtkImageData> createImage()
+    {
+        auto img = vtkSmartPointer<vtkImageData>::New();
+        img->SetExtent(0, 20, 0, 19, 0, 15);
+        img->SetOrigin(origin[0], origin[1], origin[2]);
+        img->SetSpacing(spacing[0], spacing[1], spacing[2]);
+        img->AllocateScalars(VTK_FLOAT, 1);
+        return img;
+    }
+
+    // reference: the former surface extraction and MaterialMappingFilter::createStencil
+    vtkSmartPointer<vtkImageData> referenceStencil(vtkSmartPointer<vtkUnstructuredGrid> _volMesh,
+                                                   vtkSmartPointer<vtkImageData> _img)
+    {
+        auto surfaceFilter = vtkSmartPointer<vtkUnstructuredGridGeometryFilter>::New();
+        surfaceFilter->SetInputData(_volMesh);
+        surfaceFilter->PassThroughCellIdsOn();
+        surfaceFilter->PassThroughPointIdsOn();
+        surfaceFilter->MergingOff();
+        surfaceFilter->Update();
+
+        auto gridToPolyDataFilter = vtkSmartPointer<vtkDataSetSurfaceFilter>::New();
+        auto polyDataToStencilFilter = vtkSmartPointer<vtkPolyDataToImageStencil>::New();
+        polyDataToStencilFilter->SetOutputSpacing(_img->GetSpacing());
+        polyDataToStencilFilter->SetOutputOrigin(_img->GetOrigin());
+
+        auto blankImage = vtkSmartPointer<vtkImageData>::New();
+        blankImage->CopyStructure(_img);
+        blankImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+        std::memset(blankImage->GetScalarPointer(), 0, blankImage->GetNumberOfPoints());
+
+        auto stencil = vtkSmartPointer<vtkImageStencil>::New();
+        stencil->ReverseStencilOn();
+        stencil->SetBackgroundValue(1);
+
+        gridToPolyDataFilter->SetInputData(surfaceFilter->GetOutput());
+        polyDataToStencilFilter->SetInputConnection(gridToPolyDataFilter->GetOutputPort());
+        stencil->SetInputData(blankImage);
+        stencil->SetStencilConnection(polyDataToStencilFilter->GetOutputPort());
+        stencil->Update();
+        return stencil->GetOutput();
+    }
+
+    void compareToReference(vtkSmartPointer<vtkUnstructuredGrid> _mesh)
+    {
+        auto img = createImage();
+        auto expected = referenceStencil(_mesh, img);
+
+        MeshVoxelizer voxelizer(_mesh);
+        auto actual = voxelizer.CreateMask(img);
+
+        REQUIRE(actual->GetScalarType() == VTK_UNSIGNED_CHAR);
+        REQUIRE(actual->GetNumberOfPoints() == expected->GetNumberOfPoints());
+        auto expectedPoints = static_cast<unsigned char *>(expected->GetScalarPointer());
+        auto actualPoints = static_cast<unsigned char *>(actual->GetScalarPointer());
+        auto inside = 0;
+        for (auto i = 0; i < actual->GetNumberOfPoints(); ++i)
+        {
+            REQUIRE(expectedPoints[i] == actualPoints[i]);
+            inside += actualPoints[i];
+        }
+        REQUIRE(inside == 12 * 10 * 10);
+
+        for (auto i = 0; i < 6; ++i)
+        {
+            REQUIRE(voxelizer.GetBounds()[i] == Approx(_mesh->GetBounds()[i]));
+        }
+    }
+}
+
+TEST_CASE("MeshVoxelizer"){
+    SECTION("linear tetrahedra"){
+        auto mesh = createLinearMesh();
+        REQUIRE(MeshVoxelizer(mesh).GetNumberOfTetrahedra() == 5);
+        compareToReference(mesh);
+    }
+
+    SECTION("quadratic tetrahedra"){
+        auto mesh = createQuadraticMesh();
+        REQUIRE(MeshVoxelizer(mesh).GetNumberOfTetrahedra() == 40);
+        compareToReference(mesh);
+    }
+}
@@ -1,6 +1,8 @@
 #include "catch.hpp"
 
 #include <cmath>
+#include <thread>
+#include <vector>
 
 #include "../PowerLawParameters.h"
 #include "../PowerLawFunctor.h"
@@ -44,4 +46,58 @@ TEST_CASE("PowerLawFunctor"){
             REQUIRE( result == expectedFunctor(nr));
         }
     }
-}
\ No newline at end of file
+
+    SECTION("intervals"){
+        // the power laws are sorted by upper bound, the one added first is kept for equal bounds
+        PowerLawFunctor unordered;
+        unordered.AddPowerLaw(p2, 300);
+        unordered.AddPowerLaw(p0, 0);
+        unordered.AddPowerLaw(p1, 200);
+        unordered.AddPowerLaw(PowerLawParameters(5, 5, 5), 200);
+        REQUIRE(unordered.GetUpperBounds() == (std::vector<double>{0, 200, 300}));
+        REQUIRE(unordered.GetPowerLaws() == (std::vector<PowerLawParameters>{p0, p1, p2}));
+        for (auto nr : {-1.0, 0.0, 150.0, 200.0, 250.0, 300.0, 1000.0}) {
+            REQUIRE(unordered(nr) == functor(nr));
+        }
+
+        REQUIRE(PowerLawFunctor()(10.0) == 0.0);
+    }
+
+    SECTION("batch evaluation"){
+        std::vector<float> in {-5.0f, 0.0f, 0.5f, 1.0f, 150.25f, 199.9f, 200.0f, 250.0f, 300.0f, 1e4f};
+        std::vector<float> out(in.size());
+        functor(in.data(), out.data(), in.size());
+        for (std::size_t i = 0; i < in.size(); ++i) {
+            REQUIRE(out[i] == static_cast<float>(functor(static_cast<double>(in[i]))));
+        }
+
+        // in place
+        functor(in.data(), in.data(), in.size());
+        REQUIRE(in == out);
+    }
+
+    SECTION("concurrent evaluation"){
+        // all threads share one functor and alternate between the intervals
+        std::vector<double> numbers;
+        for (auto i = 0; i < 10000; ++i) {
+            numbers.push_back((i % 2 ? 1.0 : -1.0) * i * 0.037);
+        }
+        std::vector<std::vector<double>> results(4, std::vector<double>(numbers.size()));
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < results.size(); ++t) {
+            threads.emplace_back([&, t]() {
+                for (std::size_t i = 0; i < numbers.size(); ++i) {
+                    results[t][i] = functor(numbers[(i + t * 997) % numbers.size()]);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        for (std::size_t t = 0; t < results.size(); ++t) {
+            for (std::size_t i = 0; i < numbers.size(); ++i) {
+                REQUIRE(results[t][i] == functor(numbers[(i + t * 997) % numbers.size()]));
+            }
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#include "catch.hpp"
+
+#include <set>
+#include <vector>
+
+#include "../TileGrid.h"
+#include "../TileMask.h"
+
+TEST_CASE("TileGrid"){
+    // 20x13x19 voxels starting at (-3, 2, 5): 3x2x3 tiles, the last ones partial
+    const int extent[6] = {-3, 16, 2, 14, 5, 23};
+    const double origin[3] = {1.0, -2.0, 0.5};
+    const double spacing[3] = {0.5, 2.0, 1.0};
+    TileMask tiles(extent, origin, spacing);
+
+    // the tiles (1, 0, 0), (2, 1, 1) and (0, 1, 2)
+    auto activate = [&](int _x, int _y, int _z) {
+        const double voxel[6] = {origin[0] + _x * spacing[0], origin[0] + _x * spacing[0],
+                                 origin[1] + _y * spacing[1], origin[1] + _y * spacing[1],
+                                 origin[2] + _z * spacing[2], origin[2] + _z * spacing[2]};
+        tiles.Activate(voxel, 0);
+    };
+    activate(6, 3, 7);
+    activate(14, 12, 15);
+    activate(-2, 11, 22);
+    REQUIRE(tiles.GetNumberOfActiveTiles() == 3);
+
+    SECTION("ids"){
+        TileGrid grid(tiles, extent);
+        REQUIRE(grid.GetNumberOfBlocks() == 3);
+        REQUIRE(grid.GetStorageSize() == 4 * 512);
+
+        // the voxels of the active tiles have distinct ids and map back to their index, all others share the zero block
+        std::set<vtkIdType> ids;
+        for (auto z = extent[4]; z <= extent[5]; ++z) {
+            for (auto y = extent[2]; y <= extent[3]; ++y) {
+                for (auto x = extent[0]; x <= extent[1]; ++x) {
+                    auto id = grid.GetId(x, y, z);
+                    REQUIRE(grid.IsStored(id) == tiles.IsActive(x, y, z));
+                    if (!grid.IsStored(id)) {
+                        REQUIRE(id >= 3 * 512);
+                        REQUIRE(id < 4 * 512);
+                        continue;
+                    }
+                    REQUIRE(ids.insert(id).second);
+                    int index[3];
+                    grid.GetIndex(id, index[0], index[1], index[2]);
+                    REQUIRE(index[0] == x);
+                    REQUIRE(index[1] == y);
+                    REQUIRE(index[2] == z);
+                }
+            }
+        }
+        // the first tile is complete, the second one has 4 voxels in x and 5 in y, the third one 5 in y and 3 in z
+        REQUIRE(ids.size() == 512 + 4 * 5 * 8 + 8 * 5 * 3);
+
+        // the rows cover the same voxels
+        std::set<vtkIdType> rowIds;
+        for (std::size_t b = 0; b < grid.GetNumberOfBlocks(); ++b) {
+            grid.ForEachRow(b, [&](vtkIdType _id, int _xBegin, int _xEnd, int _y, int _z) {
+                for (auto x = _xBegin; x < _xEnd; ++x) {
+                    REQUIRE(grid.GetId(x, _y, _z) == _id + x - _xBegin);
+                    rowIds.insert(_id + x - _xBegin);
+                }
+            });
+        }
+        REQUIRE(rowIds == ids);
+
+        // neighbors within and across tiles
+        for (auto id : ids) {
+            int x, y, z;
+            grid.GetIndex(id, x, y, z);
+            for (auto d = 0; d < 27; ++d) {
+                auto dx = d % 3 - 1, dy = (d / 3) % 3 - 1, dz = d / 9 - 1;
+                if (x + dx >= extent[0] && x + dx <= extent[1] && y + dy >= extent[2] && y + dy <= extent[3] &&
+                    z + dz >= extent[4] && z + dz <= extent[5]) {
+                    REQUIRE(grid.GetNeighborId(id, x, y, z, dx, dy, dz) == grid.GetId(x + dx, y + dy, z + dz));
+                }
+            }
+        }
+    }
+
+    SECTION("slab"){
+        // the slices 13 to 15 lie in the second tile layer, only its active tile is stored
+        const int slab[6] = {extent[0], extent[1], extent[2], extent[3], 13, 15};
+        TileGrid grid(tiles, slab);
+        REQUIRE(grid.GetNumberOfBlocks() == 1);
+        auto rows = 0;
+        grid.ForEachRow(0, [&](vtkIdType _id, int _xBegin, int _xEnd, int _y, int _z) {
+            REQUIRE(_xBegin == 13);
+            REQUIRE(_xEnd == 17);
+            REQUIRE(_y >= 10);
+            REQUIRE(_z >= 13);
+            REQUIRE(_z <= 15);
+            REQUIRE(grid.GetId(_xBegin, _y, _z) == _id);
+            ++rows;
+        });
+        REQUIRE(rows == 5 * 3);
+        REQUIRE_FALSE(grid.IsStored(grid.GetId(6, 3, 13)));
+    }
+
+    SECTION("images"){
+        TileGrid grid(tiles, extent);
+        std::vector<float> values(grid.GetStorageSize(), 0.0f);
+        for (std::size_t b = 0; b < grid.GetNumberOfBlocks(); ++b) {
+            grid.ForEachVoxel(b, [&](vtkIdType _id, int _x, int _y, int _z) {
+                values[_id] = 1.0f + _x + 100.0f * _y + 10000.0f * _z;
+            });
+        }
+
+        // the dense image has 0 in the inactive tiles and reads back to the same values
+        auto img = grid.CreateImage(values.data());
+        REQUIRE(img->GetScalarType() == VTK_FLOAT);
+        REQUIRE(*static_cast<float *>(img->GetScalarPointer(7, 4, 8)) == 1.0f + 7 + 400 + 80000);
+        REQUIRE(*static_cast<float *>(img->GetScalarPointer(-3, 2, 5)) == 0.0f);
+        REQUIRE(img->GetOrigin()[1] == origin[1]);
+        REQUIRE(img->GetSpacing()[0] == spacing[0]);
+        std::vector<float> read(grid.GetStorageSize(), 1.0f);
+        grid.ReadImage(img, read.data());
+        REQUIRE(read == values);
+
+        // the neighborhood of the second block, (13, 10, 13) to (22, 19, 22), reaches beyond the extent in x and y
+        std::vector<float> neighborhood(TileGrid::NeighborhoodSize * TileGrid::NeighborhoodSize * TileGrid::NeighborhoodSize);
+        grid.GetNeighborhood(1, values.data(), -1.0f, neighborhood.data());
+        auto at = [&](int _x, int _y, int _z) {
+            return neighborhood[(_x - 12) + TileGrid::NeighborhoodSize * ((_y - 9) + TileGrid::NeighborhoodSize * (_z - 12))];
+        };
+        REQUIRE(at(14, 12, 15) == 1.0f + 14 + 1200 + 150000);
+        REQUIRE(at(12, 10, 13) == 0.0f); // inactive tile
+        REQUIRE(at(17, 10, 13) == -1.0f);
+        REQUIRE(at(14, 15, 13) == -1.0f);
+    }
+}
@@ -0,0 +1,59 @@
+#include "catch.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "../TileMask.h"
+
+TEST_CASE("TileMask"){
+    // 20x13x9 voxels starting at (-3, 2, 5): 3x2x2 tiles, the last ones partial
+    const int extent[6] = {-3, 16, 2, 14, 5, 13};
+    const double origin[3] = {1.0, -2.0, 0.5};
+    const double spacing[3] = {0.5, 2.0, 1.0};
+    TileMask tiles(extent, origin, spacing);
+    REQUIRE(tiles.GetNumberOfTiles() == 12);
+    REQUIRE(tiles.GetNumberOfActiveTiles() == 0);
+
+    auto spans = [&](int _y, int _z) {
+        std::vector<std::pair<int, int>> result;
+        tiles.ForEachActiveSpan(_y, _z, [&](int _xBegin, int _xEnd) {
+            result.push_back({_xBegin, _xEnd});
+        });
+        return result;
+    };
+
+    SECTION("activation"){
+        // voxel (10, 3, 6) dilated by 1: x 9-11 in the second tile, y 2-4 and z 5-7 in the first
+        const double point[6] = {6.0, 6.0, 4.0, 4.0, 6.5, 6.5};
+        tiles.Activate(point, 1);
+        REQUIRE(tiles.GetNumberOfActiveTiles() == 1);
+        REQUIRE(tiles.IsActive(5, 2, 5));
+        REQUIRE(tiles.IsActive(12, 9, 12));
+        REQUIRE_FALSE(tiles.IsActive(4, 2, 5));
+        REQUIRE_FALSE(tiles.IsActive(13, 2, 5));
+        REQUIRE_FALSE(tiles.IsActive(5, 10, 5));
+        REQUIRE_FALSE(tiles.IsActive(5, 2, 13));
+        REQUIRE(spans(3, 6) == (std::vector<std::pair<int, int>>{{5, 13}}));
+        REQUIRE(spans(10, 6).empty());
+
+        // adjacent tiles form a single span
+        const double row[6] = {0.0, 8.0, 4.0, 4.0, 6.5, 6.5};
+        tiles.Activate(row, 0);
+        REQUIRE(tiles.GetNumberOfActiveTiles() == 3);
+        REQUIRE(spans(3, 6) == (std::vector<std::pair<int, int>>{{-3, 17}}));
+    }
+
+    SECTION("clamping to the extent"){
+        const double outside[6] = {-100.0, -90.0, -100.0, -90.0, -100.0, -90.0};
+        tiles.Activate(outside, 2);
+        REQUIRE(tiles.GetNumberOfActiveTiles() == 0);
+
+        const double everything[6] = {-100.0, 100.0, -100.0, 100.0, -100.0, 100.0};
+        tiles.Activate(everything, 0);
+        REQUIRE(tiles.GetNumberOfActiveTiles() == tiles.GetNumberOfTiles());
+        REQUIRE(spans(14, 13) == (std::vector<std::pair<int, int>>{{-3, 17}}));
+        REQUIRE(spans(1, 5).empty());
+        REQUIRE(spans(2, 14).empty());
+        REQUIRE_FALSE(tiles.IsActive(17, 2, 5));
+    }
+}